@@ -0,0 +1,127 @@
+///
+/// Measures AxisFilter (axis_filter.h). Exactness against a scalar implementation is checked by
+/// tests/f710/axis_filter_test.cpp.
+///
+/// -   throughput: apply() in a tight loop
+/// -   1 kHz: a tick paced at 1 ms with clock_nanosleep for a few seconds, on a synthetic stick signal
+///     with RF style noise and spikes; reports apply() time percentiles, heap allocations made inside
+///     the ticks, and how far raw and filtered values are from the clean signal
+///
+/// usage: axis_filter_bench [paced_seconds]
+///
+#include "axis_filter.h"
+#include "f710_time.h"
+#include "latency_histogram.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace {
+    uint64_t g_allocations = 0;
+}
+
+void* operator new(std::size_t size)
+{
+    g_allocations++;
+    void* p = malloc(size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, std::size_t) noexcept { free(p); }
+
+namespace {
+
+    constexpr int LANES = f710::AxisFilter::LANES;
+
+    uint32_t xorshift(uint32_t& x)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        return x;
+    }
+
+    ///
+    /// A stick sweeping end to end every 2 s on lane 0 (the other lanes phase shifted), plus +-400 of
+    /// noise and a full scale spike one tick in 97
+    ///
+    int16_t clean_signal(uint64_t tick, int lane)
+    {
+        return (int16_t)(30000.0 * sin(2.0 * M_PI * (double)tick / 2000.0 + lane * 0.7));
+    }
+    int16_t noisy_signal(uint64_t tick, int lane, uint32_t& seed)
+    {
+        if (((tick + lane) % 97) == 50) {
+            return (lane & 1) ? INT16_MIN : INT16_MAX;
+        }
+        int v = clean_signal(tick, lane) + (int)(xorshift(seed) % 801) - 400;
+        return (int16_t)std::max(-32767, std::min(32767, v));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    double paced_seconds = (argc > 1) ? atof(argv[1]) : 3.0;
+
+    const f710::AxisFilterConfig config{true, 300, 2000};
+    {
+        f710::AxisFilter filter{config};
+        int16_t v[LANES] = {1, -2, 3, -4, 5, -6, 7, -8};
+        const uint64_t n = 20000000;
+        f710::Time start = f710::Time::now();
+        for (uint64_t t = 0; t < n; t++) {
+            v[t & 7] ^= (int16_t)t;
+            filter.apply(v, v);
+        }
+        f710::Time end = f710::Time::now();
+        printf("throughput: %.2f ns per apply() of %d axes (checksum %d)\n",
+               (double)f710::Time::diff(end, start).nanosecs / (double)n, LANES, v[0] + v[7]);
+    }
+
+    f710::AxisFilter filter{config};
+    f710::LatencyHistogram apply_time;
+    uint32_t seed = 7;
+    double raw_error = 0;
+    double filtered_error = 0;
+    int max_raw_error = 0;
+    int max_filtered_error = 0;
+    auto ticks = (uint64_t)(paced_seconds * 1000.0);
+    uint64_t allocations_before = g_allocations;
+    f710::Time next = f710::Time::now();
+    for (uint64_t t = 0; t < ticks; t++) {
+        next = next.add_ms(1);
+        timespec ts = next.as_timespec();
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+        }
+        int16_t raw[LANES], filtered[LANES];
+        for (int i = 0; i < LANES; i++) {
+            raw[i] = noisy_signal(t, i, seed);
+        }
+        f710::Time before = f710::Time::now();
+        filter.apply(raw, filtered);
+        apply_time.record(f710::Time::diff(f710::Time::now(), before).nanosecs);
+        for (int i = 0; i < LANES; i++) {
+            int clean = clean_signal(t, i);
+            int re = abs(raw[i] - clean);
+            // the median and the EMA delay the output, compare it with the clean signal that much earlier
+            int fe = abs(filtered[i] - clean_signal((t >= 4) ? t - 4 : 0, i));
+            raw_error += (double)re * re;
+            filtered_error += (double)fe * fe;
+            max_raw_error = std::max(max_raw_error, re);
+            max_filtered_error = std::max(max_filtered_error, fe);
+        }
+    }
+    uint64_t allocations = g_allocations - allocations_before;
+    double samples = (double)ticks * LANES;
+    printf("1 kHz for %.1f s: apply() p50 %lu ns p99 %lu ns max %lu ns, heap allocations in ticks: %lu\n",
+           paced_seconds, apply_time.percentile(0.5), apply_time.percentile(0.99), apply_time.max(), allocations);
+    printf("error against the clean signal: raw rms %.0f max %d, filtered rms %.0f max %d\n",
+           sqrt(raw_error / samples), max_raw_error, sqrt(filtered_error / samples), max_filtered_error);
+    return 0;
+}
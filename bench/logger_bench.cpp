@@ -0,0 +1,89 @@
+///
+/// Measures the rbl logger (rbl/logger.h). Its output is checked against snprintf by
+/// tests/f710/logger_test.cpp.
+///
+/// -   hot path: the cost to the calling thread of one RBL_LOG_FMT with four arguments, and the heap
+///     allocations it makes, against the previous asprintf + rbl_log_function path, with both writing
+///     to /dev/null
+///
+/// usage: logger_bench [statements]
+///
+#include <rbl/logger.h>
+#include "f710_time.h"
+#include "latency_histogram.h"
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+namespace {
+    uint64_t g_mallocs = 0;
+}
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* malloc(size_t size)
+{
+    g_mallocs++;
+    return __libc_malloc(size);
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t statements = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 200000;
+    rbl::log::start();
+
+    FILE* devnull = fopen("/dev/null", "w");
+    // a buffer of its own, so the background thread's first write does not show up as a malloc
+    static char devnull_buffer[BUFSIZ];
+    setvbuf(devnull, devnull_buffer, _IOFBF, sizeof(devnull_buffer));
+    rbl::log::set_output(devnull);
+    // the first statement claims this thread's ring, which is not the hot path being measured
+    RBL_LOG_FMT("logger_bench starting");
+    rbl::log::flush();
+    {
+        f710::LatencyHistogram cost;
+        uint64_t mallocs_before = g_mallocs;
+        uint64_t dropped_before = rbl::log::dropped();
+        f710::Time start = f710::Time::now();
+        for (uint64_t i = 0; i < statements; i++) {
+            f710::Time before = f710::Time::now();
+            RBL_LOG_FMT("js_event time: %u number: %d value: %d type: %Xh", (uint32_t)i, (int)(i & 7), (int)(int16_t)i, 2);
+            cost.record(f710::Time::diff(f710::Time::now(), before).nanosecs);
+            // a paced producer, 1 statement per 2 us, so the comparison is not just about a full ring
+            while (f710::Time::diff(f710::Time::now(), start).nanosecs < (int64_t)(i + 1) * 2000) {
+            }
+        }
+        uint64_t mallocs = g_mallocs - mallocs_before;
+        rbl::log::flush();
+        printf("RBL_LOG_FMT: p50 %lu ns p99 %lu ns p999 %lu ns max %lu ns, %lu mallocs, %lu dropped of %lu\n",
+               cost.percentile(0.5), cost.percentile(0.99), cost.percentile(0.999), cost.max(), mallocs,
+               rbl::log::dropped() - dropped_before, statements);
+    }
+    {
+        // the previous macro body, stdout pointed at /dev/null
+        fflush(stdout);
+        FILE* saved = fdopen(dup(fileno(stdout)), "w");
+        if (freopen("/dev/null", "w", stdout) == nullptr) {
+            return 1;
+        }
+        f710::LatencyHistogram cost;
+        uint64_t mallocs_before = g_mallocs;
+        f710::Time start = f710::Time::now();
+        for (uint64_t i = 0; i < statements; i++) {
+            f710::Time before = f710::Time::now();
+            char* s;
+            if (asprintf(&s, "js_event time: %u number: %d value: %d type: %Xh", (uint32_t)i, (int)(i & 7), (int)(int16_t)i, 2) >= 0) {
+                rbl_log_function("LOG", __FUNCTION__, __FILE__, __LINE__, s);
+                free(s);
+            }
+            cost.record(f710::Time::diff(f710::Time::now(), before).nanosecs);
+            while (f710::Time::diff(f710::Time::now(), start).nanosecs < (int64_t)(i + 1) * 2000) {
+            }
+        }
+        uint64_t mallocs = g_mallocs - mallocs_before;
+        fflush(stdout);
+        fprintf(saved, "asprintf + rbl_log_function: p50 %lu ns p99 %lu ns p999 %lu ns max %lu ns, %lu mallocs\n",
+                cost.percentile(0.5), cost.percentile(0.99), cost.percentile(0.999), cost.max(), mallocs);
+        fclose(saved);
+    }
+    return 0;
+}
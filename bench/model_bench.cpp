@@ -0,0 +1,141 @@
+///
+/// Measures the cost of apply_event() for the hand written ControllerState (model.h) against
+/// BasicControllerState (controller_state.h) built with the same three devices, and with every axis and
+/// button of the F710 in D mode, so the effect of adding devices is visible, and against the structure
+/// of arrays FullControllerState (full_controller_state.h) - with and without a snapshot() every 16
+/// events, about what a 50 Hz callback sees at the driver's event rate.
+///
+/// The event stream is the D mode init burst followed by a pseudo random mix of events on all 6 axes
+/// and 12 buttons, so most events are for devices the three device models do not have. Before timing,
+/// whether the models end in the same state is printed; the pass/fail check, event by event, is
+/// tests/f710/controller_state_test.cpp.
+///
+/// usage: model_bench [event_count]
+///
+#include "controller_state.h"
+#include "full_controller_state.h"
+#include "f710_time.h"
+#include "model.h"
+#include "model_defines.h"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+    using LeftStick = f710::Axis<D_AXIS_LEFT_STICK_FWD_BKWD_NUMBER>;
+    using RightStick = f710::Axis<D_AXIS_RIGHT_STICK_FWD_BKWD_NUMBER>;
+    using GearToggle = f710::Toggle<D_BUTTON_A>;
+    using DriveState = f710::BasicControllerState<LeftStick, RightStick, GearToggle>;
+    using FullState = f710::BasicControllerState<
+        f710::Axis<0>, f710::Axis<1>, f710::Axis<2>, f710::Axis<3>, f710::Axis<4>, f710::Axis<5>,
+        f710::Toggle<0>, f710::Toggle<1>, f710::Toggle<2>, f710::Toggle<3>, f710::Toggle<4>, f710::Toggle<5>,
+        f710::Toggle<6>, f710::Toggle<7>, f710::Toggle<8>, f710::Toggle<9>, f710::Toggle<10>, f710::Toggle<11>>;
+
+    std::vector<js_event> make_events(uint64_t count)
+    {
+        std::vector<js_event> events;
+        events.reserve(count + 18);
+        for (__u8 n = 0; n < 12; n++) {
+            events.push_back(js_event{0, 0, JS_EVENT_BUTTON | JS_EVENT_INIT, n});
+        }
+        for (__u8 n = 0; n < 6; n++) {
+            events.push_back(js_event{0, 0, JS_EVENT_AXIS | JS_EVENT_INIT, n});
+        }
+        bool pressed[12] = {};
+        uint32_t x = 12345;
+        for (uint64_t i = 0; i < count; i++) {
+            // xorshift, deterministic and cheap
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            auto time = (uint32_t)(i / 4);
+            if ((x & 0x7) == 0) {
+                auto n = (__u8)((x >> 3) % 12);
+                pressed[n] = !pressed[n];
+                events.push_back(js_event{time, (__s16)(pressed[n] ? 1 : 0), JS_EVENT_BUTTON, n});
+            } else {
+                events.push_back(js_event{time, (__s16)(x >> 16), JS_EVENT_AXIS, (__u8)((x >> 3) % 6)});
+            }
+        }
+        return events;
+    }
+
+    template <typename State>
+    double time_apply(State& state, const std::vector<js_event>& events)
+    {
+        f710::Time start = f710::Time::now();
+        for (const auto& event: events) {
+            state.apply_event(event);
+        }
+        f710::Time end = f710::Time::now();
+        return (double)f710::Time::diff(end, start).nanosecs / (double)events.size();
+    }
+
+    double time_apply_with_snapshots(f710::FullControllerState& state, const std::vector<js_event>& events)
+    {
+        uint32_t changed = 0;
+        f710::Time start = f710::Time::now();
+        for (size_t i = 0; i < events.size(); i++) {
+            state.apply_event(events[i]);
+            if ((i & 15) == 15) {
+                f710::ControllerSnapshot snapshot = state.snapshot();
+                changed += __builtin_popcount(snapshot.dirty);
+            }
+        }
+        f710::Time end = f710::Time::now();
+        // use the result so the snapshots are not optimised away
+        if (changed == 0) {
+            printf("no changes seen\n");
+        }
+        return (double)f710::Time::diff(end, start).nanosecs / (double)events.size();
+    }
+
+    f710::ControllerState make_controller_state()
+    {
+        return f710::ControllerState{
+            f710::AxisDevice(D_AXIS_LEFT_STICK_FWD_BKWD_NUMBER),
+            f710::AxisDevice(D_AXIS_RIGHT_STICK_FWD_BKWD_NUMBER),
+            f710::ToggleButton(D_BUTTON_A)};
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t count = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 10000000;
+    std::vector<js_event> events = make_events(count);
+
+    auto controller_state = make_controller_state();
+    DriveState drive_state;
+    FullState full_state;
+    f710::FullControllerState soa_state;
+    for (const auto& event: events) {
+        controller_state.apply_event(event);
+        drive_state.apply_event(event);
+        full_state.apply_event(event);
+        soa_state.apply_event(event);
+    }
+    bool same = (controller_state.m_left.latest_event_value == drive_state.get<LeftStick>().latest_event_value)
+        && (controller_state.m_right.latest_event_value == drive_state.get<RightStick>().latest_event_value)
+        && (controller_state.m_button.event_toggle_value == drive_state.get<GearToggle>().event_toggle_value)
+        && (controller_state.m_left.latest_event_value
+            == full_state.get<f710::Axis<D_AXIS_LEFT_STICK_FWD_BKWD_NUMBER>>().latest_event_value)
+        && (controller_state.m_button.event_toggle_value
+            == full_state.get<f710::Toggle<D_BUTTON_A>>().event_toggle_value)
+        && (controller_state.m_right.latest_event_value == soa_state.state().axis(D_AXIS_RIGHT_STICK_FWD_BKWD_NUMBER))
+        && (controller_state.m_button.event_toggle_value == soa_state.state().is_toggled(D_BUTTON_A))
+        && (soa_state.mode() == f710::ControllerMode::D);
+    printf("models agree after %zu events: %s\n", events.size(), same ? "yes" : "NO");
+
+    auto timed_controller_state = make_controller_state();
+    DriveState timed_drive_state;
+    FullState timed_full_state;
+    f710::FullControllerState timed_soa_state;
+    f710::FullControllerState timed_snapshot_state;
+    printf("ControllerState                 %6.2f ns/event\n", time_apply(timed_controller_state, events));
+    printf("BasicControllerState 3 devices  %6.2f ns/event\n", time_apply(timed_drive_state, events));
+    printf("BasicControllerState 18 devices %6.2f ns/event\n", time_apply(timed_full_state, events));
+    printf("FullControllerState             %6.2f ns/event\n", time_apply(timed_soa_state, events));
+    printf("FullControllerState + snapshots %6.2f ns/event\n", time_apply_with_snapshots(timed_snapshot_state, events));
+    return 0;
+}
@@ -0,0 +1,282 @@
+///
+/// Drives one Reader backend with the same synthetic event stream (generator_source.h) and writes the
+/// results to a JSON file. The backend and read mode are chosen at compile time exactly as for the
+/// main program - bench/CMakeLists.txt builds one binary per combination.
+///
+/// Scenarios, all measured on the thread running Reader::run():
+///
+/// -   saturation: an unpaced generator, events/s through the reader, read syscalls and context
+///     switches per event
+/// -   idle, 100/s, 1000/s: a generator paced at that rate (idle is a socketpair nobody writes to) for
+///     a fixed time - CPU%, wakeups/s, and the jitter of the output tick against its nominal interval
+///
+/// Read syscalls are the syscr count from /proc/thread-self/io (read, readv, recv ...; the select or
+/// epoll_wait calls are not included). Wakeups are voluntary context switches - each one is the
+/// thread blocking in select/epoll_wait/read and being woken again.
+///
+/// usage: reader_bench_<backend> [json_path] [saturation_events] [paced_seconds]
+///
+// before any Boost header: boost/asio/awaitable.hpp uses std::exchange without including <utility>
+#include <utility>
+#include "f710_helpers.h"
+#include "f710_time.h"
+#include "latency_histogram.h"
+#include "model.h"
+#include "model_defines.h"
+#include "event_source.h"
+#include "generator_source.h"
+#ifdef ASIO_READER
+#include "asio_reader.h"
+#define BACKEND "asio"
+#elif defined(ASIO_CORO_READER)
+#include "asio_coro_reader.h"
+#define BACKEND "asio_coro"
+#elif defined(EPOLL_READER)
+#include "epoll_reader.h"
+#define BACKEND "epoll"
+#else
+#include "reader.h"
+#if defined(F710_READBATCH)
+#define BACKEND "select_batch"
+#elif defined(F710_READLOOP)
+#define BACKEND "select_readloop"
+#else
+#define BACKEND "select_single"
+#endif
+#endif
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+    constexpr int TICK_INTERVAL_MS = 20;
+
+    ///
+    /// Counts applied events and measures the output tick, forwarding to a real ControllerState so the
+    /// model's cost is part of what is measured
+    ///
+    struct BenchState {
+        f710::ControllerState model{
+            f710::AxisDevice(D_AXIS_LEFT_STICK_FWD_BKWD_NUMBER),
+            f710::AxisDevice(D_AXIS_RIGHT_STICK_FWD_BKWD_NUMBER),
+            f710::ToggleButton(D_BUTTON_A)};
+        uint64_t applied = 0;
+        uint64_t ticks = 0;
+        f710::Time last_tick{};
+        f710::LatencyHistogram tick_jitter;
+
+        void apply_event(js_event event)
+        {
+            applied++;
+            model.apply_event(event);
+        }
+        void on_tick()
+        {
+            f710::Time now = f710::Time::now();
+            if (ticks > 0) {
+                int64_t deviation = f710::Time::diff(now, last_tick).nanosecs - f710::Time::from_ms(TICK_INTERVAL_MS).nanosecs;
+                tick_jitter.record((deviation < 0) ? -deviation : deviation);
+            }
+            last_tick = now;
+            ticks++;
+        }
+    };
+
+    struct ThreadUsage {
+        int64_t cpu_ns;
+        int64_t voluntary_switches;
+        int64_t involuntary_switches;
+        int64_t read_syscalls;
+
+        static ThreadUsage now()
+        {
+            rusage ru{};
+            getrusage(RUSAGE_THREAD, &ru);
+            ThreadUsage u{};
+            u.cpu_ns = (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000000LL
+                + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000LL;
+            u.voluntary_switches = ru.ru_nvcsw;
+            u.involuntary_switches = ru.ru_nivcsw;
+            std::ifstream io("/proc/thread-self/io");
+            std::string key;
+            int64_t value;
+            u.read_syscalls = -1;
+            while (io >> key >> value) {
+                if (key == "syscr:") {
+                    u.read_syscalls = value;
+                }
+            }
+            return u;
+        }
+    };
+
+    struct ScenarioResult {
+        std::string name;
+        double seconds = 0;
+        uint64_t events_generated = 0;
+        uint64_t events_applied = 0;
+        ThreadUsage usage{};
+        uint64_t ticks = 0;
+        uint64_t jitter_p50_ns = 0;
+        uint64_t jitter_p99_ns = 0;
+        uint64_t jitter_max_ns = 0;
+        bool has_scheduler = false;
+        uint64_t overruns = 0;
+        uint64_t missed_ticks = 0;
+        uint64_t lateness_p99_ns = 0;
+        uint64_t callback_p99_ns = 0;
+    };
+
+    ///
+    /// Backends that schedule the tick with a PeriodicScheduler also report its view of the ticks
+    ///
+    template <typename R>
+    void collect_scheduler_stats(const R& reader, ScenarioResult& result)
+    {
+        if constexpr (requires { reader.scheduler(); }) {
+            const auto& scheduler = reader.scheduler();
+            result.has_scheduler = true;
+            result.overruns = scheduler.overrun_count();
+            result.missed_ticks = scheduler.missed_count();
+            result.lateness_p99_ns = scheduler.lateness().percentile(0.99);
+            result.callback_p99_ns = scheduler.callback_duration().percentile(0.99);
+        }
+    }
+
+    ///
+    /// Runs a Reader on source until end of stream and collects the thread's usage over the run
+    ///
+    ScenarioResult run_reader(const std::string& name, std::unique_ptr<f710::EventSource> source, uint64_t events_generated)
+    {
+        BenchState state;
+        ScenarioResult result;
+        result.name = name;
+        f710::Reader<BenchState> reader{std::move(source), &state, [](BenchState& s) { s.on_tick(); }, TICK_INTERVAL_MS};
+        ThreadUsage before = ThreadUsage::now();
+        f710::Time start = f710::Time::now();
+        try {
+            reader.run();
+        } catch (const f710::F710EndOfStream&) {
+        }
+        f710::Time end = f710::Time::now();
+        ThreadUsage after = ThreadUsage::now();
+        result.seconds = (double)f710::Time::diff(end, start).nanosecs / 1e9;
+        result.events_generated = events_generated;
+        result.events_applied = state.applied;
+        result.usage = ThreadUsage{
+            after.cpu_ns - before.cpu_ns,
+            after.voluntary_switches - before.voluntary_switches,
+            after.involuntary_switches - before.involuntary_switches,
+            after.read_syscalls - before.read_syscalls};
+        result.ticks = state.ticks;
+        result.jitter_p50_ns = state.tick_jitter.percentile(0.50);
+        result.jitter_p99_ns = state.tick_jitter.percentile(0.99);
+        result.jitter_max_ns = state.tick_jitter.max();
+        collect_scheduler_stats(reader, result);
+        return result;
+    }
+
+    ScenarioResult run_generator(const std::string& name, double events_per_sec, uint64_t event_count)
+    {
+        f710::GeneratorConfig config;
+        config.events_per_sec = events_per_sec;
+        config.event_count = event_count;
+        return run_reader(name, std::make_unique<f710::GeneratorSource>(config), event_count);
+    }
+    ///
+    /// A socketpair nobody writes to, closed after seconds - only the output tick wakes the reader
+    ///
+    ScenarioResult run_idle(double seconds)
+    {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == -1) {
+            throw f710::F710ReadIOError();
+        }
+        std::thread closer([fds, seconds]() {
+            f710::Time due = f710::Time::now().add_ns((int64_t)(seconds * 1e9));
+            timespec ts = due.as_timespec();
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+            }
+            close(fds[1]);
+        });
+        ScenarioResult result = run_reader("idle", std::make_unique<f710::FdSource>(fds[0], "idle"), 0);
+        closer.join();
+        return result;
+    }
+
+    void write_scenario(FILE* out, const ScenarioResult& r, bool last)
+    {
+        const double events = (r.events_generated > 0) ? (double)r.events_generated : 1.0;
+        fprintf(out, "    {\n");
+        fprintf(out, "      \"name\": \"%s\",\n", r.name.c_str());
+        fprintf(out, "      \"seconds\": %.6f,\n", r.seconds);
+        fprintf(out, "      \"events_generated\": %lu,\n", r.events_generated);
+        fprintf(out, "      \"events_applied\": %lu,\n", r.events_applied);
+        fprintf(out, "      \"events_per_sec\": %.1f,\n", (double)r.events_generated / r.seconds);
+        fprintf(out, "      \"cpu_percent\": %.3f,\n", (double)r.usage.cpu_ns / (r.seconds * 1e9) * 100.0);
+        fprintf(out, "      \"read_syscalls\": %ld,\n", r.usage.read_syscalls);
+        fprintf(out, "      \"read_syscalls_per_event\": %.4f,\n", (double)r.usage.read_syscalls / events);
+        fprintf(out, "      \"voluntary_context_switches\": %ld,\n", r.usage.voluntary_switches);
+        fprintf(out, "      \"involuntary_context_switches\": %ld,\n", r.usage.involuntary_switches);
+        fprintf(out, "      \"context_switches_per_event\": %.4f,\n",
+                (double)(r.usage.voluntary_switches + r.usage.involuntary_switches) / events);
+        fprintf(out, "      \"wakeups_per_sec\": %.2f,\n", (double)r.usage.voluntary_switches / r.seconds);
+        fprintf(out, "      \"ticks\": %lu,\n", r.ticks);
+        fprintf(out, "      \"tick_jitter_p50_us\": %.1f,\n", (double)r.jitter_p50_ns / 1000.0);
+        fprintf(out, "      \"tick_jitter_p99_us\": %.1f,\n", (double)r.jitter_p99_ns / 1000.0);
+        if (r.has_scheduler) {
+            fprintf(out, "      \"tick_overruns\": %lu,\n", r.overruns);
+            fprintf(out, "      \"ticks_missed\": %lu,\n", r.missed_ticks);
+            fprintf(out, "      \"tick_lateness_p99_us\": %.1f,\n", (double)r.lateness_p99_ns / 1000.0);
+            fprintf(out, "      \"callback_duration_p99_us\": %.1f,\n", (double)r.callback_p99_ns / 1000.0);
+        }
+        fprintf(out, "      \"tick_jitter_max_us\": %.1f\n", (double)r.jitter_max_ns / 1000.0);
+        fprintf(out, "    }%s\n", last ? "" : ",");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string json_path = (argc > 1) ? argv[1] : std::string("reader_bench_") + BACKEND + ".json";
+    uint64_t saturation_events = (argc > 2) ? strtoull(argv[2], nullptr, 10) : 1000000;
+    double paced_seconds = (argc > 3) ? atof(argv[3]) : 3.0;
+
+    try {
+        std::vector<ScenarioResult> results;
+        results.push_back(run_generator("saturation", 0.0, saturation_events));
+        results.push_back(run_idle(paced_seconds));
+        results.push_back(run_generator("rate_100", 100.0, (uint64_t)(100.0 * paced_seconds)));
+        results.push_back(run_generator("rate_1000", 1000.0, (uint64_t)(1000.0 * paced_seconds)));
+
+        FILE* out = fopen(json_path.c_str(), "w");
+        if (out == nullptr) {
+            perror(json_path.c_str());
+            return 1;
+        }
+        fprintf(out, "{\n  \"backend\": \"%s\",\n  \"tick_interval_ms\": %d,\n  \"scenarios\": [\n", BACKEND, TICK_INTERVAL_MS);
+        for (size_t i = 0; i < results.size(); i++) {
+            write_scenario(out, results[i], i + 1 == results.size());
+        }
+        fprintf(out, "  ]\n}\n");
+        fclose(out);
+        for (auto& r: results) {
+            printf("%-16s %-10s %12.0f events/s  cpu: %6.2f%%  wakeups/s: %8.1f  ticks: %5lu  jitter p99: %9.1f us\n",
+                   BACKEND, r.name.c_str(), (double)r.events_generated / r.seconds,
+                   (double)r.usage.cpu_ns / (r.seconds * 1e9) * 100.0, (double)r.usage.voluntary_switches / r.seconds,
+                   r.ticks, (double)r.jitter_p99_ns / 1000.0);
+        }
+        printf("results written to %s\n", json_path.c_str());
+    } catch (const f710::F710Exception& e) {
+        printf("F710Exception %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,101 @@
+///
+/// Measures session recording and replay (session_recorder.h, session_replay.h).
+///
+/// A synthetic session - the D mode init burst, then both sticks sweeping end to end while button A is
+/// pressed and released - is recorded to a file and then replayed at maximum speed into a ControllerState,
+/// once bare and once with a callback after every event. Whether the two replays leave the model in the
+/// same state is printed here; the pass/fail check is tests/f710/session_replay_test.cpp.
+///
+/// usage: replay_bench [event_count] [path]
+///
+#include "model.h"
+#include "model_defines.h"
+#include "session_recorder.h"
+#include "session_replay.h"
+#include <cstdio>
+#include <cstdlib>
+#include <sys/stat.h>
+
+namespace {
+
+    f710::ControllerState make_state()
+    {
+        return f710::ControllerState{
+            f710::AxisDevice(D_AXIS_LEFT_STICK_FWD_BKWD_NUMBER),
+            f710::AxisDevice(D_AXIS_RIGHT_STICK_FWD_BKWD_NUMBER),
+            f710::ToggleButton(D_BUTTON_A)};
+    }
+
+    void record_synthetic_session(const char* path, uint64_t count)
+    {
+        f710::SessionRecorder recorder{path, "synthetic"};
+        uint32_t t = 1000;
+        for (uint8_t n = 0; n < 12; n++) {
+            recorder.record(js_event{t, 0, JS_EVENT_BUTTON | JS_EVENT_INIT, n});
+        }
+        for (uint8_t n = 0; n < 6; n++) {
+            recorder.record(js_event{t, 0, JS_EVENT_AXIS | JS_EVENT_INIT, n});
+        }
+        for (uint64_t i = 0; i < count; i++) {
+            // about 250 events per second per stick, like a stick being moved continuously
+            if (i % 2 == 0) {
+                t += 2;
+            }
+            if (i % 1000 == 999) {
+                recorder.record(js_event{t, (int16_t)((i / 1000) % 2 == 0), JS_EVENT_BUTTON, D_BUTTON_A});
+                continue;
+            }
+            auto phase = (int32_t)(i % 512) - 256;
+            auto value = (int16_t)(phase * 128 + ((phase < 0) ? 0 : 127));
+            uint8_t number = (i % 2 == 0) ? D_AXIS_LEFT_STICK_FWD_BKWD_NUMBER : D_AXIS_RIGHT_STICK_FWD_BKWD_NUMBER;
+            recorder.record(js_event{t, value, JS_EVENT_AXIS, number});
+        }
+    }
+
+    double seconds_since(f710::Time start)
+    {
+        return (double)f710::Time::diff(f710::Time::now(), start).nanosecs / 1e9;
+    }
+
+    bool same_state(f710::ControllerState& a, f710::ControllerState& b)
+    {
+        return (a.m_left.latest_event_value == b.m_left.latest_event_value)
+            && (a.m_right.latest_event_value == b.m_right.latest_event_value)
+            && (a.m_button.event_toggle_value == b.m_button.event_toggle_value)
+            && (a.m_button.event_state == b.m_button.event_state);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t count = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 4000000;
+    const char* path = (argc > 2) ? argv[2] : "/tmp/f710_replay_bench.f710s";
+
+    f710::Time start = f710::Time::now();
+    record_synthetic_session(path, count);
+    double record_secs = seconds_since(start);
+    struct stat st{};
+    stat(path, &st);
+
+    f710::SessionReplay session{path};
+    auto bare_state = make_state();
+    start = f710::Time::now();
+    uint64_t replayed = session.replay(bare_state, 0.0);
+    double bare_secs = seconds_since(start);
+
+    auto cb_state = make_state();
+    int64_t checksum = 0;
+    start = f710::Time::now();
+    session.replay<f710::ControllerState>(cb_state, 0.0, [&checksum](f710::ControllerState& state) {
+        checksum += state.m_left.latest_event_value - state.m_right.latest_event_value + state.m_button.event_toggle_value;
+    });
+    double cb_secs = seconds_since(start);
+
+    printf("events:                 %lu (%.2f bytes/event on disk)\n", replayed, (double)st.st_size / (double)replayed);
+    printf("record:                 %.1f M events/s\n", (double)replayed / record_secs / 1e6);
+    printf("replay:                 %.1f M events/s\n", (double)replayed / bare_secs / 1e6);
+    printf("replay with callback:   %.1f M events/s (checksum %ld)\n", (double)replayed / cb_secs / 1e6, checksum);
+    printf("deterministic:          %s\n", same_state(bare_state, cb_state) ? "yes" : "NO");
+    unlink(path);
+    return 0;
+}
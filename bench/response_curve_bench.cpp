@@ -0,0 +1,72 @@
+///
+/// Times ResponseTable (response_curve.h) against the scale() function it replaced in main.cpp. That
+/// the two agree for every input is checked by tests/f710/response_curve_test.cpp.
+///
+/// The timed loop maps a pseudo random sequence of axis values, as many as a callback would see in
+/// event_count ticks of two axes, so both are measured with the table competing for cache the way it
+/// would in the real program.
+///
+/// usage: response_curve_bench [value_count]
+///
+#include "f710_time.h"
+#include "response_curve.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+    ///
+    /// scale() exactly as it was in main.cpp
+    ///
+    float scale(bool high_gear, int value) {
+        if (value == 0) {
+            return 0.0;
+        }
+        auto multiplier = (value < 0) ? -1: 1;
+        value = value * multiplier;
+        float pwm;
+        if (high_gear) {
+            pwm = multiplier * (round(((float) value / (float) INT16_MAX) * (85.0 - 50.0)) + 50.0);
+        } else {
+            pwm = multiplier * (round(((float) value / (float) INT16_MAX) * (60.0 - 30.0)) + 30.0);
+        }
+        return pwm;
+    }
+
+    constexpr f710::ResponseCurve LOW = f710::ResponseCurve::band(30, 60);
+    constexpr f710::ResponseCurve HIGH = f710::ResponseCurve::band(50, 85);
+    static constexpr f710::ResponseTable LOW_TABLE{LOW};
+    static constexpr f710::ResponseTable HIGH_TABLE{HIGH};
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t count = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 20000000;
+
+    std::vector<int16_t> values(count);
+    uint32_t x = 12345;
+    for (auto& v: values) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        v = (int16_t)(x >> 8);
+    }
+    double sum = 0;
+    f710::Time start = f710::Time::now();
+    for (size_t i = 0; i < count; i++) {
+        sum += scale((i & 1024) != 0, values[i]);
+    }
+    f710::Time mid = f710::Time::now();
+    int64_t table_sum = 0;
+    for (size_t i = 0; i < count; i++) {
+        const f710::ResponseTable& table = ((i & 1024) != 0) ? HIGH_TABLE : LOW_TABLE;
+        table_sum += table(values[i]);
+    }
+    f710::Time end = f710::Time::now();
+    printf("scale()       %6.2f ns/value\n", (double)f710::Time::diff(mid, start).nanosecs / (double)count);
+    printf("ResponseTable %6.2f ns/value\n", (double)f710::Time::diff(end, mid).nanosecs / (double)count);
+    printf("checksums %.0f %ld %s\n", sum, table_sum, (sum == (double)table_sum) ? "match" : "DIFFER");
+    return 0;
+}
@@ -0,0 +1,157 @@
+///
+/// Runs SerialSink (serial_sink.h) end to end through a Reader against a pty pair: a generator drives
+/// the reader, every 1 ms tick submits a numbered, timestamped command line, and a thread on the master
+/// side of the pty plays the motor controller. It reads either as fast as it can or throttled to a slow
+/// UART's byte rate, checks every line is whole and in order, and records how old each command is on
+/// arrival.
+///
+/// A pty takes about 20 KB before it stops being writable and always reports an empty output queue,
+/// so against the throttled controller the kernel's buffer, not the sink, sets how stale commands get;
+/// the superseded count shows the sink dropping what the pty would not take.
+///
+/// Built once per reader, like reader_bench: serial_bench_select and serial_bench_epoll. The pass/fail
+/// checks are in tests/f710/serial_sink_test.cpp.
+///
+/// usage: serial_bench [seconds] [slow_bytes_per_sec]
+///
+#include "serial_sink.h"
+#include "f710_time.h"
+#include "generator_source.h"
+#include "latency_histogram.h"
+#ifdef EPOLL_READER
+#include "epoll_reader.h"
+#define BACKEND "epoll"
+#else
+#include "reader.h"
+#define BACKEND "select"
+#endif
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <poll.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+    constexpr int TICK_INTERVAL_MS = 1;
+
+    struct CountingState {
+        uint64_t applied = 0;
+        void apply_event(js_event) { applied++; }
+    };
+
+    ///
+    /// The motor controller: reads lines "sequence submit_time_ns" from the pty master
+    ///
+    struct Controller {
+        int fd;
+        double bytes_per_sec;
+        std::atomic<bool> stop{false};
+        uint64_t lines = 0;
+        uint64_t bad_lines = 0;
+        uint64_t out_of_order = 0;
+        f710::LatencyHistogram age{};
+
+        void run()
+        {
+            char line[64];
+            size_t used = 0;
+            uint64_t last_sequence = 0;
+            // throttled reads take at most a 10 ms share of the byte rate at a time
+            auto chunk = (size_t)((bytes_per_sec > 0) ? std::max(1.0, bytes_per_sec / 100.0) : 4096.0);
+            f710::Time next = f710::Time::now();
+            while (!stop.load(std::memory_order_relaxed)) {
+                if (bytes_per_sec > 0) {
+                    next.nanosecs += (int64_t)(1e9 * (double)chunk / bytes_per_sec);
+                    timespec ts = next.as_timespec();
+                    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+                    }
+                } else {
+                    pollfd pfd{fd, POLLIN, 0};
+                    poll(&pfd, 1, 10);
+                }
+                char buffer[4096];
+                ssize_t n = read(fd, buffer, std::min(chunk, sizeof(buffer)));
+                f710::Time now = f710::Time::now();
+                for (ssize_t i = 0; i < n; i++) {
+                    if (buffer[i] != '\n') {
+                        if (used < sizeof(line) - 1) {
+                            line[used++] = buffer[i];
+                        }
+                        continue;
+                    }
+                    line[used] = '\0';
+                    used = 0;
+                    unsigned long long sequence;
+                    long long submitted;
+                    if (sscanf(line, "%llu %lld", &sequence, &submitted) != 2) {
+                        bad_lines++;
+                        continue;
+                    }
+                    lines++;
+                    if (sequence <= last_sequence) {
+                        out_of_order++;
+                    }
+                    last_sequence = sequence;
+                    age.record(now.nanosecs - submitted);
+                }
+            }
+        }
+    };
+
+    void run_scenario(const char* name, double seconds, double bytes_per_sec)
+    {
+        int master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+        if ((master < 0) || (grantpt(master) != 0) || (unlockpt(master) != 0)) {
+            perror("posix_openpt");
+            exit(1);
+        }
+        f710::SerialSink serial{ptsname(master), 0};
+        Controller controller{master, bytes_per_sec};
+        std::thread controller_thread([&controller]() { controller.run(); });
+
+        f710::GeneratorConfig config;
+        config.events_per_sec = 500;
+        config.event_count = (uint64_t)(seconds * config.events_per_sec);
+        CountingState state;
+        uint64_t sequence = 0;
+        f710::Reader<CountingState> reader{std::make_unique<f710::GeneratorSource>(config), &state,
+            [&serial, &sequence](CountingState&) {
+                f710::Time now = f710::Time::now();
+                char line[48];
+                int n = snprintf(line, sizeof(line), "%lu %ld\n", ++sequence, now.nanosecs);
+                serial.submit(line, (size_t)n, now);
+            }, TICK_INTERVAL_MS};
+        reader.add_output_sink(&serial);
+        f710::Time start = f710::Time::now();
+        try {
+            reader.run();
+        } catch (const f710::F710EndOfStream&) {
+        }
+        f710::Time end = f710::Time::now();
+        usleep(200000);
+        controller.stop.store(true);
+        controller_thread.join();
+        close(master);
+
+        printf("%s %s, %.1f s:\n  ", BACKEND, name, (double)f710::Time::diff(end, start).nanosecs / 1e9);
+        serial.print(stdout, end);
+        printf("  controller: %lu lines, %lu torn, %lu out of order\n", controller.lines, controller.bad_lines,
+               controller.out_of_order);
+        controller.age.print(stdout, "  submit to controller");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    double seconds = (argc > 1) ? atof(argv[1]) : 6.0;
+    double slow_rate = (argc > 2) ? atof(argv[2]) : 11520.0;
+    run_scenario("fast controller", seconds, 0);
+    char name[64];
+    snprintf(name, sizeof(name), "controller at %.0f bytes/s", slow_rate);
+    run_scenario(name, seconds, slow_rate);
+    return 0;
+}
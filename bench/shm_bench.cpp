@@ -0,0 +1,176 @@
+///
+/// Measures the shared memory state segment (shm_state.h), with the publisher in a forked process:
+///
+/// -   read() cost with an idle writer, and under a writer publishing as fast as it can; retries
+///     counts how often a read overlapped a publish
+/// -   consistency: every field of what the writer publishes is derived from its publish count, so a
+///     torn copy that got past the seqlock would show up as a mismatch; the count is printed here, the
+///     pass/fail check is tests/f710/shm_state_test.cpp
+/// -   wake latency: the writer publishes at 1 kHz and a reader blocks in wait_for_update(); the time
+///     from publish() to the reader having its copy
+///
+/// usage: shm_bench [seconds]
+///
+#include "shm_state.h"
+#include "f710_time.h"
+#include "latency_histogram.h"
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+    f710::ControllerSnapshot make_snapshot(uint64_t n)
+    {
+        f710::ControllerSnapshot s{};
+        for (int i = 0; i < f710::ControllerSnapshot::MAX_AXES; i++) {
+            s.axis_value[i] = (int16_t)(n + i);
+            s.axis_time[i] = (uint32_t)n;
+        }
+        for (auto& t: s.button_time) {
+            t = (uint32_t)n;
+        }
+        s.pressed = (uint16_t)n;
+        s.toggled = (uint16_t)~n;
+        s.dirty = (uint32_t)n;
+        return s;
+    }
+    bool is_consistent(const f710::SharedControllerState& state)
+    {
+        f710::ControllerSnapshot expected = make_snapshot(state.publish_count);
+        return memcmp(&expected, &state.snapshot, sizeof(expected)) == 0;
+    }
+
+    /// A child process publishing either flat out (period_us 0) or paced, until killed
+    pid_t start_writer(f710::ShmStatePublisher& publisher, int period_us)
+    {
+        pid_t pid = fork();
+        if (pid != 0) {
+            return pid;
+        }
+        f710::Time next = f710::Time::now();
+        for (;;) {
+            if (period_us > 0) {
+                next.nanosecs += (int64_t)period_us * 1000;
+                timespec ts = next.as_timespec();
+                while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+                }
+            }
+            publisher.publish(make_snapshot(publisher.publish_count() + 1), f710::Time::now());
+        }
+    }
+    void stop_writer(pid_t pid)
+    {
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+    }
+
+    struct ReadResult {
+        double mean_ns;
+        uint64_t reads;
+        uint64_t retries;
+        uint64_t distinct;
+    };
+    ReadResult measure_reads(f710::ShmStateReader& reader, double seconds, f710::LatencyHistogram& single)
+    {
+        ReadResult r{};
+        uint64_t retries_before = reader.retry_count();
+        uint64_t last = UINT64_MAX;
+        f710::Time start = f710::Time::now();
+        f710::Time end = start;
+        const int BATCH = 1000;
+        while (f710::Time::diff(end, start).nanosecs < (int64_t)(seconds * 1e9)) {
+            for (int i = 0; i < BATCH; i++) {
+                f710::SharedControllerState state = reader.read();
+                r.distinct += (state.publish_count != last);
+                last = state.publish_count;
+            }
+            r.reads += BATCH;
+            // one read timed on its own per batch, for the tail; includes two clock reads
+            f710::Time before = f710::Time::now();
+            f710::SharedControllerState state = reader.read();
+            end = f710::Time::now();
+            single.record(f710::Time::diff(end, before).nanosecs);
+            r.distinct += (state.publish_count != last);
+            last = state.publish_count;
+        }
+        r.retries = reader.retry_count() - retries_before;
+        r.mean_ns = (double)f710::Time::diff(end, start).nanosecs / (double)r.reads;
+        return r;
+    }
+    void print_reads(const char* name, const ReadResult& r, const f710::LatencyHistogram& single)
+    {
+        printf("%s: %.1f ns per read() over %lu reads (single read incl. clock p50 %lu ns p99 %lu ns), "
+               "%lu retries, %lu distinct publishes seen\n",
+               name, r.mean_ns, r.reads, single.percentile(0.5), single.percentile(0.99), r.retries, r.distinct);
+    }
+    uint64_t check_consistency(f710::ShmStateReader& reader, double seconds, uint64_t& reads)
+    {
+        uint64_t mismatches = 0;
+        f710::Time start = f710::Time::now();
+        while (f710::Time::diff(f710::Time::now(), start).nanosecs < (int64_t)(seconds * 1e9)) {
+            for (int i = 0; i < 1000; i++) {
+                mismatches += !is_consistent(reader.read());
+            }
+            reads += 1000;
+        }
+        return mismatches;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    double seconds = (argc > 1) ? atof(argv[1]) : 2.0;
+    uint64_t mismatches = 0;
+
+    // named after the process so two runs at once do not share a segment
+    std::string segment_name = "/f710_shm_bench_" + std::to_string(getpid());
+    f710::ShmStatePublisher publisher{segment_name};
+    publisher.publish(make_snapshot(1), f710::Time::now());
+    f710::ShmStateReader reader{segment_name};
+    {
+        f710::LatencyHistogram single;
+        print_reads("idle writer", measure_reads(reader, seconds / 2, single), single);
+    }
+    {
+        pid_t writer = start_writer(publisher, 0);
+        f710::LatencyHistogram single;
+        ReadResult r = measure_reads(reader, seconds, single);
+        uint64_t reads = 0;
+        mismatches += check_consistency(reader, seconds, reads);
+        stop_writer(writer);
+        print_reads("continuous writer", r, single);
+        printf("continuous writer: %lu reads checked field by field, %lu inconsistent\n", reads, mismatches);
+    }
+    {
+        pid_t writer = start_writer(publisher, 1000);
+        f710::LatencyHistogram wake;
+        uint64_t last = reader.read().publish_count;
+        uint64_t missed = 0;
+        uint64_t timeouts = 0;
+        f710::Time start = f710::Time::now();
+        while (f710::Time::diff(f710::Time::now(), start).nanosecs < (int64_t)(seconds * 1e9)) {
+            if (!reader.wait_for_update(last, f710::Time::from_ms(100))) {
+                timeouts++;
+                continue;
+            }
+            f710::SharedControllerState state = reader.read();
+            wake.record(f710::Time::now().nanosecs - state.publish_time_ns);
+            if (!is_consistent(state)) {
+                mismatches++;
+            }
+            missed += state.publish_count - last - 1;
+            last = state.publish_count;
+        }
+        stop_writer(writer);
+        printf("1 kHz writer, blocking reader: %lu updates, publish to read p50 %lu us p99 %lu us max %lu us, "
+               "%lu publishes skipped, %lu timeouts\n",
+               wake.count(), wake.percentile(0.5) / 1000, wake.percentile(0.99) / 1000, wake.max() / 1000,
+               missed, timeouts);
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+///
+/// Measures the js_event queue used by queued mode (queued_state.h).
+///
+/// -   saturation: the producer pushes as fast as it can (retrying when full), the consumer spins
+/// -   paced: the producer pushes at a fixed rate and the consumer sleeps on the ConsumerWaker between
+///     events, as QueueConsumer does - this gives the enqueue-to-dequeue latency a real reader sees
+///
+/// The pass/fail checks are in tests/f710/spsc_queue_test.cpp.
+///
+/// usage: spsc_bench [event_count] [paced_events_per_sec]
+///
+#include "queued_state.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    struct Result {
+        double events_per_sec;
+        uint64_t p50_ns;
+        uint64_t p99_ns;
+        uint64_t p999_ns;
+        uint64_t max_ns;
+        uint64_t overflows;
+    };
+
+    uint64_t percentile(std::vector<uint64_t>& sorted, double p)
+    {
+        if (sorted.empty()) {
+            return 0;
+        }
+        size_t index = std::min(sorted.size() - 1, (size_t)(p * (double)sorted.size()));
+        return sorted[index];
+    }
+
+    Result run_once(uint64_t count, uint64_t paced_rate)
+    {
+        auto queue = std::make_unique<f710::EventQueue>();
+        f710::ConsumerWaker waker;
+        std::vector<uint64_t> latencies;
+        latencies.reserve(count);
+
+        std::thread consumer([&]() {
+            f710::QueuedEvent item{};
+            uint64_t received = 0;
+            while (received < count) {
+                if (queue->try_pop(item)) {
+                    latencies.push_back(f710::monotonic_now_ns() - item.enqueue_ns);
+                    received++;
+                } else if (paced_rate != 0) {
+                    waker.wait(1000000, [&]() { return queue->empty(); });
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        const uint64_t start = f710::monotonic_now_ns();
+        const uint64_t period_ns = (paced_rate == 0) ? 0 : 1000000000ULL / paced_rate;
+        for (uint64_t i = 0; i < count; i++) {
+            if (period_ns != 0) {
+                // sleep rather than spin, as a reader blocked in select/epoll would
+                uint64_t due = start + i * period_ns;
+                timespec ts{.tv_sec = (time_t)(due / 1000000000ULL), .tv_nsec = (long)(due % 1000000000ULL)};
+                clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr);
+            }
+            js_event event{.time = (uint32_t)i, .value = (int16_t)(i & 0x7fff), .type = JS_EVENT_AXIS, .number = (uint8_t)(i % 6)};
+            while (!queue->try_push(f710::QueuedEvent{event, f710::monotonic_now_ns()})) {
+                std::this_thread::yield();
+            }
+            waker.notify();
+        }
+        consumer.join();
+        const uint64_t elapsed = f710::monotonic_now_ns() - start;
+
+        std::sort(latencies.begin(), latencies.end());
+        return Result{
+            .events_per_sec = (double)count * 1e9 / (double)elapsed,
+            .p50_ns = percentile(latencies, 0.50),
+            .p99_ns = percentile(latencies, 0.99),
+            .p999_ns = percentile(latencies, 0.999),
+            .max_ns = latencies.empty() ? 0 : latencies.back(),
+            .overflows = queue->overflow_count(),
+        };
+    }
+
+    void print(const char* label, const Result& r)
+    {
+        printf("%-12s events/s: %12.0f  p50: %8lu ns  p99: %8lu ns  p999: %8lu ns  max: %9lu ns  full-queue retries: %lu\n",
+               label, r.events_per_sec, r.p50_ns, r.p99_ns, r.p999_ns, r.max_ns, r.overflows);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t count = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 10000000;
+    uint64_t paced_rate = (argc > 2) ? strtoull(argv[2], nullptr, 10) : 10000;
+    print("saturation", run_once(count, 0));
+    uint64_t paced_count = std::min<uint64_t>(count, paced_rate * 5);
+    print("paced", run_once(paced_count, paced_rate));
+    return 0;
+}
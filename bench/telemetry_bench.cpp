@@ -0,0 +1,310 @@
+///
+/// Runs TelemetrySink (telemetry_sink.h) end to end through a Reader. Its queueing, drops and EPIPE
+/// handling are checked by tests/f710/telemetry_sink_test.cpp, and the epoll reader dropping a broken
+/// sink by tests/f710/epoll_sink_test.cpp. Here a generator drives the reader, every 1 ms tick writes a
+/// numbered, timestamped status line the size of main's, and a thread on the other end of a pipe plays
+/// the terminal. It reads as fast as it can, throttled to a slow link's byte rate, or not at all (a
+/// terminal stopped with ^S), and checks that every line is whole, in order, and that the gaps in the
+/// numbering add up to the drops the sink announced.
+///
+/// The same slow consumer is then run against the previous way of printing - printf to a blocking
+/// stdout - to show what it does to the tick once the pipe is full. A last run writes to a regular
+/// file, which epoll can not watch, so the epoll reader has to flush it itself.
+///
+/// Built once per reader, like reader_bench: telemetry_bench_select and telemetry_bench_epoll.
+///
+/// usage: telemetry_bench [seconds] [slow_bytes_per_sec]
+///
+#include "telemetry_sink.h"
+#include "f710_time.h"
+#include "generator_source.h"
+#include "latency_histogram.h"
+#ifdef EPOLL_READER
+#include "epoll_reader.h"
+#define BACKEND "epoll"
+#else
+#include "reader.h"
+#define BACKEND "select"
+#endif
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+    std::atomic<uint64_t> g_mallocs{0};
+}
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* malloc(size_t size)
+{
+    g_mallocs.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+namespace {
+
+    constexpr int TICK_INTERVAL_MS = 1;
+
+    struct CountingState {
+        uint64_t applied = 0;
+        void apply_event(js_event) { applied++; }
+    };
+
+    enum class Consumer { Fast, Slow, Stalled };
+
+    ///
+    /// The terminal: reads lines "tick sequence submit_time_ns ..." and drop notices from the pipe
+    ///
+    struct Terminal {
+        int fd;
+        Consumer consumer;
+        double bytes_per_sec;
+        std::atomic<bool> stop{false};
+        uint64_t lines = 0;
+        uint64_t bad_lines = 0;
+        uint64_t out_of_order = 0;
+        uint64_t gap_lines = 0;
+        uint64_t notices = 0;
+        uint64_t announced_drops = 0;
+        f710::LatencyHistogram age{};
+
+        void run()
+        {
+            char line[256];
+            size_t used = 0;
+            uint64_t last_sequence = 0;
+            auto chunk = (size_t)((consumer == Consumer::Slow) ? std::max(1.0, bytes_per_sec / 100.0) : 4096.0);
+            f710::Time next = f710::Time::now();
+            while (true) {
+                bool stopping = stop.load(std::memory_order_relaxed);
+                if (consumer == Consumer::Slow && !stopping) {
+                    next.nanosecs += (int64_t)(1e9 * (double)chunk / bytes_per_sec);
+                    timespec ts = next.as_timespec();
+                    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+                    }
+                } else if (consumer == Consumer::Stalled && !stopping) {
+                    usleep(10000);
+                    continue;
+                } else {
+                    pollfd pfd{fd, POLLIN, 0};
+                    if (poll(&pfd, 1, 10) == 0 && stopping) {
+                        return;
+                    }
+                }
+                char buffer[4096];
+                ssize_t n = read(fd, buffer, std::min(chunk, sizeof(buffer)));
+                if (n == 0) {
+                    return;
+                }
+                f710::Time now = f710::Time::now();
+                for (ssize_t i = 0; i < n; i++) {
+                    if (buffer[i] != '\n') {
+                        if (used < sizeof(line) - 1) {
+                            line[used++] = buffer[i];
+                        }
+                        continue;
+                    }
+                    line[used] = '\0';
+                    used = 0;
+                    unsigned long long sequence;
+                    long long submitted;
+                    unsigned long long dropped;
+                    if (sscanf(line, "[telemetry: %llu lines dropped]", &dropped) == 1) {
+                        notices++;
+                        announced_drops += dropped;
+                        continue;
+                    }
+                    if (sscanf(line, "tick %llu %lld", &sequence, &submitted) != 2) {
+                        bad_lines++;
+                        continue;
+                    }
+                    lines++;
+                    if (sequence <= last_sequence) {
+                        out_of_order++;
+                    } else {
+                        gap_lines += sequence - last_sequence - 1;
+                    }
+                    last_sequence = sequence;
+                    age.record(now.nanosecs - submitted);
+                }
+            }
+        }
+    };
+
+    struct TickLine {
+        uint64_t sequence = 0;
+        /// main's status line with a sequence number and the time in front, for the terminal to check
+        template <typename Print>
+        void write(Print&& print)
+        {
+            sequence++;
+            char tn[16];
+            f710::format_time_of_day(tn, sizeof(tn));
+            auto now = f710::Time::now();
+            int raw = (int)(sequence % 65536) - 32768;
+            print("tick %lu %ld from main %s left: %d pwm_left: %f  right: %d pwm_right: %f toggle: %d\n",
+                  sequence, now.nanosecs, tn, raw, (float)raw / 400.0f, -raw, (float)-raw / 400.0f,
+                  (int)(sequence & 1));
+        }
+    };
+
+    f710::GeneratorConfig generator_config(double seconds)
+    {
+        f710::GeneratorConfig config;
+        config.events_per_sec = 500;
+        config.event_count = (uint64_t)(seconds * config.events_per_sec);
+        return config;
+    }
+
+    ///
+    /// Runs the reader for the generator's events, timing each callback and the gap since the previous
+    /// one itself; the epoll reader's timerfd keeps no statistics
+    ///
+    template <typename Callback>
+    void run_reader(double seconds, f710::OutputSink* sink, Callback cb, const char* name)
+    {
+        CountingState state;
+        uint64_t ticks = 0;
+        f710::Time previous{};
+        f710::LatencyHistogram callback;
+        f710::LatencyHistogram gap;
+        f710::Reader<CountingState> reader{std::make_unique<f710::GeneratorSource>(generator_config(seconds)),
+            &state, [&](CountingState& s) {
+                f710::Time t0 = f710::Time::now();
+                if (ticks++ > 0) {
+                    gap.record(f710::Time::diff(t0, previous).nanosecs);
+                }
+                previous = t0;
+                cb(s);
+                callback.record(f710::Time::diff(f710::Time::now(), t0).nanosecs);
+            }, TICK_INTERVAL_MS};
+        if (sink != nullptr) {
+            reader.add_output_sink(sink);
+        }
+        f710::Time start = f710::Time::now();
+        try {
+            reader.run();
+        } catch (const f710::F710EndOfStream&) {
+        }
+        f710::Time end = f710::Time::now();
+        printf("%s %s, %.1f s:\n", BACKEND, name, (double)f710::Time::diff(end, start).nanosecs / 1e9);
+        printf("  ticks %lu of %.0f due\n", ticks, seconds * 1000.0 / TICK_INTERVAL_MS);
+        gap.print(stdout, "  tick to tick");
+        callback.print(stdout, "  callback");
+    }
+
+    void print_terminal(const Terminal& terminal, uint64_t dropped)
+    {
+        printf("  terminal: %lu lines, %lu torn, %lu out of order, %lu missing; %lu of the %lu dropped announced "
+               "in %lu notices\n", terminal.lines, terminal.bad_lines, terminal.out_of_order, terminal.gap_lines,
+               terminal.announced_drops, dropped, terminal.notices);
+        terminal.age.print(stdout, "  line to terminal");
+    }
+
+    void run_sink_scenario(const char* name, double seconds, Consumer consumer, double bytes_per_sec)
+    {
+        int fds[2];
+        if (pipe2(fds, O_CLOEXEC) != 0) {
+            perror("pipe2");
+            exit(1);
+        }
+        Terminal terminal{fds[0], consumer, bytes_per_sec};
+        std::thread terminal_thread([&terminal]() { terminal.run(); });
+        uint64_t line_mallocs = 0;
+        uint64_t dropped = 0;
+        {
+            f710::TelemetrySink sink{fds[1]};
+            f710::LatencyHistogram line_cost;
+            TickLine tick_line;
+            run_reader(seconds, &sink, [&](CountingState&) {
+                tick_line.write([&](const char* format, auto... args) {
+                    uint64_t before = g_mallocs.load(std::memory_order_relaxed);
+                    f710::Time t0 = f710::Time::now();
+                    sink.line(format, args...);
+                    line_cost.record(f710::Time::diff(f710::Time::now(), t0).nanosecs);
+                    line_mallocs += g_mallocs.load(std::memory_order_relaxed) - before;
+                });
+            }, name);
+            line_cost.print(stdout, "  line()");
+            printf("  mallocs in line(): %lu\n  ", line_mallocs);
+            sink.print(stdout);
+            // what is still queued goes once the terminal catches up; drops after the last notice
+            // are only announced by the next line that fits, so those stay unannounced
+            terminal.stop.store(true);
+            for (int i = 0; i < 100 && sink.wants_write(); i++) {
+                sink.on_writable(f710::Time::now());
+                usleep(10000);
+            }
+            dropped = sink.dropped();
+        }
+        close(fds[1]);
+        terminal_thread.join();
+        close(fds[0]);
+        print_terminal(terminal, dropped);
+    }
+
+    void run_printf_scenario(const char* name, double seconds, double bytes_per_sec)
+    {
+        int fds[2];
+        if (pipe2(fds, O_CLOEXEC) != 0) {
+            perror("pipe2");
+            exit(1);
+        }
+        Terminal terminal{fds[0], Consumer::Slow, bytes_per_sec};
+        std::thread terminal_thread([&terminal]() { terminal.run(); });
+        FILE* out = fdopen(fds[1], "w");
+        // what stdout is when it is a terminal
+        setvbuf(out, nullptr, _IOLBF, BUFSIZ);
+        TickLine tick_line;
+        run_reader(seconds, nullptr, [&](CountingState&) {
+            tick_line.write([&](const char* format, auto... args) { fprintf(out, format, args...); });
+        }, name);
+        terminal.stop.store(true);
+        fclose(out);
+        terminal_thread.join();
+        close(fds[0]);
+        print_terminal(terminal, 0);
+    }
+
+    void run_file_scenario(const char* name, double seconds)
+    {
+        FILE* file = tmpfile();
+        uint64_t written;
+        {
+            f710::TelemetrySink sink{fileno(file)};
+            TickLine tick_line;
+            run_reader(seconds, &sink, [&](CountingState&) {
+                tick_line.write([&](const char* format, auto... args) { sink.line(format, args...); });
+            }, name);
+            printf("  ");
+            sink.print(stdout);
+            written = sink.lines() - sink.dropped();
+        }
+        rewind(file);
+        uint64_t in_file = 0;
+        int c;
+        while ((c = fgetc(file)) != EOF) {
+            in_file += (c == '\n') ? 1 : 0;
+        }
+        fclose(file);
+        printf("  file: %lu lines of %lu written\n", in_file, written);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    double seconds = (argc > 1) ? atof(argv[1]) : 4.0;
+    double slow_rate = (argc > 2) ? atof(argv[2]) : 20000.0;
+    run_sink_scenario("telemetry sink, fast terminal", seconds, Consumer::Fast, 0);
+    run_sink_scenario("telemetry sink, slow terminal", seconds, Consumer::Slow, slow_rate);
+    run_sink_scenario("telemetry sink, stopped terminal", seconds, Consumer::Stalled, 0);
+    run_printf_scenario("blocking printf, slow terminal", seconds, slow_rate);
+    run_file_scenario("telemetry sink, regular file", seconds);
+    return 0;
+}
@@ -0,0 +1,134 @@
+///
+/// Measures the UDP drive command link (udp_state.h) over loopback:
+///
+/// -   publish() cost, sending as fast as the receiver drains
+/// -   latency: a forked publisher at 1 kHz, the receiver blocking in poll(); capture to delivery
+///     time, with the loss and reorder counts (all 0 on loopback)
+/// -   redundancy: the receiver throws away a fraction of the datagrams at random, in bursts, before
+///     handling them, and reports how many frames redundancy 0, 1, 2 and 4 get back
+///
+/// The pass/fail checks are in tests/f710/udp_state_test.cpp.
+///
+/// usage: udp_bench [paced_seconds] [drop_percent]
+///
+#include "udp_state.h"
+#include "f710_time.h"
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+    uint32_t xorshift(uint32_t& x)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        return x;
+    }
+    f710::DriveFrame make_frame(uint64_t n)
+    {
+        f710::DriveFrame frame{};
+        frame.left_raw = (int16_t)n;
+        frame.right_raw = (int16_t)-n;
+        frame.left_pwm = (int8_t)(n % 60);
+        frame.right_pwm = (int8_t)-(n % 60);
+        return frame;
+    }
+
+    void measure_publish(uint64_t count)
+    {
+        f710::UdpStateReceiver receiver{0};
+        f710::UdpStatePublisher publisher{"127.0.0.1", receiver.port(), 2};
+        uint64_t delivered = 0;
+        f710::Time start = f710::Time::now();
+        for (uint64_t n = 0; n < count; n++) {
+            publisher.publish(make_frame(n));
+            delivered += receiver.receive([](const f710::DriveFrame&) {});
+        }
+        f710::Time end = f710::Time::now();
+        printf("publish + receive: %.0f ns per frame (redundancy 2), %lu of %lu delivered, %lu send failures\n",
+               (double)f710::Time::diff(end, start).nanosecs / (double)count, delivered, count,
+               publisher.send_failures());
+    }
+
+    void measure_latency(double seconds)
+    {
+        f710::UdpStateReceiver receiver{0};
+        uint16_t port = receiver.port();
+        pid_t pid = fork();
+        if (pid == 0) {
+            f710::UdpStatePublisher publisher{"127.0.0.1", port, 2};
+            f710::Time next = f710::Time::now();
+            for (uint64_t n = 0;; n++) {
+                next = next.add_ms(1);
+                timespec ts = next.as_timespec();
+                while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+                }
+                publisher.publish(make_frame(n));
+            }
+        }
+        f710::Time start = f710::Time::now();
+        while (f710::Time::diff(f710::Time::now(), start).nanosecs < (int64_t)(seconds * 1e9)) {
+            pollfd pfd{receiver.fd(), POLLIN, 0};
+            if (poll(&pfd, 1, 100) > 0) {
+                receiver.receive([](const f710::DriveFrame&) {});
+            }
+        }
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+        printf("1 kHz over loopback for %.1f s: ", seconds);
+        receiver.print(stdout);
+    }
+
+    ///
+    /// Drops datagrams in bursts: each datagram starts a burst with probability drop_fraction / 2, and
+    /// a burst is 1 to 3 datagrams long, so about drop_fraction of them are lost overall
+    ///
+    void measure_redundancy(int redundancy, double drop_fraction, uint64_t count)
+    {
+        f710::UdpStateReceiver receiver{0};
+        f710::UdpStatePublisher publisher{"127.0.0.1", receiver.port(), redundancy};
+        uint32_t seed = 12345;
+        int burst = 0;
+        uint64_t dropped = 0;
+        uint8_t buffer[f710::udp_wire::MAX_PACKET_SIZE + 1];
+        for (uint64_t n = 0; n < count; n++) {
+            publisher.publish(make_frame(n));
+            ssize_t length;
+            while ((length = recv(receiver.fd(), buffer, sizeof(buffer), MSG_DONTWAIT)) >= 0) {
+                if (burst == 0 && (double)(xorshift(seed) % 10000) < drop_fraction / 2.0 * 10000.0) {
+                    burst = 1 + (int)(xorshift(seed) % 3);
+                }
+                if (burst > 0) {
+                    burst--;
+                    dropped++;
+                    continue;
+                }
+                receiver.handle_datagram(buffer, (size_t)length, f710::wall_clock_ns(), [](const f710::DriveFrame&) {});
+            }
+        }
+        printf("redundancy %d: %lu frames, %lu datagrams dropped (%.1f%%), %lu delivered (%lu from redundancy), "
+               "%lu lost (%.2f%%)\n",
+               redundancy, count, dropped, 100.0 * (double)dropped / (double)count, receiver.delivered(),
+               receiver.recovered(), receiver.lost(), 100.0 * (double)receiver.lost() / (double)count);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    double paced_seconds = (argc > 1) ? atof(argv[1]) : 3.0;
+    double drop_fraction = ((argc > 2) ? atof(argv[2]) : 10.0) / 100.0;
+
+    measure_publish(200000);
+    measure_latency(paced_seconds);
+    for (int redundancy: {0, 1, 2, 4}) {
+        measure_redundancy(redundancy, drop_fraction, 200000);
+    }
+    return 0;
+}
@@ -2,27 +2,338 @@
 #include <stdbool.h>
 #include <pthread.h>
 #include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 #include <rbl/logger.h>
-// needed for multi threading
-static bool needs_initialization = true;
-static pthread_mutex_t lock;
+// statically initialised, so there is no first-use race to set it up
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
 
 void rbl_log_function(const char* level, const char* funcname, const char* filename, int line, char* message)
 {
     time_t rawtime;
-    struct tm *timeinfo;
+    struct tm timeinfo;
     time(&rawtime);
-    timeinfo = localtime(&rawtime);
+    localtime_r(&rawtime, &timeinfo);
 
-	if (needs_initialization) {
-		needs_initialization = false;
-		pthread_mutex_init(&lock, NULL);
-	}
 	pthread_mutex_lock(&lock);
-	// here put in locking for multi threaded applications
-	printf("%2d:%2d:%2d %s %s[%d] %s\n", timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec, level, funcname, line, message);
-//    printf("%2d:%2d:%2d %s %s %s[%d] %s\n", timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec, level, funcname, filename, line, message);
+	printf("%2d:%2d:%2d %s %s[%d] %s\n", timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec, level, funcname, line, message);
+//    printf("%2d:%2d:%2d %s %s %s[%d] %s\n", timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec, level, funcname, filename, line, message);
 	pthread_mutex_unlock(&lock);
 
-}
\ No newline at end of file
+}
+
+std::atomic<uint64_t> rbl::log::detail::g_unringed_drops{0};
+std::atomic<uint32_t> rbl::log::detail::g_drain_sleeping{0};
+
+void rbl::log::detail::wake_drain()
+{
+    if (g_drain_sleeping.exchange(0) != 0) {
+        syscall(SYS_futex, (uint32_t*)&g_drain_sleeping, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+    }
+}
+
+namespace {
+
+    constexpr int MAX_THREADS = 8;
+
+    enum RingState : uint8_t { Free, Owned, Released };
+
+    ///
+    /// The rings (a fixed pool, so no thread ever allocates to log) and the thread that empties them.
+    ///
+    /// A thread that exits hands its ring back (Released); the next thread to claim a ring can take it
+    /// once the background thread has printed what was left in it, ie head == tail. head, tail and the
+    /// drop count carry on from where they were. m_claimed is how many rings have ever been used, the
+    /// ones the background thread looks at.
+    ///
+    class Backend {
+        rbl::log::Ring m_rings[MAX_THREADS];
+        std::atomic<uint8_t> m_state[MAX_THREADS]{};
+        std::atomic<int> m_claimed{0};
+        std::atomic<FILE*> m_out{stdout};
+        std::atomic<bool> m_stop{false};
+        std::once_flag m_started;
+        std::thread m_thread;
+    public:
+        Backend() = default;
+        ~Backend()
+        {
+            if (!m_thread.joinable()) {
+                // never started: print what is waiting rather than lose it
+                drain();
+                fflush(m_out.load());
+                return;
+            }
+            m_stop.store(true);
+            rbl::log::detail::wake_drain();
+            m_thread.join();
+        }
+        void start()
+        {
+            std::call_once(m_started, [this]() { m_thread = std::thread([this]() { run(); }); });
+        }
+        rbl::log::Ring* claim()
+        {
+            for (int i = 0; i < claimed(); i++) {
+                uint8_t expected = Released;
+                if ((m_state[i].load(std::memory_order_acquire) == Released)
+                    && (m_rings[i].head.load(std::memory_order_relaxed) == m_rings[i].tail.load(std::memory_order_acquire))
+                    && m_state[i].compare_exchange_strong(expected, Owned, std::memory_order_acquire)) {
+                    return &m_rings[i];
+                }
+            }
+            int index = m_claimed.fetch_add(1, std::memory_order_relaxed);
+            if (index >= MAX_THREADS) {
+                m_claimed.store(MAX_THREADS, std::memory_order_relaxed);
+                return nullptr;
+            }
+            m_state[index].store(Owned, std::memory_order_relaxed);
+            return &m_rings[index];
+        }
+        /// the owning thread is exiting; its ring's last records are still to be printed
+        void release(rbl::log::Ring* ring)
+        {
+            m_state[ring - m_rings].store(Released, std::memory_order_release);
+        }
+        void set_output(FILE* out) { m_out.store(out); }
+        uint64_t dropped() const
+        {
+            uint64_t total = rbl::log::detail::g_unringed_drops.load(std::memory_order_relaxed);
+            for (int i = 0; i < claimed(); i++) {
+                total += m_rings[i].dropped.load(std::memory_order_relaxed);
+            }
+            return total;
+        }
+        void flush()
+        {
+            start();
+            for (int i = 0; i < claimed(); i++) {
+                uint32_t head = m_rings[i].head.load(std::memory_order_acquire);
+                while ((int32_t)(head - m_rings[i].tail.load(std::memory_order_acquire)) > 0) {
+                    rbl::log::detail::wake_drain();
+                    std::this_thread::sleep_for(std::chrono::microseconds(100));
+                }
+            }
+            fflush(m_out.load());
+        }
+    private:
+        int claimed() const { return std::min(m_claimed.load(std::memory_order_acquire), MAX_THREADS); }
+        void run()
+        {
+            while (true) {
+                // read the flag first so the drain that follows it is the last one
+                bool stopping = m_stop.load();
+                size_t count = drain();
+                if (stopping) {
+                    fflush(m_out.load());
+                    return;
+                }
+                if (count == 0) {
+                    fflush(m_out.load());
+                    sleep();
+                }
+            }
+        }
+        bool pending() const
+        {
+            for (int i = 0; i < claimed(); i++) {
+                if (m_rings[i].head.load(std::memory_order_relaxed) != m_rings[i].tail.load(std::memory_order_relaxed)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        /// until a producer or stop wakes the thread, or IDLE_WAKE_MS
+        void sleep()
+        {
+            auto& word = rbl::log::detail::g_drain_sleeping;
+            word.store(1);
+            // pairs with the fence in rbl::log::write() between its head store and its look at the flag
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!pending() && !m_stop.load()) {
+                timespec timeout{0, rbl::log::IDLE_WAKE_MS * 1000000L};
+                syscall(SYS_futex, (uint32_t*)&word, FUTEX_WAIT_PRIVATE, 1, &timeout, nullptr, 0);
+            }
+            word.store(0);
+        }
+        size_t drain()
+        {
+            size_t count = 0;
+            FILE* out = m_out.load();
+            for (int i = 0; i < claimed(); i++) {
+                rbl::log::Ring& ring = m_rings[i];
+                uint32_t tail = ring.tail.load(std::memory_order_relaxed);
+                uint32_t head = ring.head.load(std::memory_order_acquire);
+                for (; tail != head; tail++) {
+                    print_record(out, ring.records[tail % rbl::log::Ring::CAPACITY]);
+                    count++;
+                }
+                ring.tail.store(tail, std::memory_order_release);
+            }
+            return count;
+        }
+        static void print_record(FILE* out, const rbl::log::Record& r);
+    };
+
+    ///
+    /// printf semantics from a stored argument list: the format is walked one conversion at a time and
+    /// each conversion is handed to snprintf on its own with the length modifier its stored kind needs.
+    /// A * width or precision takes the next argument, as printf does, and is written into the
+    /// conversion as digits.
+    ///
+    size_t format_message(const rbl::log::Record& r, char* out, size_t size)
+    {
+        using rbl::log::ArgKind;
+        size_t used = 0;
+        auto append = [&](const char* s, size_t n) {
+            size_t room = (used < size) ? size - used - 1 : 0;
+            size_t k = (n < room) ? n : room;
+            memcpy(out + used, s, k);
+            used += k;
+        };
+        int next_arg = 0;
+        const char* p = r.site->format;
+        while (*p != '\0') {
+            const char* percent = strchr(p, '%');
+            if (percent == nullptr) {
+                append(p, strlen(p));
+                break;
+            }
+            append(p, (size_t)(percent - p));
+            if (percent[1] == '%') {
+                append("%", 1);
+                p = percent + 2;
+                continue;
+            }
+            // %[flags][width][.precision][length]conversion, the length modifier is dropped and replaced
+            char spec[48];
+            size_t n = 0;
+            const char* q = percent;
+            spec[n++] = *q++;
+            while ((*q != '\0') && (strchr("-+ #0123456789.*", *q) != nullptr) && (n < sizeof(spec) - 16)) {
+                if (*q != '*') {
+                    spec[n++] = *q++;
+                    continue;
+                }
+                q++;
+                int value = 0;
+                if ((next_arg < r.arg_count) && (r.kinds[next_arg] == ArgKind::Int || r.kinds[next_arg] == ArgKind::UInt)) {
+                    value = (int)(int64_t)r.args[next_arg];
+                }
+                next_arg++;
+                bool precision = (spec[n - 1] == '.');
+                if (precision && (value < 0)) {
+                    // a negative precision is taken as if it were omitted
+                    n--;
+                    continue;
+                }
+                // a negative width is the - flag and the width, which is what its digits say anyway
+                n += (size_t)snprintf(spec + n, sizeof(spec) - n, "%d", value);
+            }
+            while ((*q != '\0') && (strchr("hlqjzLt", *q) != nullptr)) {
+                q++;
+            }
+            char conversion = *q;
+            if (conversion == '\0') {
+                break;
+            }
+            p = q + 1;
+            char piece[128];
+            int len = 0;
+            if (next_arg >= r.arg_count) {
+                append(percent, (size_t)(p - percent));
+                continue;
+            }
+            ArgKind kind = r.kinds[next_arg];
+            uint64_t bits = r.args[next_arg];
+            if ((r.sizes[next_arg] < 8) && (strchr("ouxX", conversion) != nullptr)) {
+                bits &= (1ULL << (8 * r.sizes[next_arg])) - 1;
+            }
+            next_arg++;
+            if ((kind == ArgKind::Int || kind == ArgKind::UInt) && (strchr("dicouxX", conversion) != nullptr)) {
+                spec[n++] = 'l';
+                spec[n++] = 'l';
+                spec[n++] = conversion;
+                spec[n] = '\0';
+                len = snprintf(piece, sizeof(piece), spec, (long long)bits);
+            } else if ((kind == ArgKind::Double) && (strchr("fFeEgGaA", conversion) != nullptr)) {
+                double d;
+                memcpy(&d, &bits, sizeof(d));
+                spec[n++] = conversion;
+                spec[n] = '\0';
+                len = snprintf(piece, sizeof(piece), spec, d);
+            } else if ((kind == ArgKind::String) && (conversion == 's')) {
+                spec[n++] = 's';
+                spec[n] = '\0';
+                len = snprintf(piece, sizeof(piece), spec, (bits < rbl::log::STRING_BYTES) ? r.strings + bits : "");
+            } else if (conversion == 'p') {
+                len = snprintf(piece, sizeof(piece), "%p", (void*)(uintptr_t)bits);
+            } else if (conversion == 'c') {
+                len = snprintf(piece, sizeof(piece), "%c", (int)bits);
+            } else {
+                // the argument does not suit the conversion; print the raw value rather than guess
+                len = snprintf(piece, sizeof(piece), "<%#llx>", (unsigned long long)bits);
+            }
+            append(piece, (len < 0) ? 0 : ((size_t)len < sizeof(piece) ? (size_t)len : sizeof(piece) - 1));
+        }
+        if (size > 0) {
+            out[(used < size) ? used : size - 1] = '\0';
+        }
+        return used;
+    }
+
+    void Backend::print_record(FILE* out, const rbl::log::Record& r)
+    {
+        char message[512];
+        format_message(r, message, sizeof(message));
+        time_t seconds = (time_t)(r.time_ns / 1000000000LL);
+        struct tm timeinfo;
+        localtime_r(&seconds, &timeinfo);
+        fprintf(out, "%02d:%02d:%02d.%03d %s %s[%d] %s\n", timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec,
+                (int)((r.time_ns / 1000000LL) % 1000), r.site->level_name, r.site->function, r.site->line, message);
+    }
+
+    Backend& backend()
+    {
+        // constructed by the first caller, which neither allocates nor starts the thread
+        static Backend instance;
+        return instance;
+    }
+
+    ///
+    /// One per thread that holds a ring, destroyed as the thread exits
+    ///
+    struct RingReleaser {
+        rbl::log::Ring* ring = nullptr;
+        ~RingReleaser()
+        {
+            if (ring != nullptr) {
+                rbl::log::detail::t_ring = nullptr;
+                backend().release(ring);
+            }
+        }
+    };
+}
+
+void rbl::log::start() { backend().start(); }
+rbl::log::Ring* rbl::log::claim_ring()
+{
+    Ring* ring = backend().claim();
+    if (ring != nullptr) {
+        // registering the destructor is the one allocation a thread makes for logging, on its first call
+        thread_local RingReleaser releaser;
+        releaser.ring = ring;
+    }
+    return ring;
+}
+uint64_t rbl::log::dropped() { return backend().dropped(); }
+void rbl::log::set_output(FILE* out) { backend().set_output(out); }
+void rbl::log::flush() { backend().flush(); }
@@ -2,8 +2,14 @@
 #define rbl_logger_h
 
 #include <stdio.h>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <time.h>
+#include <type_traits>
 
 extern "C" {
+    /// the original synchronous logger: formats and prints on the calling thread under a mutex
     void rbl_log_function(const char* level, const char* funcname, const char* filename, int line, char* message);
 };
 
@@ -14,42 +20,206 @@ extern "C" {
 //
 // RBL_LOG_ERROR - error logging is always on
 //
-#if defined(RBL_LOG_ENABLED) && defined(RBL_LOG_ALLOW_GLOBAL)
-#define RBL_LOG_ERROR(f_, ...) do {\
-		char* s; \
-		int c  = asprintf(&s, f_, ##__VA_ARGS__); \
-		rbl_log_function("ERR", __FUNCTION__, __FILE__, __LINE__, s); \
-		free(s); \
-	} while(0);
+// RBL_LOG_LEVEL - compile time filter: 0 nothing, 1 RBL_LOG_ERROR, 2 also RBL_LOG_FMT, RBL_LOG_MSG and
+// RBL_LOG_PRINTF, 3 also RBL_LOG_ENTRY. Defaults to 3 when the two switches above are on, 1 otherwise.
+// A macro above the level expands to nothing, its arguments are not evaluated.
+//
+// The macros do not format anything. They copy a pointer to a static description of the call site,
+// a timestamp and the raw argument values into a ring buffer owned by the calling thread - no lock,
+// no allocation - and a background thread formats and prints the records. A full ring drops the
+// record and counts it (rbl::log::dropped()). Arguments may be integers, floating point values,
+// pointers and C strings; strings are copied, up to STRING_BYTES per record in total. A * width or
+// precision takes an int argument, as with printf.
+//
+// main calls rbl::log::start() before anything logs, so the background thread is created there and
+// not by some hot thread's first log call. Records logged before start() wait in the rings. The
+// background thread sleeps on a futex when the rings are empty; a producer only makes the wake
+// syscall when it finds the thread asleep and its ring a quarter full, otherwise the thread wakes by
+// itself within IDLE_WAKE_MS.
+//
+namespace rbl::log {
 
-#define RBL_LOG_FMT(f_, ...) do {\
-		char* s; \
-		int c  = asprintf(&s, f_, ##__VA_ARGS__); \
-		rbl_log_function("LOG", __FUNCTION__, __FILE__, __LINE__, s); \
-		free(s); \
-	} while(0);
+    enum class Level : uint8_t { Error = 1, Log = 2, Trace = 3 };
 
+    /// everything about a log statement that is known at compile time, one static instance per statement
+    struct Site {
+        Level level;
+        const char* level_name;
+        const char* format;
+        const char* function;
+        const char* file;
+        int line;
+    };
 
-	#define RBL_LOG_PRINTF(f_, ...) printf((f_), ##__VA_ARGS__)
-	#define RBL_LOG_FMT(f_, ...) do {\
-		char* s; \
-		int c  = asprintf(&s, f_, ##__VA_ARGS__); \
-		rbl_log_function("LOG", __FUNCTION__, __FILE__, __LINE__, s); \
-		free(s); \
-	} while(0);
+    enum class ArgKind : uint8_t { Int, UInt, Double, String, Pointer };
+
+    constexpr int MAX_ARGS = 8;
+    constexpr size_t STRING_BYTES = 48;
+    constexpr int IDLE_WAKE_MS = 10;
+
+    struct Record {
+        const Site* site;
+        int64_t time_ns;
+        uint8_t arg_count;
+        ArgKind kinds[MAX_ARGS];
+        /// sizeof the argument as passed, so %x of a negative int prints 32 bits as printf would
+        uint8_t sizes[MAX_ARGS];
+        /// the value's bits; for a String the offset of its copy in strings
+        uint64_t args[MAX_ARGS];
+        char strings[STRING_BYTES];
+    };
 
-    #define RBL_LOG_ENTRY() do {\
-		rbl_log_function("ENTR", __FUNCTION__, __FILE__, __LINE__, ""); \
-	} while(0);
+    ///
+    /// Single producer single consumer: the owning thread pushes, the background thread pops
+    ///
+    struct alignas(64) Ring {
+        static constexpr uint32_t CAPACITY = 1024;
+        std::atomic<uint32_t> head;
+        alignas(64) std::atomic<uint32_t> tail;
+        alignas(64) std::atomic<uint64_t> dropped;
+        Record records[CAPACITY];
+    };
 
-    #define RBL_LOG_MSG(m)  do {\
-		rbl_log_function("MSG", __FUNCTION__, __FILE__, __LINE__, m); \
-	} while(0);
+    /// starts the background thread; call once from main before the program logs. Later calls do nothing.
+    /// At most 8 threads can log at once (a ring each); a thread that exits frees its ring for the next
+    void start();
+    /// the calling thread's ring, claimed from a fixed pool of 8 on its first log call and handed back
+    /// when the thread exits, for another thread to take once its last records are printed. nullptr
+    /// while every ring is held, and then that thread's records are counted as dropped
+    Ring* claim_ring();
+    /// records dropped because a ring was full or no ring was left
+    uint64_t dropped();
+    /// where the background thread prints, stdout by default
+    void set_output(FILE* out);
+    /// waits until every record pushed so far has been printed, starting the background thread if need be
+    void flush();
 
+    namespace detail {
+        inline thread_local Ring* t_ring = nullptr;
+        extern std::atomic<uint64_t> g_unringed_drops;
+        /// the futex word: 1 while the background thread is asleep
+        extern std::atomic<uint32_t> g_drain_sleeping;
+        /// clears g_drain_sleeping and wakes the background thread
+        void wake_drain();
+
+        inline void encode(Record& r, size_t& strings_used, const char* s)
+        {
+            size_t room = STRING_BYTES - strings_used;
+            r.kinds[r.arg_count] = ArgKind::String;
+            r.sizes[r.arg_count] = sizeof(const char*);
+            r.args[r.arg_count] = strings_used;
+            if (room > 0) {
+                size_t n = (s == nullptr) ? 0 : strnlen(s, room - 1);
+                if (n > 0) {
+                    memcpy(r.strings + strings_used, s, n);
+                }
+                r.strings[strings_used + n] = '\0';
+                strings_used += n + 1;
+            } else {
+                r.args[r.arg_count] = STRING_BYTES;
+            }
+            r.arg_count++;
+        }
+        template <typename T>
+        void encode(Record& r, size_t& strings_used, T value)
+        {
+            using V = std::decay_t<T>;
+            if constexpr (std::is_convertible_v<V, const char*>) {
+                encode(r, strings_used, static_cast<const char*>(value));
+                return;
+            } else if constexpr (std::is_floating_point_v<V>) {
+                auto d = (double)value;
+                r.kinds[r.arg_count] = ArgKind::Double;
+                memcpy(&r.args[r.arg_count], &d, sizeof(d));
+            } else if constexpr (std::is_pointer_v<V>) {
+                r.kinds[r.arg_count] = ArgKind::Pointer;
+                r.args[r.arg_count] = (uint64_t)(uintptr_t)value;
+            } else if constexpr (std::is_signed_v<V> || std::is_enum_v<V>) {
+                r.kinds[r.arg_count] = ArgKind::Int;
+                r.args[r.arg_count] = (uint64_t)(int64_t)value;
+            } else {
+                static_assert(std::is_unsigned_v<V>, "rbl log arguments must be numbers, pointers or C strings");
+                r.kinds[r.arg_count] = ArgKind::UInt;
+                r.args[r.arg_count] = (uint64_t)value;
+            }
+            // a vararg narrower than int arrives as an int, so %x of an int16_t prints 32 bits under printf
+            r.sizes[r.arg_count] = (uint8_t)((sizeof(V) < sizeof(int)) ? sizeof(int) : sizeof(V));
+            r.arg_count++;
+        }
+        /// never called: lets the compiler check the arguments against the format as it would for printf
+        [[gnu::format(printf, 1, 2)]] inline void check_format(const char*, ...) {}
+    }
+
+    template <typename... Args>
+    void write(const Site* site, Args... args)
+    {
+        static_assert(sizeof...(Args) <= MAX_ARGS, "too many arguments for one rbl log statement");
+        Ring* ring = detail::t_ring;
+        if (ring == nullptr) {
+            ring = detail::t_ring = claim_ring();
+            if (ring == nullptr) {
+                detail::g_unringed_drops.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+        uint32_t head = ring->head.load(std::memory_order_relaxed);
+        if (head - ring->tail.load(std::memory_order_acquire) >= Ring::CAPACITY) {
+            ring->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        Record& r = ring->records[head % Ring::CAPACITY];
+        r.site = site;
+        timespec ts{};
+        clock_gettime(CLOCK_REALTIME, &ts);
+        r.time_ns = (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+        r.arg_count = 0;
+        [[maybe_unused]] size_t strings_used = 0;
+        (detail::encode(r, strings_used, args), ...);
+        ring->head.store(head + 1, std::memory_order_release);
+        if (head + 1 - ring->tail.load(std::memory_order_relaxed) >= Ring::CAPACITY / 4) {
+            // pairs with the fence in the background thread between setting the flag and its last look at the rings
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (detail::g_drain_sleeping.load(std::memory_order_relaxed) != 0) {
+                detail::wake_drain();
+            }
+        }
+    }
+}
+
+#define RBL_LOG_AT(level_, name_, f_, ...) do {\
+		static constexpr ::rbl::log::Site rbl_log_site_{level_, name_, f_, __FUNCTION__, __FILE__, __LINE__}; \
+		if (false) { ::rbl::log::detail::check_format(f_, ##__VA_ARGS__); } \
+		::rbl::log::write(&rbl_log_site_, ##__VA_ARGS__); \
+	} while(0)
+
+#ifndef RBL_LOG_LEVEL
+#if defined(RBL_LOG_ENABLED) && defined(RBL_LOG_ALLOW_GLOBAL)
+#define RBL_LOG_LEVEL 3
+#else
+#define RBL_LOG_LEVEL 1
+#endif
+#endif
+
+#if RBL_LOG_LEVEL >= 1
+	#define RBL_LOG_ERROR(f_, ...) RBL_LOG_AT(::rbl::log::Level::Error, "ERR", f_, ##__VA_ARGS__)
+#else
+	#define RBL_LOG_ERROR(f_, ...)
+#endif
+
+#if RBL_LOG_LEVEL >= 2
+	#define RBL_LOG_PRINTF(f_, ...) printf((f_), ##__VA_ARGS__)
+	#define RBL_LOG_FMT(f_, ...) RBL_LOG_AT(::rbl::log::Level::Log, "LOG", f_, ##__VA_ARGS__)
+	#define RBL_LOG_MSG(m) RBL_LOG_AT(::rbl::log::Level::Log, "MSG", "%s", (m))
 #else
 	#define RBL_LOG_PRINTF(f_, ...)
 	#define RBL_LOG_FMT(f_, ...)
-    #define RBL_LOG_ENTRY()
-    #define RBL_LOG_MSG(m)
+	#define RBL_LOG_MSG(m)
+#endif
+
+#if RBL_LOG_LEVEL >= 3
+	#define RBL_LOG_ENTRY() RBL_LOG_AT(::rbl::log::Level::Trace, "ENTR", "")
+#else
+	#define RBL_LOG_ENTRY()
+#endif
+
 #endif
-#endif
\ No newline at end of file
@@ -0,0 +1,230 @@
+#ifndef f710_asio_coro_reader_H
+#define f710_asio_coro_reader_H
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <boost/asio.hpp>
+#include <linux/joystick.h>
+#include "event_source.h"
+#include "f710_exceptions.h"
+#include "f710_time.h"
+#include "handler_arena.h"
+#include "model.h"
+#include "model_defines.h"
+#include "output_policy.h"
+#include "periodic_scheduler.h"
+#include "reader_concept.h"
+
+namespace f710 {
+
+    ///
+    /// A Reader built on boost::asio C++20 coroutines.
+    ///
+    /// Two coroutines share the state on one strand:
+    ///
+    /// -   read_loop: async_read_some into a batch buffer, apply every complete event, repeat
+    /// -   tick_loop: wait for the output deadline, run the callback, repeat
+    ///
+    /// More duties (output, watchdog, telemetry) are more co_spawns onto the same strand, no threads
+    /// or callback chains needed.
+    ///
+    /// Steady state does not allocate. The coroutines, the descriptor and the timer use the concrete
+    /// strand type as their executor, never any_io_executor, and each coroutine's operations draw from
+    /// its own HandlerArena via ArenaAwaitable. Expected errors (end of stream, a timer re-armed
+    /// earlier) are returned through an error_code rather than thrown.
+    ///
+    template <HasApplyEvent ContState>
+    class Reader {
+        using Strand = boost::asio::strand<boost::asio::io_context::executor_type>;
+        using Descriptor = boost::asio::posix::basic_stream_descriptor<Strand>;
+        using Timer = boost::asio::basic_waitable_timer<std::chrono::steady_clock,
+            boost::asio::wait_traits<std::chrono::steady_clock>, Strand>;
+        template <typename T>
+        using Awaitable = boost::asio::awaitable<T, Strand>;
+
+        std::unique_ptr<EventSource> m_source;
+        int m_output_interval_ms;
+        std::function<void(ContState&)> m_on_event_function;
+        ContState *m_controller_state;
+        boost::asio::io_context m_io_context;
+        Strand m_strand;
+        Descriptor m_descriptor;
+        Timer m_timer;
+        OutputPolicy m_output_policy;
+        ChangeDrivenGate m_gate;
+        PeriodicScheduler m_scheduler;
+        Time m_armed_deadline;
+        HandlerArena m_read_arena;
+        HandlerArena m_tick_arena;
+        alignas(js_event) char m_read_buffer[CONST_READ_BATCH_EVENTS * sizeof(js_event)];
+        size_t m_carry_bytes;
+    public:
+        Reader() = delete;
+        explicit Reader(
+            std::string device_path,
+            ContState* controller_state,
+            std::function<void(ContState& state)> on_event_function,
+            int output_interval_ms = 500
+        )
+                : Reader(std::make_unique<DeviceSource>(device_path), controller_state, on_event_function,
+                output_interval_ms)
+        {
+        }
+        /**
+         * Reads from any EventSource instead of the device. run() ends with F710EndOfStream when the
+         * source runs out.
+         */
+        explicit Reader(
+            std::unique_ptr<EventSource> source,
+            ContState* controller_state,
+            std::function<void(ContState& state)> on_event_function,
+            int output_interval_ms = 500
+        )
+                : m_source(std::move(source)), m_output_interval_ms(output_interval_ms),
+                m_on_event_function(on_event_function), m_controller_state(controller_state),
+                m_io_context(1), m_strand(boost::asio::make_strand(m_io_context.get_executor())),
+                m_descriptor(m_strand, m_source->open()), m_timer(m_strand),
+                m_output_policy(OutputPolicy::fixed_interval(output_interval_ms)),
+                m_gate(m_output_policy, Time::now()), m_scheduler(output_interval_ms), m_armed_deadline(),
+                m_read_buffer(), m_carry_bytes(0)
+        {
+        }
+        /**
+         * Replaces the default fixed interval policy, see output_policy.h. Call before run().
+         */
+        void set_output_policy(OutputPolicy policy)
+        {
+            m_output_policy = policy;
+            m_gate = ChangeDrivenGate(policy, Time::now());
+        }
+        /**
+         * What happens to ticks missed by a callback that overran its period, see periodic_scheduler.h.
+         * Call before run().
+         */
+        void set_overrun_policy(PeriodicScheduler::OverrunPolicy policy) { m_scheduler.set_overrun_policy(policy); }
+        /**
+         * Tick counts, lateness and callback duration statistics for the fixed interval mode
+         */
+        const PeriodicScheduler& scheduler() const { return m_scheduler; }
+
+        void run()
+        {
+            auto rethrow = [](std::exception_ptr e) {
+                if (e) {
+                    std::rethrow_exception(e);
+                }
+            };
+            boost::asio::co_spawn(m_strand, read_loop(), rethrow);
+            boost::asio::co_spawn(m_strand, tick_loop(), rethrow);
+            m_io_context.run();
+        }
+        void operator()(){run();};
+        /**
+         * Operation allocations that missed the arenas and went to the heap, 0 in steady state
+         */
+        [[nodiscard]] uint64_t arena_fallback_count() const
+        {
+            return m_read_arena.fallback_count() + m_tick_arena.fallback_count();
+        }
+
+    private:
+        Awaitable<void> read_loop()
+        {
+            boost::system::error_code ec;
+            ArenaAwaitable<Strand> token{&m_read_arena, &ec};
+            while (true) {
+                auto buffer = boost::asio::buffer(m_read_buffer + m_carry_bytes, sizeof(m_read_buffer) - m_carry_bytes);
+                size_t length = co_await m_descriptor.async_read_some(buffer, token);
+                if (ec == boost::asio::error::eof) {
+                    throw F710EndOfStream();
+                } else if (ec) {
+                    throw F710ReadIOError();
+                }
+                apply_buffered_events(m_carry_bytes + length);
+                if (m_output_policy.is_change_driven() && state_has_changed(*m_controller_state)) {
+                    pull_timer_forward();
+                }
+            }
+        }
+
+        Awaitable<void> tick_loop()
+        {
+            boost::system::error_code ec;
+            ArenaAwaitable<Strand> token{&m_tick_arena, &ec};
+            if (!m_output_policy.is_change_driven()) {
+                m_scheduler.start(Time::now(), m_output_policy.interval_ms);
+                while (true) {
+                    arm_timer(m_scheduler.next_deadline());
+                    co_await m_timer.async_wait(token);
+                    Time now = Time::now();
+                    if (m_scheduler.is_due(now)) {
+                        m_scheduler.begin_tick(now);
+                        m_on_event_function(*m_controller_state);
+                        m_scheduler.end_tick(Time::now());
+                    }
+                }
+            }
+            arm_timer(m_gate.next_deadline(false));
+            while (true) {
+                co_await m_timer.async_wait(token);
+                if (ec == boost::asio::error::operation_aborted) {
+                    // read_loop moved the deadline earlier, wait for the new one
+                    continue;
+                }
+                Time now = Time::now();
+                bool changed = state_has_changed(*m_controller_state);
+                if (m_gate.should_fire(now, changed)) {
+                    m_on_event_function(*m_controller_state);
+                    state_clear_changed(*m_controller_state);
+                    m_gate.fired(now);
+                    changed = false;
+                }
+                arm_timer(m_gate.next_deadline(changed));
+            }
+        }
+        ///
+        /// Applies every whole js_event among the first filled bytes of the buffer and moves any
+        /// trailing partial event to the front
+        ///
+        void apply_buffered_events(size_t filled)
+        {
+            const size_t count = filled / sizeof(js_event);
+            for (size_t i = 0; i < count; i++) {
+                js_event event;
+                memcpy(&event, m_read_buffer + i * sizeof(js_event), sizeof(js_event));
+                m_controller_state->apply_event(event);
+            }
+            m_carry_bytes = filled - count * sizeof(js_event);
+            if ((m_carry_bytes > 0) && (count > 0)) {
+                memmove(m_read_buffer, m_read_buffer + count * sizeof(js_event), m_carry_bytes);
+            }
+        }
+        ///
+        /// A change has arrived: if the tick loop is waiting for a later deadline than the gate allows,
+        /// move it earlier. Setting the expiry cancels the pending wait and the tick loop waits again.
+        ///
+        void pull_timer_forward()
+        {
+            Time deadline = m_gate.next_deadline(true);
+            if (Time::is_after(m_armed_deadline, deadline)) {
+                arm_timer(deadline);
+            }
+        }
+
+        ///
+        /// steady_clock is CLOCK_MONOTONIC, the clock Time is read from, so a deadline converts to an expiry
+        /// time directly and the wait ends at the deadline however long ago it was computed
+        ///
+        void arm_timer(Time deadline)
+        {
+            m_armed_deadline = deadline;
+            m_timer.expires_at(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(deadline.nanosecs)));
+        }
+    };
+} //namespace
+
+#endif
@@ -6,6 +6,7 @@
 #include <cinttypes>
 #include <functional>
 #include <dirent.h>
+#include <utility>
 #include <boost/asio.hpp>
 #include <fcntl.h>
 #include <climits>
@@ -18,25 +19,34 @@
 #include <cmath>
 #include <sys/stat.h>
 #include <unistd.h>
+#include "event_source.h"
 #include "f710_time.h"
 #include "f710_exceptions.h"
 #include "model.h"
+#include "model_defines.h"
+#include "reader_concept.h"
+#include "output_policy.h"
+#include "periodic_scheduler.h"
 
 namespace f710 {
 
-    template <typename ContState>
-    concept HasApplyEvent = requires(ContState csref, js_event  arg) {
-        {csref.apply_event(arg)} -> std::same_as<void>;
-    };
-
+    ///
+    /// A Reader built on boost::asio. The fd is a posix::stream_descriptor and each async_read_some pulls
+    /// up to CONST_READ_BATCH_EVENTS js_events; every complete event in the buffer is applied in the one
+    /// completion handler, which then starts the next read directly. Bytes of an event cut short by a
+    /// read (possible on a pipe or socket source, never on the device) are kept and completed by the
+    /// next read.
+    ///
     template <HasApplyEvent ContState>
     class Reader {
         bool m_is_open;
+        std::unique_ptr<EventSource> m_source;
         int m_fd;
-        js_event m_js_event;
-        std::function<void(ContState&)>& m_on_event_function;
+        alignas(js_event) char m_read_buffer[CONST_READ_BATCH_EVENTS * sizeof(js_event)];
+        size_t m_carry_bytes;
+        std::function<void(ContState&)> m_on_event_function;
         boost::asio::io_context m_io_context;
-        boost::asio::serial_port m_serial_port;
+        boost::asio::posix::stream_descriptor m_descriptor;
         boost::asio::steady_timer m_timer;
         int m_button_count;
         int m_axis_count;
@@ -45,6 +55,10 @@ namespace f710 {
         std::string m_joy_dev;
         std::string m_joy_dev_name;
         ContState *m_controller_state;
+        OutputPolicy m_output_policy;
+        ChangeDrivenGate m_gate;
+        PeriodicScheduler m_scheduler;
+        Time m_armed_deadline;
     public:
         Reader() = delete;
         explicit Reader(
@@ -53,27 +67,69 @@ namespace f710 {
             std::function<void(ContState& state)> on_event_function,
             int output_interval_ms = 500
         )
-                : m_fd(open_fd_non_blocking(device_path)),
-                m_io_context(boost::asio::io_context()),
-                m_serial_port(boost::asio::serial_port(m_io_context, m_fd)),
-                m_timer(m_io_context, std::chrono::milliseconds(output_interval_ms)),
+                : Reader(std::make_unique<DeviceSource>(device_path), controller_state, on_event_function,
+                output_interval_ms)
+        {
+        }
+        /**
+         * Reads from any EventSource instead of the device. run() ends with F710EndOfStream when the
+         * source runs out.
+         */
+        explicit Reader(
+            std::unique_ptr<EventSource> source,
+            ContState* controller_state,
+            std::function<void(ContState& state)> on_event_function,
+            int output_interval_ms = 500
+        )
+                : m_source(std::move(source)),
+                m_fd(m_source->open()),
+                m_read_buffer(),
+                m_carry_bytes(0),
                 m_on_event_function(on_event_function),
-                m_js_event(),
-                m_axis_count(0),
+                m_io_context(boost::asio::io_context()),
+                m_descriptor(m_io_context, m_fd),
+                m_timer(m_io_context),
                 m_button_count(0),
+                m_axis_count(0),
                 m_initialize_done(false),
+                m_output_interval_ms(output_interval_ms),
                 m_controller_state(controller_state),
-                m_output_interval_ms(output_interval_ms)
+                m_output_policy(OutputPolicy::fixed_interval(output_interval_ms)),
+                m_gate(m_output_policy, Time::now()),
+                m_scheduler(output_interval_ms),
+                m_armed_deadline()
         {
-            m_joy_dev_name = device_path;
+            m_joy_dev_name = m_source->name();
             m_is_open = false;
         }
+        /**
+         * Replaces the default fixed interval policy, see output_policy.h. Call before run().
+         */
+        void set_output_policy(OutputPolicy policy)
+        {
+            m_output_policy = policy;
+            m_gate = ChangeDrivenGate(policy, Time::now());
+        }
+        /**
+         * What happens to ticks missed by a callback that overran its period, see periodic_scheduler.h.
+         * Call before run().
+         */
+        void set_overrun_policy(PeriodicScheduler::OverrunPolicy policy) { m_scheduler.set_overrun_policy(policy); }
+        /**
+         * Tick counts, lateness and callback duration statistics for the fixed interval mode
+         */
+        const PeriodicScheduler& scheduler() const { return m_scheduler; }
 
         void run()
         {
             boost::asio::post(m_io_context, [this]() {this->start_read();});
             boost::asio::post(m_io_context, [this]() {
-                m_timer.async_wait([this](const boost::system::error_code& ec){this->handle_timer();});
+                if (m_output_policy.is_change_driven()) {
+                    arm_timer(m_gate.next_deadline(false));
+                } else {
+                    m_scheduler.start(Time::now(), m_output_policy.interval_ms);
+                    arm_timer(m_scheduler.next_deadline());
+                }
             });
             m_io_context.run();
         }
@@ -82,30 +138,86 @@ namespace f710 {
     private:
         void start_read()
         {
-            auto b = boost::asio::mutable_buffer((char*)&m_js_event, sizeof(js_event));
-            char bb[sizeof(js_event)];
-            char* bbptr = &bb[0];
-
-            boost::asio::async_read(m_serial_port, boost::asio::buffer(&(m_js_event), sizeof(js_event)), [this](const boost::system::error_code& ec, std::size_t length) {
-                auto p = &this->m_js_event;
-                if (!ec) {
-                    if (length != sizeof(js_event)) {
-                        throw std::runtime_error("Wrong size of js_event");
-                    }
-                    m_controller_state->apply_event(m_js_event);
-                } else {
-                    throw std::runtime_error("read error");
+            auto buffer = boost::asio::buffer(m_read_buffer + m_carry_bytes, sizeof(m_read_buffer) - m_carry_bytes);
+            m_descriptor.async_read_some(buffer, [this](const boost::system::error_code& ec, std::size_t length) {
+                if (ec == boost::asio::error::eof) {
+                    throw F710EndOfStream();
+                } else if (ec) {
+                    throw F710ReadIOError();
+                }
+                apply_buffered_events(m_carry_bytes + length);
+                if (m_output_policy.is_change_driven() && state_has_changed(*m_controller_state)) {
+                    pull_timer_forward();
                 }
-                boost::asio::post(m_io_context, [this]() {this->start_read();});
+                // the completion handler is never run inline, so starting the next read here can not recurse
+                start_read();
             });
         }
+        ///
+        /// Applies every whole js_event among the first filled bytes of the buffer and moves any
+        /// trailing partial event to the front
+        ///
+        void apply_buffered_events(size_t filled)
+        {
+            const size_t count = filled / sizeof(js_event);
+            for (size_t i = 0; i < count; i++) {
+                js_event event;
+                memcpy(&event, m_read_buffer + i * sizeof(js_event), sizeof(js_event));
+                m_controller_state->apply_event(event);
+            }
+            m_carry_bytes = filled - count * sizeof(js_event);
+            if ((m_carry_bytes > 0) && (count > 0)) {
+                memmove(m_read_buffer, m_read_buffer + count * sizeof(js_event), m_carry_bytes);
+            }
+        }
+
+        void handle_timer(const boost::system::error_code& ec)
+        {
+            if (ec == boost::asio::error::operation_aborted) {
+                // the timer was re-armed for an earlier deadline, that wait is the live one
+                return;
+            }
+            if (m_output_policy.is_change_driven()) {
+                Time now = Time::now();
+                bool changed = state_has_changed(*m_controller_state);
+                if (m_gate.should_fire(now, changed)) {
+                    m_on_event_function(*m_controller_state);
+                    state_clear_changed(*m_controller_state);
+                    m_gate.fired(now);
+                    changed = false;
+                }
+                arm_timer(m_gate.next_deadline(changed));
+                return;
+            }
+            Time now = Time::now();
+            if (m_scheduler.is_due(now)) {
+                m_scheduler.begin_tick(now);
+                m_on_event_function(*m_controller_state);
+                m_scheduler.end_tick(Time::now());
+            }
+            arm_timer(m_scheduler.next_deadline());
+        }
+        ///
+        /// A change has arrived: if the armed wait ends later than the gate would allow a callback, move it
+        /// earlier. Re-arming cancels the previous wait.
+        ///
+        void pull_timer_forward()
+        {
+            Time deadline = m_gate.next_deadline(true);
+            if (Time::is_after(m_armed_deadline, deadline)) {
+                arm_timer(deadline);
+            }
+        }
 
-        void handle_timer()
+        ///
+        /// steady_clock is CLOCK_MONOTONIC, the clock Time is read from, so a deadline converts to an expiry
+        /// time directly and the wait ends at the deadline however long ago it was computed
+        ///
+        void arm_timer(Time deadline)
         {
-            m_on_event_function(*m_controller_state);
-            const std::chrono::milliseconds ms{m_output_interval_ms};
-            m_timer.expires_at(m_timer.expiry() + ms);
-            m_timer.async_wait([this](const boost::system::error_code& ec){this->handle_timer();});
+            m_armed_deadline = deadline;
+            m_timer.expires_at(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(deadline.nanosecs)));
+            m_timer.async_wait([this](const boost::system::error_code& ec){this->handle_timer(ec);});
         }
     };
 } //namespace
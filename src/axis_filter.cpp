@@ -0,0 +1,13 @@
+#include "axis_filter.h"
+
+f710::AxisFilter::AxisFilter(const AxisFilterConfig& config)
+    : m_history_1(), m_history_2(), m_ema(), m_output(), m_median(config.median),
+    m_slew_limit(config.max_slew_per_tick > 0), m_primed(false)
+{
+    int alpha = (config.ema_alpha_q10 < 0) ? 0 : (config.ema_alpha_q10 > 1024) ? 1024 : config.ema_alpha_q10;
+    int max_step = (config.max_slew_per_tick > UINT16_MAX) ? UINT16_MAX : config.max_slew_per_tick;
+    for (int i = 0; i < LANES; i++) {
+        m_alpha[i] = alpha;
+        m_max_step[i] = max_step << FRACTION_BITS;
+    }
+}
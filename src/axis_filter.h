@@ -0,0 +1,102 @@
+#ifndef H_f710_axis_filter_H
+#define H_f710_axis_filter_H
+#include <cinttypes>
+#include <cstring>
+
+namespace f710 {
+
+    ///
+    /// The stages of an AxisFilter. Each can be turned off on its own.
+    ///
+    /// -   median: 3-tap median of the raw values, removes a single-tick spike completely; a real step
+    ///     gets through one tick late
+    /// -   ema_alpha_q10: exponential moving average weight of the newest value, in 1/1024ths -
+    ///     1024 passes the value straight through, 256 moves a quarter of the way each tick
+    /// -   max_slew_per_tick: the most the output may move in one tick, in raw axis units; 0 is no limit
+    ///
+    struct AxisFilterConfig {
+        bool median = true;
+        int ema_alpha_q10 = 1024;
+        int max_slew_per_tick = 0;
+    };
+
+    ///
+    /// Filters up to 8 axes at once, once per output tick. The axes are the lanes of one GCC vector, so
+    /// each stage is a handful of vector instructions (SSE on x86, NEON on ARM) whatever the number of axes.
+    ///
+    /// All arithmetic is 32 bit integer: the EMA state carries FRACTION_BITS extra bits and rounds with
+    /// an added half before each shift, and signed right shift is arithmetic under GCC on every target,
+    /// so the same inputs give bit-identical outputs on every machine.
+    ///
+    /// No allocation: the state is six vectors inside the object - the two previous inputs for the
+    /// median, the EMA, the slew limited output and the per-lane alpha and step limit. The first
+    /// apply() primes the history with its input, so the output starts at the current stick positions
+    /// rather than ramping from zero.
+    ///
+    class AxisFilter {
+    public:
+        static constexpr int LANES = 8;
+        static constexpr int FRACTION_BITS = 4;
+        using Vector = int32_t __attribute__((vector_size(LANES * sizeof(int32_t))));
+        using Vector16 = int16_t __attribute__((vector_size(LANES * sizeof(int16_t))));
+    private:
+        Vector m_history_1;
+        Vector m_history_2;
+        Vector m_ema;
+        Vector m_output;
+        Vector m_alpha;
+        Vector m_max_step;
+        bool m_median;
+        bool m_slew_limit;
+        bool m_primed;
+    public:
+        explicit AxisFilter(const AxisFilterConfig& config);
+        /**
+         * Forget the history; the next apply() primes it again
+         */
+        void reset() { m_primed = false; }
+        /**
+         * One tick: raw axis values in, filtered values out. in and out may be the same array.
+         */
+        void apply(const int16_t (&in)[LANES], int16_t (&out)[LANES])
+        {
+            Vector16 packed;
+            memcpy(&packed, in, sizeof(packed));
+            Vector x = __builtin_convertvector(packed, Vector);
+            if (!m_primed) {
+                m_history_1 = x;
+                m_history_2 = x;
+                m_ema = x << FRACTION_BITS;
+                m_output = m_ema;
+                m_primed = true;
+            }
+            Vector v = x;
+            if (m_median) {
+                // median of three is max(min(a, b), min(max(a, b), c)); vector ?: selects per lane
+                Vector low = (m_history_1 < m_history_2) ? m_history_1 : m_history_2;
+                Vector high = (m_history_1 < m_history_2) ? m_history_2 : m_history_1;
+                Vector capped = (high < x) ? high : x;
+                v = (low > capped) ? low : capped;
+                m_history_2 = m_history_1;
+                m_history_1 = x;
+            }
+            Vector target = v << FRACTION_BITS;
+            // |target - ema| < 2^(16 + FRACTION_BITS) and alpha <= 2^10, the product fits in 31 bits
+            m_ema += (m_alpha * (target - m_ema) + (1 << 9)) >> 10;
+            if (m_slew_limit) {
+                Vector step = m_ema - m_output;
+                step = (step > m_max_step) ? m_max_step : step;
+                step = (step < -m_max_step) ? -m_max_step : step;
+                m_output += step;
+            } else {
+                m_output = m_ema;
+            }
+            Vector rounded = (m_output + (1 << (FRACTION_BITS - 1))) >> FRACTION_BITS;
+            packed = __builtin_convertvector(rounded, Vector16);
+            memcpy(out, &packed, sizeof(packed));
+        }
+    };
+
+} //namespace
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef H_f710_controller_state_H
+#define H_f710_controller_state_H
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <tuple>
+#include <utility>
+#include <linux/joystick.h>
+#include "model.h"
+
+namespace f710 {
+
+    ///
+    /// An AxisDevice whose event number is fixed at compile time, for use in BasicControllerState
+    ///
+    template <__u8 N>
+    class Axis : public AxisDevice {
+    public:
+        static constexpr __u8 EVENT_TYPE = JS_EVENT_AXIS;
+        static constexpr __u8 EVENT_NUMBER = N;
+        Axis() : AxisDevice(N) {}
+    };
+
+    ///
+    /// A ToggleButton whose event number is fixed at compile time, for use in BasicControllerState
+    ///
+    template <__u8 N>
+    class Toggle : public ToggleButton {
+    public:
+        static constexpr __u8 EVENT_TYPE = JS_EVENT_BUTTON;
+        static constexpr __u8 EVENT_NUMBER = N;
+        Toggle() : ToggleButton(N) {}
+    };
+
+    ///
+    /// What BasicControllerState needs of a device: the one (type, number) it listens to as compile time
+    /// constants, a way to take an event already known to be for it, a change flag and a disconnect action.
+    ///
+    template <typename D>
+    concept StateDevice = std::default_initializable<D> && requires(D device, js_event event) {
+        {D::EVENT_TYPE} -> std::convertible_to<__u8>;
+        {D::EVENT_NUMBER} -> std::convertible_to<__u8>;
+        {device.apply_matched_event(event)} -> std::same_as<void>;
+        {device.is_new_event} -> std::convertible_to<bool>;
+        {device.on_disconnect()} -> std::same_as<void>;
+    };
+
+    ///
+    /// A controller state model assembled from a list of devices:
+    ///
+    ///     using DriveState = BasicControllerState<Axis<1>, Axis<3>, Toggle<1>>;
+    ///
+    /// Each device's (type, number) is known at compile time, so the dispatch table from event type and
+    /// number to device is built by the compiler. apply_event() is one table lookup and at most one
+    /// device call, whatever the number of devices; events no device listens to cost only the lookup.
+    /// Two devices claiming the same (type, number) is a compile error.
+    ///
+    /// Init events (JS_EVENT_INIT set) are counted. An axis init event carries the stick's current
+    /// position and is applied; a button init event is not, so it can not flip a toggle.
+    ///
+    template <StateDevice... Devices>
+    class BasicControllerState {
+        using DeviceTuple = std::tuple<Devices...>;
+        using Handler = void (*)(DeviceTuple&, js_event);
+        /// indexed by the event type without the init bit (JS_EVENT_BUTTON 1, JS_EVENT_AXIS 2) and number
+        using DispatchTable = std::array<std::array<Handler, 256>, 4>;
+
+        template <size_t I>
+        static void dispatch_to(DeviceTuple& devices, js_event event)
+        {
+            std::get<I>(devices).apply_matched_event(event);
+        }
+        template <size_t... I>
+        static constexpr DispatchTable make_dispatch_table(std::index_sequence<I...>)
+        {
+            DispatchTable table{};
+            ((table[std::tuple_element_t<I, DeviceTuple>::EVENT_TYPE & 0x3]
+                   [std::tuple_element_t<I, DeviceTuple>::EVENT_NUMBER] = &dispatch_to<I>), ...);
+            return table;
+        }
+        static constexpr bool devices_are_distinct()
+        {
+            constexpr std::array<int, sizeof...(Devices)> keys{((Devices::EVENT_TYPE & 0x3) * 256 + Devices::EVENT_NUMBER)...};
+            for (size_t i = 0; i < keys.size(); i++) {
+                for (size_t j = i + 1; j < keys.size(); j++) {
+                    if (keys[i] == keys[j]) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+        static_assert(devices_are_distinct(), "two devices listen to the same event type and number");
+        static_assert((((Devices::EVENT_TYPE == JS_EVENT_AXIS) || (Devices::EVENT_TYPE == JS_EVENT_BUTTON)) && ...),
+                      "a device must listen to JS_EVENT_AXIS or JS_EVENT_BUTTON");
+
+        static constexpr DispatchTable DISPATCH = make_dispatch_table(std::index_sequence_for<Devices...>{});
+
+        DeviceTuple m_devices;
+    public:
+        int button_count = 0;
+        int axis_count = 0;
+
+        BasicControllerState() = default;
+
+        void apply_event(js_event event)
+        {
+            if (event.type & JS_EVENT_INIT) {
+                if (event.type & JS_EVENT_AXIS) {
+                    axis_count++;
+                } else {
+                    button_count++;
+                    return;
+                }
+            }
+            Handler handler = DISPATCH[event.type & 0x3][event.number];
+            if (handler != nullptr) {
+                handler(m_devices, event);
+            }
+        }
+        /**
+         * The device of type D, for example state.get<Axis<1>>()
+         */
+        template <typename D>
+        D& get() { return std::get<D>(m_devices); }
+        template <typename D>
+        const D& get() const { return std::get<D>(m_devices); }
+        /**
+         * The I'th device in the template argument list
+         */
+        template <size_t I>
+        auto& get() { return std::get<I>(m_devices); }
+        template <size_t I>
+        const auto& get() const { return std::get<I>(m_devices); }
+        /**
+         * Every device's on_disconnect(): sticks back to centre, presses in progress dropped
+         */
+        void on_disconnect()
+        {
+            std::apply([](auto&... device) { (device.on_disconnect(), ...); }, m_devices);
+        }
+        /**
+         * True if any device has had a new value or edge since the last clear_changed()
+         */
+        [[nodiscard]] bool has_changed() const
+        {
+            return std::apply([](const auto&... device) { return (device.is_new_event || ...); }, m_devices);
+        }
+        void clear_changed()
+        {
+            std::apply([](auto&... device) { ((device.is_new_event = false), ...); }, m_devices);
+        }
+    };
+
+} //namespace
+
+#endif
@@ -0,0 +1,424 @@
+#ifndef f710_epoll_reader_H
+#define f710_epoll_reader_H
+#include <string>
+#include <functional>
+#include <cerrno>
+#include <assert.h>
+#include <cstring>
+#include <memory>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/joystick.h>
+#include <rbl/simple_exit_guard.h>
+#include "event_source.h"
+#include "f710_helpers.h"
+#include "f710_exceptions.h"
+#include "model.h"
+#include "model_defines.h"
+#include "reader_concept.h"
+#include "output_policy.h"
+#include "output_sink.h"
+
+namespace f710 {
+
+    ///
+    /// A Reader that waits on an epoll instance holding two file descriptors:
+    ///
+    /// -   the joystick device
+    /// -   a timerfd armed with an absolute CLOCK_MONOTONIC start time and a fixed period
+    ///
+    /// The kernel keeps the output tick schedule, so reading js_events can never push the next callback
+    /// later (the select and asio readers get the same from a PeriodicScheduler), and a single epoll_wait
+    /// reports both "events ready" and "tick due".
+    ///
+    /// In hotplug mode (set_hotplug) an inotify fd watching /dev/input is added to the same epoll instance.
+    ///
+    /// With a change-driven output policy (set_output_policy) the timerfd is one-shot instead, armed at
+    /// whichever ChangeDrivenGate deadline comes next, and the gate is asked after every pass of the loop,
+    /// so a change is delivered as soon as the minimum interval allows.
+    ///
+    template <HasApplyEvent ContState>
+        class Reader {
+            bool m_is_open;
+            bool m_hotplug;
+            int m_f710_fd;
+            int m_epoll_fd;
+            OutputPolicy m_output_policy;
+            /// the absolute time the one-shot timerfd is armed for in change-driven mode
+            Time m_timer_deadline;
+            std::function<void(ContState& csref)> m_on_event_function;
+            std::string m_joy_dev_name;
+            ContState *m_controller_state;
+            std::unique_ptr<EventSource> m_source;
+            OutputSink* m_output_sinks[MAX_OUTPUT_SINKS];
+            /// the epoll events currently registered for each output sink's fd
+            uint32_t m_sink_events[MAX_OUTPUT_SINKS];
+            /// false for a sink epoll refuses (a regular file), which is written on every pass instead
+            bool m_sink_pollable[MAX_OUTPUT_SINKS];
+            /// true for a sink taken out of the loop because it failed or its fd reported an error
+            bool m_sink_dropped[MAX_OUTPUT_SINKS];
+            int m_output_sink_count;
+        public:
+            Reader() = delete;
+            explicit Reader(
+                std::string device_path,
+                ContState* controller_state,
+                std::function<void(ContState& csref)> on_event_function,
+                int output_interval_ms = 500
+            )
+                        : Reader(std::make_unique<DeviceSource>(device_path), controller_state, on_event_function,
+                        output_interval_ms)
+            {
+            }
+            /**
+             * Reads from any EventSource instead of the device. run() ends with F710EndOfStream when the
+             * source runs out.
+             */
+            explicit Reader(
+                std::unique_ptr<EventSource> source,
+                ContState* controller_state,
+                std::function<void(ContState& csref)> on_event_function,
+                int output_interval_ms = 500
+            )
+                        : m_is_open(false), m_hotplug(false), m_f710_fd(-1), m_epoll_fd(-1),
+                        m_output_policy(OutputPolicy::fixed_interval(output_interval_ms)), m_timer_deadline(),
+                        m_on_event_function(on_event_function), m_joy_dev_name(source->name()),
+                        m_controller_state(controller_state), m_source(std::move(source)),
+                        m_output_sinks(), m_sink_events(), m_sink_pollable(), m_sink_dropped(), m_output_sink_count(0)
+            {
+            }
+
+            /**
+             * In hotplug mode the reader also watches /dev/input with inotify from inside the epoll loop.
+             * When the device goes away (ENODEV after an RF dropout) the fd is closed, the state is told via
+             * on_disconnect() if it has one, and the output ticks carry on. As soon as a joystick node is
+             * created or made accessible again it is reopened and the init events the driver sends refresh
+             * the state - no sleep, no process restart.
+             * Without hotplug a lost device ends run() with F710ReadIOError as before. Hotplug only applies
+             * to a DeviceSource and is ignored for other sources.
+             */
+            void set_hotplug(bool on) { m_hotplug = on; }
+            /**
+             * Replaces the default fixed interval policy, see output_policy.h. Call before run().
+             */
+            void set_output_policy(OutputPolicy policy) { m_output_policy = policy; }
+            /**
+             * A non-blocking output written from this loop when its fd is writable, see output_sink.h.
+             * Its fd is in the epoll set all the time and asks for EPOLLOUT only while the sink has
+             * something to write. Not owned. Call before run(); false if there are already
+             * MAX_OUTPUT_SINKS.
+             */
+            bool add_output_sink(OutputSink* sink)
+            {
+                if (m_output_sink_count == MAX_OUTPUT_SINKS) {
+                    return false;
+                }
+                m_output_sinks[m_output_sink_count++] = sink;
+                return true;
+            }
+
+            void run()
+            {
+                int inotify_fd = -1;
+                m_f710_fd = -1;
+                exit_guard::Guard guard([this, &inotify_fd]() {
+                    if (m_f710_fd != -1) {
+                        close(m_f710_fd);
+                        m_f710_fd = -1;
+                    }
+                    if (inotify_fd != -1) {
+                        close(inotify_fd);
+                    }
+                });
+                m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+                if (m_epoll_fd == -1) {
+                    throw F710EpollError();
+                }
+                exit_guard::Guard epoll_guard([this]() {close(m_epoll_fd);});
+                if (m_hotplug && !m_source->is_device()) {
+                    m_hotplug = false;
+                }
+                if (m_hotplug) {
+                    ///
+                    /// watch before the first open attempt so a device that appears in between is not missed
+                    ///
+                    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+                    if ((inotify_fd == -1) || (inotify_add_watch(inotify_fd, "/dev/input", IN_CREATE | IN_ATTRIB) == -1)) {
+                        throw F710HotplugError();
+                    }
+                    add_to_epoll(m_epoll_fd, inotify_fd);
+                    try_connect();
+                } else {
+                    m_f710_fd = m_source->open();
+                    add_to_epoll(m_epoll_fd, m_f710_fd);
+                    m_is_open = true;
+                }
+                int timer_fd = m_output_policy.is_change_driven() ? make_one_shot_timer_fd()
+                    : make_periodic_timer_fd(m_output_policy.interval_ms);
+                exit_guard::Guard timer_guard([timer_fd]() {close(timer_fd);});
+                add_to_epoll(m_epoll_fd, timer_fd);
+                ChangeDrivenGate gate(m_output_policy, Time::now());
+                if (m_output_policy.is_change_driven()) {
+                    arm_timer(timer_fd, gate.next_deadline(false));
+                }
+                for (int i = 0; i < m_output_sink_count; i++) {
+                    epoll_event ev{};
+                    ev.data.fd = m_output_sinks[i]->fd();
+                    // -1: a sink with nothing to write to
+                    m_sink_pollable[i] = (ev.data.fd != -1)
+                        && (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, ev.data.fd, &ev) == 0);
+                    if (!m_sink_pollable[i] && (ev.data.fd != -1) && (errno != EPERM)) {
+                        throw F710EpollError();
+                    }
+                    m_sink_events[i] = 0;
+                    m_sink_dropped[i] = false;
+                }
+                while (true) {
+                    update_sink_interest();
+                    epoll_event ready[3 + MAX_OUTPUT_SINKS];
+                    int nready = epoll_wait(m_epoll_fd, ready, 3 + MAX_OUTPUT_SINKS, -1);
+                    if (nready == -1) {
+                        if (errno == EINTR) {
+                            continue;
+                        }
+                        throw F710EpollError();
+                    }
+                    bool tick_due = false;
+                    for (int i = 0; i < nready; i++) {
+                        if ((m_f710_fd != -1) && (ready[i].data.fd == m_f710_fd)) {
+                            read_available_events();
+                        } else if (ready[i].data.fd == timer_fd) {
+                            tick_due = consume_timer_expirations(timer_fd);
+                        } else if (ready[i].data.fd == inotify_fd) {
+                            if (drain_inotify(inotify_fd) && !m_is_open) {
+                                try_connect();
+                            }
+                        } else {
+                            for (int s = 0; s < m_output_sink_count; s++) {
+                                if (m_sink_pollable[s] && (ready[i].data.fd == m_output_sinks[s]->fd())) {
+                                    on_sink_ready(s, ready[i].events);
+                                }
+                            }
+                        }
+                    }
+                    ///
+                    /// Deliver the tick after any events from the same epoll_wait so the callback
+                    /// sees the freshest state
+                    ///
+                    if (m_output_policy.is_change_driven()) {
+                        apply_change_driven_policy(gate, timer_fd, Time::now());
+                    } else if (tick_due) {
+                        m_on_event_function(*m_controller_state);
+                    }
+                    for (int i = 0; i < m_output_sink_count; i++) {
+                        if (!m_sink_pollable[i] && !m_sink_dropped[i] && m_output_sinks[i]->wants_write()) {
+                            m_output_sinks[i]->on_writable(Time::now());
+                        }
+                    }
+                }
+            }
+
+            void operator()(){run();};
+
+        private:
+            ///
+            /// Runs the callback if the gate says so and arms the timer for the next decision point
+            ///
+            void apply_change_driven_policy(ChangeDrivenGate& gate, int timer_fd, Time now)
+            {
+                bool changed = state_has_changed(*m_controller_state);
+                if (gate.should_fire(now, changed)) {
+                    m_on_event_function(*m_controller_state);
+                    state_clear_changed(*m_controller_state);
+                    gate.fired(now);
+                    changed = false;
+                }
+                Time deadline = gate.next_deadline(changed);
+                if (deadline.nanosecs != m_timer_deadline.nanosecs) {
+                    arm_timer(timer_fd, deadline);
+                }
+            }
+            static int make_one_shot_timer_fd()
+            {
+                int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+                if (timer_fd == -1) {
+                    throw F710TimerError();
+                }
+                return timer_fd;
+            }
+            ///
+            /// One expiry at the absolute CLOCK_MONOTONIC time deadline; one already past fires at once
+            ///
+            void arm_timer(int timer_fd, Time deadline)
+            {
+                itimerspec spec{};
+                spec.it_value = deadline.as_timespec();
+                if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr) == -1) {
+                    throw F710TimerError();
+                }
+                m_timer_deadline = deadline;
+            }
+            static void add_to_epoll(int epoll_fd, int fd, uint32_t events = EPOLLIN)
+            {
+                epoll_event ev{};
+                ev.events = events;
+                ev.data.fd = fd;
+                if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+                    throw F710EpollError();
+                }
+            }
+            ///
+            /// Writes a sink epoll reported. EPOLLERR and EPOLLHUP are reported whatever events were
+            /// asked for, so a sink whose consumer has gone (a pipe with no reader, a hung up tty) would
+            /// wake epoll_wait on every call from then on; it gets one last write, to see the error
+            /// for itself, and is taken out of the epoll set, as is a sink that says it has failed.
+            ///
+            void on_sink_ready(int s, uint32_t events)
+            {
+                OutputSink* sink = m_output_sinks[s];
+                if (sink->wants_write()) {
+                    sink->on_writable(Time::now());
+                }
+                if (((events & (EPOLLERR | EPOLLHUP)) != 0) || sink->failed()) {
+                    drop_sink(s);
+                }
+            }
+            void drop_sink(int s)
+            {
+                epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, m_output_sinks[s]->fd(), nullptr);
+                m_sink_pollable[s] = false;
+                m_sink_dropped[s] = true;
+            }
+            ///
+            /// EPOLLOUT is level triggered, so it is only registered while the sink has something to
+            /// write - otherwise an idle writable fd would wake epoll_wait continuously
+            ///
+            void update_sink_interest()
+            {
+                for (int i = 0; i < m_output_sink_count; i++) {
+                    if (!m_sink_pollable[i]) {
+                        continue;
+                    }
+                    if (m_output_sinks[i]->failed()) {
+                        // failed between passes, eg a write-through line() from another thread
+                        drop_sink(i);
+                        continue;
+                    }
+                    uint32_t wanted = m_output_sinks[i]->wants_write() ? (uint32_t)EPOLLOUT : 0u;
+                    if (wanted != m_sink_events[i]) {
+                        epoll_event ev{};
+                        ev.events = wanted;
+                        ev.data.fd = m_output_sinks[i]->fd();
+                        if (epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, m_output_sinks[i]->fd(), &ev) == -1) {
+                            throw F710EpollError();
+                        }
+                        m_sink_events[i] = wanted;
+                    }
+                }
+            }
+            ///
+            /// Pulls everything the driver has buffered using reads of up to CONST_READ_BATCH_EVENTS
+            /// events each. A short read means the kernel buffer is drained so no extra read is
+            /// needed to collect the EAGAIN - the fd is level triggered and will be reported again
+            /// if more events arrive.
+            ///
+            void read_available_events()
+            {
+                js_event events[CONST_READ_BATCH_EVENTS];
+                while (true) {
+                    ssize_t nread = read(m_f710_fd, events, sizeof(events));
+                    int save_errno = errno;
+                    if ((nread == 0) || ((nread == -1) && (save_errno != EAGAIN) && (save_errno != EINTR))) {
+                        if (m_hotplug) {
+                            disconnect();
+                            return;
+                        }
+                        if (nread == 0) {
+                            throw F710EndOfStream();
+                        }
+                        throw F710ReadIOError();
+                    } else if (nread == -1) {
+                        if (save_errno == EINTR) {
+                            continue;
+                        }
+                        return;
+                    }
+                    assert(nread % sizeof(js_event) == 0);
+                    size_t count = nread / sizeof(js_event);
+                    for (size_t i = 0; i < count; i++) {
+                        m_controller_state->apply_event(events[i]);
+                    }
+                    if (count < CONST_READ_BATCH_EVENTS) {
+                        return;
+                    }
+                }
+            }
+
+            void try_connect()
+            {
+                m_f710_fd = m_source->try_open();
+                if (m_f710_fd != -1) {
+                    add_to_epoll(m_epoll_fd, m_f710_fd);
+                    m_is_open = true;
+                }
+            }
+
+            void disconnect()
+            {
+                epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, m_f710_fd, nullptr);
+                close(m_f710_fd);
+                m_f710_fd = -1;
+                m_is_open = false;
+                if constexpr (requires (ContState& cs) { cs.on_disconnect(); }) {
+                    m_controller_state->on_disconnect();
+                }
+                // the node may already be back by the time the read failed
+                try_connect();
+            }
+            ///
+            /// Empties the inotify queue. Returns true if any of the events was for a joystick node.
+            ///
+            static bool drain_inotify(int inotify_fd)
+            {
+                alignas(inotify_event) char buffer[4096];
+                bool joystick_seen = false;
+                while (true) {
+                    ssize_t nread = read(inotify_fd, buffer, sizeof(buffer));
+                    if (nread <= 0) {
+                        if ((nread == -1) && (errno == EINTR)) {
+                            continue;
+                        }
+                        return joystick_seen;
+                    }
+                    for (char* p = buffer; p < buffer + nread; ) {
+                        auto* event = reinterpret_cast<inotify_event*>(p);
+                        if ((event->len > 0) && (strncmp(event->name, "js", 2) == 0)) {
+                            joystick_seen = true;
+                        }
+                        p += sizeof(inotify_event) + event->len;
+                    }
+                }
+            }
+            ///
+            /// Returns true if at least one timer period has elapsed. Missed periods are collapsed
+            /// into a single callback.
+            ///
+            static bool consume_timer_expirations(int timer_fd)
+            {
+                uint64_t expirations = 0;
+                ssize_t nread = read(timer_fd, &expirations, sizeof(expirations));
+                if (nread == -1) {
+                    if ((errno == EAGAIN) || (errno == EINTR)) {
+                        return false;
+                    }
+                    throw F710TimerError();
+                }
+                return (expirations > 0);
+            }
+        };
+} //namespace
+
+#endif
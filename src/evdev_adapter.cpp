@@ -0,0 +1,270 @@
+#include "evdev_adapter.h"
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+    constexpr uint8_t UNMAPPED = 0xff;
+
+    bool test_bit(const unsigned long* bits, int bit)
+    {
+        constexpr int bits_per_long = 8 * sizeof(unsigned long);
+        return (bits[bit / bits_per_long] >> (bit % bits_per_long)) & 1UL;
+    }
+
+    constexpr size_t longs_for(int bit_count)
+    {
+        return (bit_count + 8 * sizeof(unsigned long) - 1) / (8 * sizeof(unsigned long));
+    }
+
+    bool is_gamepad(int fd)
+    {
+        unsigned long ev_bits[longs_for(EV_CNT)] = {};
+        unsigned long key_bits[longs_for(KEY_CNT)] = {};
+        if (ioctl(fd, EVIOCGBIT(0, sizeof(ev_bits)), ev_bits) < 0) {
+            return false;
+        }
+        if (!test_bit(ev_bits, EV_ABS) || !test_bit(ev_bits, EV_KEY)) {
+            return false;
+        }
+        if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(key_bits)), key_bits) < 0) {
+            return false;
+        }
+        return test_bit(key_bits, BTN_GAMEPAD) || test_bit(key_bits, BTN_JOYSTICK);
+    }
+}
+
+namespace f710 {
+
+    std::string get_evdev_by_joy_name(const std::string &joy_name) {
+        const char path[] = "/dev/input";  // no trailing / here
+        struct dirent *entry;
+        struct stat stat_buf;
+
+        DIR *dev_dir = opendir(path);
+        if (dev_dir == nullptr) {
+            printf("Couldn't open %s. Error %i: %s.", path, errno, strerror(errno));
+            return "";
+        }
+        while ((entry = readdir(dev_dir)) != nullptr) {
+            if (strncmp(entry->d_name, "event", 5) != 0) {
+                continue;
+            }
+            std::string current_path = std::string(path) + "/" + entry->d_name;
+            if ((stat(current_path.c_str(), &stat_buf) == -1) || !S_ISCHR(stat_buf.st_mode)) {
+                continue;
+            }
+            int fd = open(current_path.c_str(), O_RDONLY);
+            if (fd == -1) {
+                continue;
+            }
+            char current_joy_name[128] = {};
+            if (ioctl(fd, EVIOCGNAME(sizeof(current_joy_name) - 1), current_joy_name) < 0) {
+                strncpy(current_joy_name, "Unknown", sizeof(current_joy_name) - 1);
+            }
+            bool match = is_gamepad(fd) && (strstr(current_joy_name, joy_name.c_str()) != nullptr);
+            close(fd);
+            if (match) {
+                printf("Found gamepad: %s (%s).\n", current_joy_name, current_path.c_str());
+                closedir(dev_dir);
+                return current_path;
+            }
+        }
+        closedir(dev_dir);
+        return "";
+    }
+
+    int try_open_evdev_non_blocking(std::string device_name)
+    {
+        std::string device_path = (device_name.rfind('/', 0) == 0) ? device_name : get_evdev_by_joy_name(device_name);
+        if (device_path.empty()) {
+            return -1;
+        }
+        int fd = open(device_path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd == -1) {
+            return -1;
+        }
+        int clock_id = CLOCK_MONOTONIC;
+        if (ioctl(fd, EVIOCSCLOCKID, &clock_id) < 0) {
+            perror("calling EVIOCSCLOCKID");
+            close(fd);
+            return -1;
+        }
+        printf("Opened gamepad: %s (%s). ", device_path.c_str(), device_name.c_str());
+        return fd;
+    }
+
+    int open_evdev_non_blocking(std::string device_name)
+    {
+        bool first_fault = true;
+        while (true) {
+            int fd = try_open_evdev_non_blocking(device_name);
+            if (fd != -1) {
+                return fd;
+            }
+            if (first_fault) {
+                printf("Couldn't open gamepad %s. Will retry every second.", device_name.c_str());
+                first_fault = false;
+            }
+            sleep(1);
+        }
+    }
+
+} // namespace f710
+
+f710::EvdevAdapter::EvdevAdapter()
+    : m_fd(-1), m_abs_number(), m_key_number(), m_absinfo(), m_axis_count(0), m_button_count(0),
+    m_dropping(false), m_frame(), m_frame_count(0), m_frame_time_us(0)
+{
+    memset(m_abs_number, UNMAPPED, sizeof(m_abs_number));
+    memset(m_key_number, UNMAPPED, sizeof(m_key_number));
+}
+
+size_t f710::EvdevAdapter::attach(int fd, const js_event** frame)
+{
+    m_fd = fd;
+    m_axis_count = 0;
+    m_button_count = 0;
+    memset(m_abs_number, UNMAPPED, sizeof(m_abs_number));
+    memset(m_key_number, UNMAPPED, sizeof(m_key_number));
+    unsigned long abs_bits[longs_for(ABS_CNT)] = {};
+    unsigned long key_bits[longs_for(KEY_CNT)] = {};
+    ioctl(fd, EVIOCGBIT(EV_ABS, sizeof(abs_bits)), abs_bits);
+    ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(key_bits)), key_bits);
+    // same numbering as joydev_connect()
+    for (int code = 0; code < ABS_CNT; code++) {
+        if (test_bit(abs_bits, code)) {
+            ioctl(fd, EVIOCGABS(code), &m_absinfo[code]);
+            m_abs_number[code] = (uint8_t)m_axis_count++;
+        }
+    }
+    for (int code = BTN_JOYSTICK; code < KEY_CNT && m_button_count < UNMAPPED; code++) {
+        if (test_bit(key_bits, code)) {
+            m_key_number[code] = (uint8_t)m_button_count++;
+        }
+    }
+    for (int code = BTN_MISC; code < BTN_JOYSTICK && m_button_count < UNMAPPED; code++) {
+        if (test_bit(key_bits, code)) {
+            m_key_number[code] = (uint8_t)m_button_count++;
+        }
+    }
+    timespec now{};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    m_frame_time_us = (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+    m_dropping = false;
+    return snapshot(JS_EVENT_INIT, frame);
+}
+
+size_t f710::EvdevAdapter::add(const input_event& event, const js_event** frame)
+{
+    if (event.type == EV_SYN) {
+        if (event.code == SYN_DROPPED) {
+            // the kernel buffer overflowed - everything up to the next SYN_REPORT is unreliable
+            m_dropping = true;
+            m_frame_count = 0;
+            return 0;
+        }
+        if (event.code != SYN_REPORT) {
+            return 0;
+        }
+        m_frame_time_us = (uint64_t)event.input_event_sec * 1000000 + event.input_event_usec;
+        if (m_dropping) {
+            m_dropping = false;
+            return snapshot(0, frame);
+        }
+        size_t count = m_frame_count;
+        m_frame_count = 0;
+        *frame = m_frame;
+        return count;
+    }
+    if (m_dropping) {
+        return 0;
+    }
+    auto time_ms = (uint32_t)(((uint64_t)event.input_event_sec * 1000000 + event.input_event_usec) / 1000);
+    if ((event.type == EV_ABS) && (event.code < ABS_CNT) && (m_abs_number[event.code] != UNMAPPED)) {
+        push(js_event{.time = time_ms, .value = scale_axis(event.code, event.value),
+                      .type = JS_EVENT_AXIS, .number = m_abs_number[event.code]});
+    } else if ((event.type == EV_KEY) && (event.code < KEY_CNT) && (m_key_number[event.code] != UNMAPPED)
+               && (event.value != 2)) { // 2 is autorepeat, joydev drops it too
+        push(js_event{.time = time_ms, .value = (__s16)(event.value ? 1 : 0),
+                      .type = JS_EVENT_BUTTON, .number = m_key_number[event.code]});
+    }
+    return 0;
+}
+
+void f710::EvdevAdapter::push(js_event event)
+{
+    // within a frame a later value for the same input replaces the earlier one (never happens for a
+    // well behaved device, but keeps the frame bounded)
+    for (size_t i = 0; i < m_frame_count; i++) {
+        if ((m_frame[i].type == event.type) && (m_frame[i].number == event.number) && (event.type == JS_EVENT_AXIS)) {
+            m_frame[i] = event;
+            return;
+        }
+    }
+    if (m_frame_count < MAX_FRAME_EVENTS) {
+        m_frame[m_frame_count++] = event;
+    }
+}
+
+/**
+ * Same arithmetic as joydev's default JS_CORR_BROKEN correction
+ */
+int16_t f710::EvdevAdapter::scale_axis(int code, int32_t value) const
+{
+    const input_absinfo& info = m_absinfo[code];
+    int32_t centre = (info.maximum + info.minimum) / 2;
+    int32_t half_range = (info.maximum - info.minimum) / 2 - 2 * info.flat;
+    if (half_range <= 0) {
+        return (int16_t)value;
+    }
+    int64_t coef = (1 << 29) / half_range;
+    int64_t low = centre - info.flat;
+    int64_t high = centre + info.flat;
+    int64_t out;
+    if (value > low) {
+        out = (value < high) ? 0 : ((coef * (value - high)) >> 14);
+    } else {
+        out = (coef * (value - low)) >> 14;
+    }
+    if (out > 32767) {
+        out = 32767;
+    } else if (out < -32767) {
+        out = -32767;
+    }
+    return (int16_t)out;
+}
+
+size_t f710::EvdevAdapter::snapshot(uint8_t type_flags, const js_event** frame)
+{
+    m_frame_count = 0;
+    auto time_ms = (uint32_t)(m_frame_time_us / 1000);
+    unsigned long key_state[longs_for(KEY_CNT)] = {};
+    ioctl(m_fd, EVIOCGKEY(sizeof(key_state)), key_state);
+    for (int pass = 0; pass < 2; pass++) {
+        int first = (pass == 0) ? BTN_JOYSTICK : BTN_MISC;
+        int last = (pass == 0) ? KEY_CNT : BTN_JOYSTICK;
+        for (int code = first; code < last; code++) {
+            if ((m_key_number[code] != UNMAPPED) && (m_frame_count < MAX_FRAME_EVENTS)) {
+                m_frame[m_frame_count++] = js_event{.time = time_ms, .value = (__s16)(test_bit(key_state, code) ? 1 : 0),
+                                                    .type = (__u8)(JS_EVENT_BUTTON | type_flags), .number = m_key_number[code]};
+            }
+        }
+    }
+    for (int code = 0; code < ABS_CNT; code++) {
+        if ((m_abs_number[code] != UNMAPPED) && (m_frame_count < MAX_FRAME_EVENTS)) {
+            ioctl(m_fd, EVIOCGABS(code), &m_absinfo[code]);
+            m_frame[m_frame_count++] = js_event{.time = time_ms, .value = scale_axis(code, m_absinfo[code].value),
+                                                .type = (__u8)(JS_EVENT_AXIS | type_flags), .number = m_abs_number[code]};
+        }
+    }
+    size_t count = m_frame_count;
+    m_frame_count = 0;
+    *frame = m_frame;
+    return count;
+}
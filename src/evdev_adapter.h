@@ -0,0 +1,79 @@
+#ifndef H_f710_evdev_adapter_H
+#define H_f710_evdev_adapter_H
+#include <cinttypes>
+#include <cstddef>
+#include <string>
+#include <linux/input.h>
+#include <linux/joystick.h>
+
+namespace f710 {
+
+/*! \brief Returns the path of the first /dev/input/eventN gamepad whose name contains joy_name
+ *  (an empty joy_name matches any gamepad). If no match is found, an empty string is returned.
+ */
+    std::string get_evdev_by_joy_name(const std::string &joy_name);
+/*! \brief Makes a single attempt to open an evdev gamepad non-blocking and switch its timestamps to
+ *  CLOCK_MONOTONIC. device_name is an absolute path or a name passed to get_evdev_by_joy_name.
+ *  Returns -1 if the device is not there.
+ */
+    int try_open_evdev_non_blocking(std::string device_name);
+/*! \brief As try_open_evdev_non_blocking but retries every second until the device appears.
+ */
+    int open_evdev_non_blocking(std::string device_name);
+
+    ///
+    /// Turns the input_event stream of an evdev gamepad into the js_event stream the joydev driver would
+    /// have produced for the same device, so the existing AxisDevice/ToggleButton/ControllerState model
+    /// can be fed from evdev unchanged.
+    ///
+    /// -   axis and button numbers are assigned exactly as joydev assigns them (axes in ABS code order,
+    ///     buttons from BTN_JOYSTICK upwards then BTN_MISC upwards), so D_/X_ constants still apply
+    /// -   axis values are rescaled from the device's absinfo range to -32767..32767 with its flat zone
+    /// -   js_event.time is the frame's CLOCK_MONOTONIC timestamp in ms; the full µs value is kept in
+    ///     frame_time_us()
+    ///
+    /// Events are collected until SYN_REPORT and only then handed out as one frame, so both sticks
+    /// of a frame are always applied together. A SYN_DROPPED discards the partial frame and the next
+    /// frame is rebuilt from the device's current state.
+    ///
+    class EvdevAdapter {
+    public:
+        static constexpr size_t MAX_FRAME_EVENTS = 64;
+    private:
+        int m_fd;
+        uint8_t m_abs_number[ABS_CNT];
+        uint8_t m_key_number[KEY_CNT];
+        input_absinfo m_absinfo[ABS_CNT];
+        int m_axis_count;
+        int m_button_count;
+        bool m_dropping;
+        js_event m_frame[MAX_FRAME_EVENTS];
+        size_t m_frame_count;
+        uint64_t m_frame_time_us;
+
+        int16_t scale_axis(int code, int32_t value) const;
+        void push(js_event event);
+    public:
+        EvdevAdapter();
+        /**
+         * Reads the axis and button layout of the device and returns the initial state as a frame of
+         * JS_EVENT_INIT events (one per button then one per axis, as joydev sends on open).
+         */
+        size_t attach(int fd, const js_event** frame);
+        /**
+         * Feeds one input_event. Returns the number of events in the completed frame (and sets *frame) when
+         * the event is a SYN_REPORT, otherwise 0.
+         */
+        size_t add(const input_event& event, const js_event** frame);
+        /**
+         * CLOCK_MONOTONIC time in microseconds of the most recently completed frame
+         */
+        [[nodiscard]] uint64_t frame_time_us() const { return m_frame_time_us; }
+        [[nodiscard]] int axis_count() const { return m_axis_count; }
+        [[nodiscard]] int button_count() const { return m_button_count; }
+    private:
+        size_t snapshot(uint8_t type_flags, const js_event** frame);
+    };
+
+} // namespace f710
+#endif
@@ -0,0 +1,159 @@
+#ifndef f710_evdev_reader_H
+#define f710_evdev_reader_H
+#include <string>
+#include <functional>
+#include <cerrno>
+#include <assert.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <linux/input.h>
+#include <linux/joystick.h>
+#include <rbl/simple_exit_guard.h>
+#include "f710_helpers.h"
+#include "f710_exceptions.h"
+#include "evdev_adapter.h"
+#include "model.h"
+#include "model_defines.h"
+#include "reader_concept.h"
+
+namespace f710 {
+
+    ///
+    /// A Reader for the evdev interface (/dev/input/eventN) rather than joydev (/dev/input/jsN).
+    ///
+    /// input_events are read in batches and passed through an EvdevAdapter which turns them into the
+    /// js_events the model already understands. Each SYN_REPORT frame is applied to the state in one
+    /// step, before any callback can run, so a callback never sees one stick of a frame updated and the
+    /// other not. The device is switched to CLOCK_MONOTONIC timestamps; frame_time_us() gives the µs
+    /// capture time of the latest frame for input-age measurement.
+    ///
+    /// The event loop is the same epoll + timerfd arrangement as epoll_reader.h.
+    ///
+    template <HasApplyEvent ContState>
+        class Reader {
+            bool m_is_open;
+            int m_output_interval_ms;
+            std::function<void(ContState& csref)> m_on_event_function;
+            std::string m_joy_dev_name;
+            ContState *m_controller_state;
+            EvdevAdapter m_adapter;
+        public:
+            Reader() = delete;
+            /**
+             * @param device_path   an absolute /dev/input/eventN path, or part of the device name, e.g. "Logitech";
+             *                      an empty string picks the first gamepad
+             */
+            explicit Reader(
+                std::string device_path,
+                ContState* controller_state,
+                std::function<void(ContState& csref)> on_event_function,
+                int output_interval_ms = 500
+            )
+                        : m_is_open(false), m_output_interval_ms(output_interval_ms),
+                        m_on_event_function(on_event_function), m_joy_dev_name(device_path),
+                        m_controller_state(controller_state), m_adapter()
+            {
+            }
+            /**
+             * CLOCK_MONOTONIC capture time in µs of the most recent frame applied to the state
+             */
+            [[nodiscard]] uint64_t frame_time_us() const { return m_adapter.frame_time_us(); }
+
+            void run()
+            {
+                int evdev_fd = open_evdev_non_blocking(m_joy_dev_name);
+                exit_guard::Guard guard([evdev_fd]() {close(evdev_fd);});
+                const js_event* frame;
+                size_t count = m_adapter.attach(evdev_fd, &frame);
+                apply_frame(frame, count);
+                int timer_fd = make_periodic_timer_fd(m_output_interval_ms);
+                exit_guard::Guard timer_guard([timer_fd]() {close(timer_fd);});
+                int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+                if (epoll_fd == -1) {
+                    throw F710EpollError();
+                }
+                exit_guard::Guard epoll_guard([epoll_fd]() {close(epoll_fd);});
+                add_to_epoll(epoll_fd, evdev_fd);
+                add_to_epoll(epoll_fd, timer_fd);
+                m_is_open = true;
+                while (true) {
+                    epoll_event ready[2];
+                    int nready = epoll_wait(epoll_fd, ready, 2, -1);
+                    if (nready == -1) {
+                        if (errno == EINTR) {
+                            continue;
+                        }
+                        throw F710EpollError();
+                    }
+                    bool tick_due = false;
+                    for (int i = 0; i < nready; i++) {
+                        if (ready[i].data.fd == evdev_fd) {
+                            read_available_events(evdev_fd);
+                        } else if (ready[i].data.fd == timer_fd) {
+                            uint64_t expirations = 0;
+                            if (read(timer_fd, &expirations, sizeof(expirations)) == -1) {
+                                if ((errno != EAGAIN) && (errno != EINTR)) {
+                                    throw F710TimerError();
+                                }
+                            }
+                            tick_due = (expirations > 0);
+                        }
+                    }
+                    if (tick_due) {
+                        m_on_event_function(*m_controller_state);
+                    }
+                }
+            }
+
+            void operator()(){run();};
+
+        private:
+            void apply_frame(const js_event* frame, size_t count)
+            {
+                for (size_t i = 0; i < count; i++) {
+                    m_controller_state->apply_event(frame[i]);
+                }
+            }
+
+            void read_available_events(int evdev_fd)
+            {
+                input_event events[CONST_READ_BATCH_EVENTS];
+                while (true) {
+                    ssize_t nread = read(evdev_fd, events, sizeof(events));
+                    int save_errno = errno;
+                    if ((nread == 0) || ((nread == -1) && (save_errno != EAGAIN) && (save_errno != EINTR))) {
+                        throw F710ReadIOError();
+                    } else if (nread == -1) {
+                        if (save_errno == EINTR) {
+                            continue;
+                        }
+                        return;
+                    }
+                    assert(nread % sizeof(input_event) == 0);
+                    size_t count = nread / sizeof(input_event);
+                    for (size_t i = 0; i < count; i++) {
+                        const js_event* frame;
+                        size_t frame_count = m_adapter.add(events[i], &frame);
+                        if (frame_count > 0) {
+                            apply_frame(frame, frame_count);
+                        }
+                    }
+                    if (count < CONST_READ_BATCH_EVENTS) {
+                        return;
+                    }
+                }
+            }
+
+            static void add_to_epoll(int epoll_fd, int fd)
+            {
+                epoll_event ev{};
+                ev.events = EPOLLIN;
+                ev.data.fd = fd;
+                if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+                    throw F710EpollError();
+                }
+            }
+        };
+} //namespace
+
+#endif
@@ -0,0 +1,28 @@
+#include "event_batch.h"
+#include <cinttypes>
+#include <cstring>
+
+size_t f710::collapse_axis_events(js_event* events, size_t count)
+{
+    // one bit for every possible js_event.number
+    uint64_t axis_seen[4] = {0, 0, 0, 0};
+    // walk backwards so the first axis event seen is the latest, packing survivors at the end
+    size_t write_index = count;
+    for (size_t i = count; i > 0; i--) {
+        const js_event& event = events[i - 1];
+        if (event.type == JS_EVENT_AXIS) {
+            uint64_t bit = (uint64_t)1 << (event.number % 64);
+            uint64_t& word = axis_seen[event.number / 64];
+            if (word & bit) {
+                continue;
+            }
+            word |= bit;
+        }
+        events[--write_index] = event;
+    }
+    size_t kept = count - write_index;
+    if (write_index != 0) {
+        memmove(events, events + write_index, kept * sizeof(js_event));
+    }
+    return kept;
+}
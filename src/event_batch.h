@@ -0,0 +1,23 @@
+#ifndef H_f710_event_batch_H
+#define H_f710_event_batch_H
+#include <cstddef>
+#include <linux/joystick.h>
+
+namespace f710 {
+
+    ///
+    /// Compacts, in place, a batch of js_events read from the driver in a single read() call.
+    ///
+    /// -   for each axis (type JS_EVENT_AXIS, number n) only the last event in the batch is kept because
+    ///     the model only remembers the latest value of an axis
+    /// -   button events are all kept, in order, because ToggleButton needs every press/release edge
+    /// -   init events (JS_EVENT_INIT set) are all kept because ControllerState counts them
+    ///
+    /// The relative order of the surviving events is unchanged.
+    /// Returns the number of events left at the front of the array.
+    ///
+    size_t collapse_axis_events(js_event* events, size_t count);
+
+} //namespace
+
+#endif
@@ -0,0 +1,123 @@
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "f710_exceptions.h"
+#include "f710_helpers.h"
+#include "event_source.h"
+
+int f710::DeviceSource::open()
+{
+    return open_fd_non_blocking(m_device_name);
+}
+
+int f710::DeviceSource::try_open()
+{
+    return try_open_fd_non_blocking(m_device_name);
+}
+
+f710::FdSource::~FdSource()
+{
+    if (m_fd != -1) {
+        close(m_fd);
+    }
+}
+
+int f710::FdSource::open()
+{
+    if (m_fd == -1) {
+        throw F710ReadIOError();
+    }
+    int fd = m_fd;
+    m_fd = -1;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    return fd;
+}
+
+f710::ThreadedSource::ThreadedSource() : m_write_fd(-1), m_stop(false), m_batch(), m_batch_count(0)
+{
+}
+
+f710::ThreadedSource::~ThreadedSource()
+{
+    stop();
+}
+
+int f710::ThreadedSource::open()
+{
+    if (m_thread.joinable()) {
+        throw F710ReadIOError();
+    }
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == -1) {
+        throw F710ReadIOError();
+    }
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL, 0) | O_NONBLOCK);
+    m_write_fd = fds[1];
+    m_thread = std::thread([this]() {
+        produce();
+        flush();
+        // the Reader sees end of stream
+        shutdown(m_write_fd, SHUT_WR);
+    });
+    return fds[0];
+}
+
+void f710::ThreadedSource::stop()
+{
+    m_stop.store(true, std::memory_order_relaxed);
+    if (m_thread.joinable()) {
+        // unblocks a send() waiting for the Reader to make room
+        shutdown(m_write_fd, SHUT_RDWR);
+        m_thread.join();
+    }
+    if (m_write_fd != -1) {
+        close(m_write_fd);
+        m_write_fd = -1;
+    }
+}
+
+bool f710::ThreadedSource::write(const js_event& event)
+{
+    m_batch[m_batch_count++] = event;
+    if (m_batch_count == BATCH_EVENTS) {
+        return flush();
+    }
+    return !stopping();
+}
+
+bool f710::ThreadedSource::flush()
+{
+    auto p = (const char*)m_batch;
+    size_t remaining = m_batch_count * sizeof(js_event);
+    m_batch_count = 0;
+    while (remaining > 0) {
+        // MSG_NOSIGNAL: a Reader that has closed its end gives EPIPE, not SIGPIPE
+        ssize_t n = send(m_write_fd, p, remaining, MSG_NOSIGNAL);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += n;
+        remaining -= n;
+    }
+    return !stopping();
+}
+
+bool f710::ThreadedSource::sleep_until(Time due)
+{
+    const int64_t max_step_ns = Time::from_ms(100).nanosecs;
+    while (!stopping()) {
+        Time now = Time::now();
+        if (!Time::is_after(due, now)) {
+            return true;
+        }
+        Time step = (Time::diff(due, now).nanosecs > max_step_ns) ? now.add_ns(max_step_ns) : due;
+        timespec ts = step.as_timespec();
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr);
+    }
+    return false;
+}
@@ -0,0 +1,114 @@
+#ifndef H_f710_event_source_H
+#define H_f710_event_source_H
+#include <atomic>
+#include <cinttypes>
+#include <string>
+#include <thread>
+#include <linux/joystick.h>
+#include "f710_time.h"
+
+namespace f710 {
+
+    ///
+    /// Where a Reader gets its js_events from.
+    ///
+    /// open() returns a readable, O_NONBLOCK file descriptor that delivers whole js_event structs - the
+    /// joystick device itself, or one end of a pipe or socketpair something else writes events into.
+    /// The Reader owns the fd it is given and closes it. A read of 0 bytes on it is end of stream, which
+    /// the Readers report by throwing F710EndOfStream.
+    ///
+    class EventSource {
+    public:
+        virtual ~EventSource() = default;
+        /**
+         * Returns the fd, waiting or retrying for as long as the source needs to become available.
+         * Throws if it never can.
+         */
+        virtual int open() = 0;
+        /**
+         * One attempt without waiting, -1 if the source is not available right now. Used by hotplug.
+         */
+        virtual int try_open() { return open(); }
+        /**
+         * True for a real device node - one that can disappear and come back, so hotplug applies
+         */
+        [[nodiscard]] virtual bool is_device() const { return false; }
+        [[nodiscard]] virtual std::string name() const = 0;
+    };
+
+    ///
+    /// The joystick device - what the Readers always used. device_name is an absolute path or a name
+    /// prefix looked up under /dev/input, see open_fd_non_blocking().
+    ///
+    class DeviceSource: public EventSource {
+        std::string m_device_name;
+    public:
+        explicit DeviceSource(std::string device_name) : m_device_name(std::move(device_name)) {}
+        int open() override;
+        int try_open() override;
+        [[nodiscard]] bool is_device() const override { return true; }
+        [[nodiscard]] std::string name() const override { return m_device_name; }
+    };
+
+    ///
+    /// An fd created by the caller - the read end of a pipe, one end of a socketpair, a FIFO, a file of
+    /// raw js_events. Ownership passes to the Reader on open(), so it can only be opened once. Whatever
+    /// writes into it must write whole js_events.
+    ///
+    class FdSource: public EventSource {
+        int m_fd;
+        std::string m_name;
+    public:
+        explicit FdSource(int fd, std::string name = "fd") : m_fd(fd), m_name(std::move(name)) {}
+        ~FdSource() override;
+        int open() override;
+        [[nodiscard]] std::string name() const override { return m_name; }
+    };
+
+    ///
+    /// Base for sources that produce events on a thread of their own. open() creates a socketpair,
+    /// hands the read end to the Reader and runs produce() on a new thread with the write end. When
+    /// produce() returns the write end is closed and the Reader sees end of stream. Destroying the
+    /// source stops and joins the thread, and a Reader closing its end makes the next write fail, so
+    /// neither side can be left blocked on the other.
+    ///
+    class ThreadedSource: public EventSource {
+        int m_write_fd;
+        std::atomic<bool> m_stop;
+        std::thread m_thread;
+        static constexpr size_t BATCH_EVENTS = 64;
+        js_event m_batch[BATCH_EVENTS];
+        size_t m_batch_count;
+    public:
+        ThreadedSource();
+        ~ThreadedSource() override;
+        int open() override;
+    protected:
+        /**
+         * Derived classes call stop() first thing in their destructor, before their own members go
+         */
+        void stop();
+        /**
+         * Runs on the source thread. Returns when the stream is complete or a write fails.
+         */
+        virtual void produce() = 0;
+        /**
+         * Buffers an event, sending the buffer when it is full. Returns false once the Reader has gone
+         * or stop() was called - produce() should return.
+         */
+        bool write(const js_event& event);
+        /**
+         * Sends whatever is buffered. Paced sources call it after every event so each one arrives at
+         * its due time.
+         */
+        bool flush();
+        /**
+         * Sleeps until due in short steps so stop() is never held up. Returns false if stopped.
+         */
+        bool sleep_until(Time due);
+        [[nodiscard]] bool stopping() const { return m_stop.load(std::memory_order_relaxed); }
+    };
+
+} //namespace
+
+#endif
@@ -25,6 +25,50 @@ namespace f710 {
     class F710ReadIOError: public F710Exception {
     public:
         F710ReadIOError() : F710Exception("io error while reading controller") {}
+    protected:
+        F710ReadIOError(const char* msg) : F710Exception(msg) {}
+    };
+    /// a pipe, socketpair or replay EventSource has delivered its last event
+    class F710EndOfStream: public F710ReadIOError {
+    public:
+        F710EndOfStream() : F710ReadIOError("the event source has reached end of stream") {}
+    };
+    class F710EpollError: public F710Exception {
+    public:
+        F710EpollError() : F710Exception("io error during epoll call") {}
+    };
+    class F710TimerError: public F710Exception {
+    public:
+        F710TimerError() : F710Exception("error while setting up or reading the output timer") {}
+    };
+    class F710HotplugError: public F710Exception {
+    public:
+        F710HotplugError() : F710Exception("could not set up the inotify watch on /dev/input") {}
+    };
+    class F710UringError: public F710Exception {
+    public:
+        F710UringError() : F710Exception("error while setting up or using io_uring") {}
+    };
+    class F710SessionFileError: public F710Exception {
+    public:
+        F710SessionFileError() : F710Exception("could not create, write or parse a session recording") {}
+    };
+    class F710SharedMemoryError: public F710Exception {
+    public:
+        F710SharedMemoryError() : F710Exception("could not create, map or validate the shared state segment") {}
+    };
+    class F710UdpError: public F710Exception {
+    public:
+        F710UdpError() : F710Exception("could not resolve the address or set up the UDP socket") {}
+    };
+    class F710SerialError: public F710Exception {
+    public:
+        F710SerialError() : F710Exception("could not open, configure or write to the serial port") {}
+    };
+    /// thrown by a callback to make run() return, so the caller's objects are destroyed in the normal way
+    class F710StopRequested: public F710Exception {
+    public:
+        F710StopRequested() : F710Exception("stop requested") {}
     };
 
 } // namespace f710
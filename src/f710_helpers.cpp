@@ -13,7 +13,10 @@
 #include <linux/joystick.h>
 #include <cmath>
 #include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <time.h>
 #include <unistd.h>
+#include "f710_exceptions.h"
 
 namespace f710 {
 
@@ -66,31 +69,44 @@ namespace f710 {
         closedir(dev_dir);
         return "";
     }
+    int try_open_fd_non_blocking(std::string device_name)
+    {
+        // an absolute path names one device exactly - needed when more than one joystick is attached
+        std::string device_path = (device_name.rfind('/', 0) == 0) ? device_name : get_dev_by_joy_name(device_name);
+        if (device_path.empty()) {
+            return -1;
+        }
+        int f710_fd = open(device_path.c_str(), O_RDONLY);
+        if (f710_fd != -1) {
+            // There seems to be a bug in the driver or something where the
+            // initial events that are to define the initial state of the
+            // joystick are not the values of the joystick when it was opened
+            // but rather the values of the joystick when it was last closed.
+            // Opening then closing and opening again is a hack to get more
+            // accurate initial state data.
+            close(f710_fd);
+            f710_fd = open(device_path.c_str(), O_RDONLY);
+        }
+        if (f710_fd == -1) {
+            return -1;
+        }
+        // make the f710_fd non-blocking
+        int status = fcntl(f710_fd, F_SETFL, fcntl(f710_fd, F_GETFL, 0) | O_NONBLOCK);
+        if (status == -1){
+            perror("calling fcntl");
+            close(f710_fd);
+            return -1;
+        }
+        printf("Opened joystick: %s (%s). ", device_path.c_str(), device_name.c_str());
+        return f710_fd;
+    }
     int open_fd_non_blocking(std::string device_name)
     {
-        int f710_fd;
-        std::string device_path = get_dev_by_joy_name(device_name);
         bool first_fault = true;
         while (true) {
-            f710_fd = open(device_path.c_str(), O_RDONLY);
+            int f710_fd = try_open_fd_non_blocking(device_name);
             if (f710_fd != -1) {
-                // There seems to be a bug in the driver or something where the
-                // initial events that are to define the initial state of the
-                // joystick are not the values of the joystick when it was opened
-                // but rather the values of the joystick when it was last closed.
-                // Opening then closing and opening again is a hack to get more
-                // accurate initial state data.
-                close(f710_fd);
-                f710_fd = open(device_path.c_str(), O_RDONLY);
-            }
-            if (f710_fd != -1) {
-                // make the f710_fd non-blocking
-                int status = fcntl(f710_fd, F_SETFL, fcntl(f710_fd, F_GETFL, 0) | O_NONBLOCK);
-                if (status == -1){
-                    perror("calling fcntl");
-                    return -1;
-                }
-                break;
+                return f710_fd;
             }
             if (first_fault) {
                 printf("Couldn't open joystick %s. Will retry every second.", device_name.c_str());
@@ -98,16 +114,31 @@ namespace f710 {
             }
             sleep(1.0);
         }
-        // here if we got a device - file descriptor is in joy_fd
+    }
 
-        char current_joy_name[128];
-        if (ioctl(f710_fd, JSIOCGNAME(sizeof(current_joy_name)), current_joy_name) < 0) {
-            strncpy(current_joy_name, "Unknown", sizeof(current_joy_name));
+    int make_periodic_timer_fd(int interval_ms)
+    {
+        int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (timer_fd == -1) {
+            throw F710TimerError();
         }
-
-        printf("Opened joystick: %s (%s). ", device_path.c_str(), device_name.c_str());
-        return f710_fd;
+        timespec start{};
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        const long interval_ns = (long)interval_ms * 1000000L;
+        itimerspec spec{};
+        spec.it_interval.tv_sec = interval_ns / 1000000000L;
+        spec.it_interval.tv_nsec = interval_ns % 1000000000L;
+        spec.it_value.tv_sec = start.tv_sec + spec.it_interval.tv_sec;
+        spec.it_value.tv_nsec = start.tv_nsec + spec.it_interval.tv_nsec;
+        if (spec.it_value.tv_nsec >= 1000000000L) {
+            spec.it_value.tv_sec += 1;
+            spec.it_value.tv_nsec -= 1000000000L;
+        }
+        if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr) == -1) {
+            close(timer_fd);
+            throw F710TimerError();
+        }
+        return timer_fd;
     }
 
-
 } // namespace f710
\ No newline at end of file
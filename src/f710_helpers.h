@@ -9,7 +9,18 @@ namespace f710 {
  *  If no match is found, an empty string is returned.
  */
     std::string get_dev_by_joy_name(const std::string &joy_name);
+/*! \brief Opens a joystick non-blocking, retrying every second until it appears.
+ *  device_name is either an absolute device path such as /dev/input/js1 or a name passed to get_dev_by_joy_name.
+ */
     int open_fd_non_blocking(std::string device_name);
+/*! \brief Makes a single attempt to open a joystick non-blocking.
+ *  Returns -1 if the device is not there (yet) rather than waiting for it.
+ */
+    int try_open_fd_non_blocking(std::string device_name);
+/*! \brief Returns a non-blocking CLOCK_MONOTONIC timerfd that first expires one interval from now and then
+ *  every interval after that, on an absolute schedule kept by the kernel. Throws F710TimerError on failure.
+ */
+    int make_periodic_timer_fd(int interval_ms);
 
 //    class F710Exception: public std::exception
 //    {
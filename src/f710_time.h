@@ -21,60 +21,103 @@
 #include <ctime>
 
 namespace f710 {
+    ///
+    /// A point on the CLOCK_MONOTONIC time line with nanosecond resolution, or a duration on it.
+    ///
+    /// CLOCK_MONOTONIC never jumps when NTP or an operator sets the wall clock, so deadlines and
+    /// timeouts computed from it stay valid. Differences are signed - use remaining() when a
+    /// non-negative timeout is wanted.
+    ///
+    /// Event loops should take one now() per iteration and pass it down rather than calling now()
+    /// wherever a time is needed.
+    ///
     struct Time {
-        uint64_t  millisecs;
+        int64_t  nanosecs;
 
         Time() = default;
 
-        explicit Time(timeval tval) : millisecs(tval.tv_sec*1000 + tval.tv_usec/1000) {}
+        explicit Time(timeval tval) : nanosecs((int64_t)tval.tv_sec * 1000000000LL + (int64_t)tval.tv_usec * 1000LL) {}
+
+        explicit Time(timespec tspec) : nanosecs((int64_t)tspec.tv_sec * 1000000000LL + tspec.tv_nsec) {}
 
         [[nodiscard]] bool is_zero() const {
-            return (millisecs == 0);
+            return (nanosecs == 0);
         }
 
-        static Time from_ms(uint64_t ms) {
+        static Time from_ns(int64_t ns) {
             Time t{};
-            t.millisecs = ms;
+            t.nanosecs = ns;
             return t;
         }
 
+        static Time from_us(int64_t us) {
+            return from_ns(us * 1000LL);
+        }
+
+        static Time from_ms(int64_t ms) {
+            return from_ns(ms * 1000000LL);
+        }
+
         static Time now() {
-            auto tm = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
-            Time t = Time::from_ms(tm);
-            return t;
-//            struct timeval tv{0};
-//            Time t{};
-//            gettimeofday(&tv, nullptr);
-//            t.millisecs = tv.tv_sec * 1000 + tv.tv_usec / 1000;
-//            return t;
+            timespec ts{};
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return Time(ts);
         }
 
-        [[nodiscard]] Time add_ms(uint64_t ms) const
+        [[nodiscard]] int64_t us() const { return nanosecs / 1000LL; }
+
+        [[nodiscard]] int64_t ms() const { return nanosecs / 1000000LL; }
+
+        [[nodiscard]] Time add_ns(int64_t ns) const
         {
-            Time t{};
-            t.millisecs = millisecs + ms;
-            return t;
+            return from_ns(nanosecs + ns);
         }
 
-        static Time diff_ms(Time t1, Time t2)
+        [[nodiscard]] Time add_us(int64_t us) const
         {
-            int64_t d = t1.millisecs - t2.millisecs;
-            uint64_t d2 = (d < 0) ? 0: d;
-            return Time::from_ms(d2);
+            return from_ns(nanosecs + us * 1000LL);
+        }
+
+        [[nodiscard]] Time add_ms(int64_t ms) const
+        {
+            return from_ns(nanosecs + ms * 1000000LL);
+        }
+        /**
+         * t1 - t2, negative if t1 is before t2
+         */
+        static Time diff(Time t1, Time t2)
+        {
+            return from_ns(t1.nanosecs - t2.nanosecs);
+        }
+        /**
+         * How long from now until deadline - zero if the deadline has already passed
+         */
+        static Time remaining(Time deadline, Time now)
+        {
+            int64_t d = deadline.nanosecs - now.nanosecs;
+            return from_ns((d < 0) ? 0 : d);
         }
 
         static bool is_after(Time t1, Time t2)
         {
-            return (t1.millisecs > t2.millisecs);
+            return (t1.nanosecs > t2.nanosecs);
         }
 
         [[nodiscard]] timeval as_timeval() const
         {
-            struct timeval tv = {.tv_sec = (__time_t)millisecs / 1000, .tv_usec = (__suseconds_t)(1000 * (millisecs % 1000))};
+            // round up so a timeout never ends before the deadline it was computed from
+            int64_t us = (nanosecs + 999) / 1000;
+            struct timeval tv = {.tv_sec = (__time_t)(us / 1000000), .tv_usec = (__suseconds_t)(us % 1000000)};
             return tv;
         }
 
+        [[nodiscard]] timespec as_timespec() const
+        {
+            struct timespec ts = {.tv_sec = (__time_t)(nanosecs / 1000000000LL), .tv_nsec = (long)(nanosecs % 1000000000LL)};
+            return ts;
+        }
+
     };
 
 } // namespace f710
-#endif
\ No newline at end of file
+#endif
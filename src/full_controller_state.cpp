@@ -0,0 +1,31 @@
+#include "full_controller_state.h"
+
+f710::FullControllerState::FullControllerState() : m_state(), m_axis_init_count(0), m_button_init_count(0)
+{
+}
+
+void f710::FullControllerState::on_disconnect()
+{
+    for (int n = 0; n < ControllerSnapshot::MAX_AXES; n++) {
+        if (m_state.axis_value[n] != 0) {
+            m_state.axis_value[n] = 0;
+            m_state.dirty |= 1u << n;
+        }
+    }
+    m_state.dirty |= (uint32_t)m_state.pressed << ControllerSnapshot::BUTTON_DIRTY_SHIFT;
+    m_state.pressed = 0;
+    // the driver replays the init burst on reconnect, count it afresh
+    m_axis_init_count = 0;
+    m_button_init_count = 0;
+}
+
+f710::ControllerMode f710::FullControllerState::mode() const
+{
+    if ((m_axis_init_count == 6) && (m_button_init_count == 12)) {
+        return ControllerMode::D;
+    }
+    if ((m_axis_init_count == 8) && (m_button_init_count == 11)) {
+        return ControllerMode::X;
+    }
+    return ControllerMode::Unknown;
+}
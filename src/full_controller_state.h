@@ -0,0 +1,145 @@
+#ifndef H_f710_full_controller_state_H
+#define H_f710_full_controller_state_H
+#include <cinttypes>
+#include <linux/joystick.h>
+
+namespace f710 {
+
+    ///
+    /// The mode switch on the front of the F710, as told by the driver's init burst
+    ///
+    /// -   D: 6 axes, 12 buttons
+    /// -   X: 8 axes, 11 buttons
+    ///
+    enum class ControllerMode { Unknown, D, X };
+
+    ///
+    /// The whole of a controller's state in two cache lines: every axis and button of either mode, in
+    /// arrays indexed by event number, plus a mask of what has changed.
+    ///
+    /// Dirty mask layout: bit n (0..7) is axis n, bit BUTTON_DIRTY_SHIFT + n is button n. A button is
+    /// dirty when its pressed state has changed, so a press and release between two snapshots leaves
+    /// the bit set, pressed clear and (for a toggle) toggled flipped.
+    ///
+    /// A snapshot is a plain value - copying one is copying 128 bytes.
+    ///
+    struct alignas(64) ControllerSnapshot {
+        static constexpr int MAX_AXES = 8;
+        static constexpr int MAX_BUTTONS = 16;
+        static constexpr int BUTTON_DIRTY_SHIFT = 8;
+        static constexpr uint32_t AXIS_DIRTY_MASK = (1u << MAX_AXES) - 1;
+        static constexpr uint32_t BUTTON_DIRTY_MASK = ((1u << MAX_BUTTONS) - 1) << BUTTON_DIRTY_SHIFT;
+
+        // first cache line: everything a callback normally looks at
+        int16_t axis_value[MAX_AXES];
+        /// bit n set while button n is held down
+        uint16_t pressed;
+        /// bit n flips on every press of button n, for buttons used as on/off switches
+        uint16_t toggled;
+        uint32_t dirty;
+        uint32_t axis_time[MAX_AXES];
+        // second cache line
+        uint32_t button_time[MAX_BUTTONS];
+
+        [[nodiscard]] int16_t axis(int n) const { return axis_value[n]; }
+        [[nodiscard]] bool is_pressed(int n) const { return (pressed & (1u << n)) != 0; }
+        [[nodiscard]] bool is_toggled(int n) const { return (toggled & (1u << n)) != 0; }
+        [[nodiscard]] bool axis_changed(int n) const { return (dirty & (1u << n)) != 0; }
+        [[nodiscard]] bool button_changed(int n) const { return (dirty & (1u << (BUTTON_DIRTY_SHIFT + n))) != 0; }
+        /**
+         * Calls f(number, value) for each axis that has changed, in number order
+         */
+        template <typename F>
+        void for_each_changed_axis(F&& f) const
+        {
+            for (uint32_t bits = dirty & AXIS_DIRTY_MASK; bits != 0; bits &= bits - 1) {
+                int n = __builtin_ctz(bits);
+                f(n, axis_value[n]);
+            }
+        }
+        /**
+         * Calls f(number, is_pressed, is_toggled) for each button that has changed, in number order
+         */
+        template <typename F>
+        void for_each_changed_button(F&& f) const
+        {
+            for (uint32_t bits = (dirty & BUTTON_DIRTY_MASK) >> BUTTON_DIRTY_SHIFT; bits != 0; bits &= bits - 1) {
+                int n = __builtin_ctz(bits);
+                f(n, is_pressed(n), is_toggled(n));
+            }
+        }
+    };
+    static_assert(sizeof(ControllerSnapshot) == 128, "ControllerSnapshot should be exactly two cache lines");
+    static_assert(ControllerSnapshot::BUTTON_DIRTY_SHIFT + ControllerSnapshot::MAX_BUTTONS <= 32);
+
+    ///
+    /// A state model that keeps every input of the controller (see ControllerSnapshot) rather than a
+    /// chosen few devices. apply_event() is a type test, a bounds test and a few stores, whatever the
+    /// event; events numbered beyond the arrays are ignored.
+    ///
+    /// Init events set the current position of an axis and the pressed state of a button but never flip
+    /// a toggle. They are also counted, which is how mode() tells D mode from X mode.
+    ///
+    class FullControllerState {
+        ControllerSnapshot m_state;
+        int m_axis_init_count;
+        int m_button_init_count;
+    public:
+        FullControllerState();
+
+        void apply_event(js_event event)
+        {
+            const bool init = (event.type & JS_EVENT_INIT) != 0;
+            const __u8 type = event.type & ~JS_EVENT_INIT;
+            const int n = event.number;
+            if (type == JS_EVENT_AXIS) {
+                m_axis_init_count += init;
+                if (n < ControllerSnapshot::MAX_AXES) {
+                    m_state.axis_value[n] = event.value;
+                    m_state.axis_time[n] = event.time;
+                    m_state.dirty |= 1u << n;
+                }
+            } else if (type == JS_EVENT_BUTTON) {
+                m_button_init_count += init;
+                if (n < ControllerSnapshot::MAX_BUTTONS) {
+                    const auto bit = (uint16_t)(1u << n);
+                    const bool down = (event.value != 0);
+                    if (((m_state.pressed & bit) != 0) == down) {
+                        return;
+                    }
+                    m_state.pressed ^= bit;
+                    if (down && !init) {
+                        m_state.toggled ^= bit;
+                    }
+                    m_state.button_time[n] = event.time;
+                    m_state.dirty |= 1u << (ControllerSnapshot::BUTTON_DIRTY_SHIFT + n);
+                }
+            }
+        }
+        /**
+         * A copy of the whole state with the inputs changed since the previous snapshot() marked dirty,
+         * then clears the dirty mask
+         */
+        ControllerSnapshot snapshot()
+        {
+            ControllerSnapshot copy = m_state;
+            m_state.dirty = 0;
+            return copy;
+        }
+        /**
+         * The live state, without clearing anything
+         */
+        [[nodiscard]] const ControllerSnapshot& state() const { return m_state; }
+        [[nodiscard]] uint32_t dirty_mask() const { return m_state.dirty; }
+        [[nodiscard]] bool has_changed() const { return m_state.dirty != 0; }
+        void clear_changed() { m_state.dirty = 0; }
+        /**
+         * All axes to 0 and all buttons released, reported as changes; toggles are kept
+         */
+        void on_disconnect();
+        [[nodiscard]] ControllerMode mode() const;
+    };
+
+} //namespace
+
+#endif
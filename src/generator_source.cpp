@@ -0,0 +1,72 @@
+#include <algorithm>
+#include <cmath>
+#include "generator_source.h"
+
+namespace {
+    /// the index to pattern mapping when events are not paced
+    constexpr double NOMINAL_EVENTS_PER_SEC = 1000.0;
+    /// D mode: 12 buttons and 6 axes, see ControllerState::initialization_done
+    constexpr uint8_t INIT_BUTTONS = 12;
+    constexpr uint8_t INIT_AXES = 6;
+
+    uint32_t event_time_now()
+    {
+        return (uint32_t)f710::Time::now().ms();
+    }
+}
+
+void f710::GeneratorSource::produce()
+{
+    const bool paced = (m_config.events_per_sec > 0.0);
+    const double rate = paced ? m_config.events_per_sec : NOMINAL_EVENTS_PER_SEC;
+    const int64_t period_ns = (int64_t)(1e9 / rate);
+    // every this many events one button edge replaces a stick event, 0 for never
+    const uint64_t button_every = (m_config.button_presses_per_sec > 0.0)
+        ? (uint64_t)std::max(1.0, rate / (2.0 * m_config.button_presses_per_sec)) : 0;
+    const double radians_per_event = 2.0 * M_PI / (rate * m_config.sweep_period_ms / 1000.0);
+
+    if (m_config.send_init) {
+        uint32_t t = event_time_now();
+        for (uint8_t n = 0; n < INIT_BUTTONS; n++) {
+            if (!write(js_event{t, 0, JS_EVENT_BUTTON | JS_EVENT_INIT, n})) {
+                return;
+            }
+        }
+        for (uint8_t n = 0; n < INIT_AXES; n++) {
+            if (!write(js_event{t, 0, JS_EVENT_AXIS | JS_EVENT_INIT, n})) {
+                return;
+            }
+        }
+        if (!flush()) {
+            return;
+        }
+    }
+    Time start = Time::now();
+    int16_t button_value = 0;
+    for (uint64_t i = 0; (m_config.event_count == 0) || (i < m_config.event_count); i++) {
+        if (paced && !sleep_until(start.add_ns((int64_t)i * period_ns))) {
+            return;
+        }
+        js_event event{};
+        event.time = event_time_now();
+        if ((button_every != 0) && (i % button_every == button_every - 1)) {
+            button_value = (int16_t)(1 - button_value);
+            event.type = JS_EVENT_BUTTON;
+            event.number = m_config.button;
+            event.value = button_value;
+        } else {
+            // the sticks alternate and move in opposite directions
+            double s = std::sin((double)i * radians_per_event);
+            bool left = (i % 2 == 0);
+            event.type = JS_EVENT_AXIS;
+            event.number = left ? m_config.left_axis : m_config.right_axis;
+            event.value = (int16_t)std::lround((left ? s : -s) * 32767.0);
+        }
+        if (!write(event)) {
+            return;
+        }
+        if (paced && !flush()) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef H_f710_generator_source_H
+#define H_f710_generator_source_H
+#include <cinttypes>
+#include <string>
+#include "event_source.h"
+#include "model_defines.h"
+
+namespace f710 {
+
+    ///
+    /// What GeneratorSource produces. The defaults are a D mode controller being driven normally: both
+    /// sticks swept end to end in opposite directions about once every two seconds, 250 events a
+    /// second, with button A pressed twice a second.
+    ///
+    struct GeneratorConfig {
+        /// total events per second, 0 for as fast as the Reader will take them
+        double events_per_sec = 250.0;
+        /// time for a stick to go from one end to the other and back
+        int sweep_period_ms = 2000;
+        /// press and release pairs per second, 0 for none
+        double button_presses_per_sec = 2.0;
+        uint8_t left_axis = D_AXIS_LEFT_STICK_FWD_BKWD_NUMBER;
+        uint8_t right_axis = D_AXIS_RIGHT_STICK_FWD_BKWD_NUMBER;
+        uint8_t button = D_BUTTON_A;
+        /// stop (end of stream) after this many events not counting the init burst, 0 to never stop
+        uint64_t event_count = 0;
+        /// start with the JS_EVENT_INIT burst a D mode controller sends when it is opened
+        bool send_init = true;
+    };
+
+    ///
+    /// A synthetic controller. Events carry CLOCK_MONOTONIC milliseconds as their time, as the driver's
+    /// do, so latency measurements work on them. The stick and button pattern depends only on the event
+    /// index and the configured rate, so an unpaced run produces the same sequence as a paced one,
+    /// just faster.
+    ///
+    class GeneratorSource: public ThreadedSource {
+        GeneratorConfig m_config;
+    public:
+        explicit GeneratorSource(GeneratorConfig config = GeneratorConfig{}) : m_config(config) {}
+        ~GeneratorSource() override { stop(); }
+        [[nodiscard]] std::string name() const override { return "generator"; }
+    protected:
+        void produce() override;
+    };
+
+} //namespace
+
+#endif
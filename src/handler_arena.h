@@ -0,0 +1,169 @@
+#ifndef H_f710_handler_arena_H
+#define H_f710_handler_arena_H
+#include <cinttypes>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <boost/asio.hpp>
+
+namespace f710 {
+
+    ///
+    /// A small fixed pool of memory blocks for the asynchronous operations one coroutine has in flight.
+    ///
+    /// Every co_await on an asio operation allocates the operation object, and when the completion is
+    /// dispatched through a strand the strand allocates a wrapper for it too. asio recycles the first
+    /// through a thread-local cache but takes the second from the handler's associated allocator -
+    /// std::allocator unless told otherwise. A coroutine only ever has one operation outstanding, so
+    /// a handful of fixed blocks is enough to serve both forever without touching the heap. Requests
+    /// that do not fit fall back to operator new and are counted.
+    ///
+    /// Not thread-safe: the io_context running the coroutine must run on one thread.
+    ///
+    class HandlerArena {
+    public:
+        static constexpr size_t BLOCK_SIZE = 512;
+        static constexpr size_t BLOCK_COUNT = 8;
+    private:
+        alignas(std::max_align_t) unsigned char m_blocks[BLOCK_COUNT][BLOCK_SIZE];
+        bool m_in_use[BLOCK_COUNT];
+        uint64_t m_fallback_count;
+    public:
+        HandlerArena() : m_blocks(), m_in_use(), m_fallback_count(0) {}
+        HandlerArena(const HandlerArena&) = delete;
+        HandlerArena& operator=(const HandlerArena&) = delete;
+
+        void* allocate(size_t size)
+        {
+            if (size <= BLOCK_SIZE) {
+                for (size_t i = 0; i < BLOCK_COUNT; i++) {
+                    if (!m_in_use[i]) {
+                        m_in_use[i] = true;
+                        return m_blocks[i];
+                    }
+                }
+            }
+            m_fallback_count++;
+            return ::operator new(size);
+        }
+        void deallocate(void* p)
+        {
+            auto* bytes = static_cast<unsigned char*>(p);
+            if ((bytes >= &m_blocks[0][0]) && (bytes < &m_blocks[0][0] + sizeof(m_blocks))) {
+                m_in_use[(bytes - &m_blocks[0][0]) / BLOCK_SIZE] = false;
+                return;
+            }
+            ::operator delete(p);
+        }
+        /**
+         * Allocations that went to the heap because the block was too big or all blocks were in use
+         */
+        [[nodiscard]] uint64_t fallback_count() const { return m_fallback_count; }
+    };
+
+    ///
+    /// A standard allocator drawing from a HandlerArena, for use as a handler's associated allocator
+    ///
+    template <typename T>
+    class ArenaAllocator {
+        HandlerArena* m_arena;
+        template <typename U> friend class ArenaAllocator;
+    public:
+        using value_type = T;
+        explicit ArenaAllocator(HandlerArena* arena) noexcept : m_arena(arena) {}
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U>& other) noexcept : m_arena(other.m_arena) {}
+        T* allocate(size_t n) { return static_cast<T*>(m_arena->allocate(n * sizeof(T))); }
+        void deallocate(T* p, size_t) noexcept { m_arena->deallocate(p); }
+        template <typename U>
+        bool operator==(const ArenaAllocator<U>& other) const noexcept { return m_arena == other.m_arena; }
+        template <typename U>
+        bool operator!=(const ArenaAllocator<U>& other) const noexcept { return m_arena != other.m_arena; }
+    };
+
+    ///
+    /// Completion token: behaves like boost::asio::use_awaitable_t<Executor> but gives the handler an
+    /// ArenaAllocator, and if error is set the operation's error_code is stored there instead of being
+    /// thrown. Expected errors - end of stream, a timer cancelled to re-arm it - then cost no exception,
+    /// which would allocate as well.
+    ///
+    ///     boost::system::error_code ec;
+    ///     ArenaAwaitable<Strand> token{&arena, &ec};
+    ///     size_t n = co_await descriptor.async_read_some(buffer, token);
+    ///
+    /// Executor must be the coroutine's executor type. Use the concrete one (a strand, say) rather than
+    /// any_io_executor: type erasing a strand allocates on every copy, and asio copies the executor
+    /// for every operation.
+    ///
+    template <typename Executor>
+    struct ArenaAwaitable {
+        HandlerArena* arena;
+        boost::system::error_code* error = nullptr;
+    };
+
+    ///
+    /// The handler an ArenaAwaitable puts around asio's awaitable handler. Completion still runs on the
+    /// awaitable's executor (the coroutine's strand), only the allocator and the error reporting change.
+    ///
+    template <typename Handler, typename Executor>
+    class ArenaHandler {
+        Handler m_handler;
+        ArenaAwaitable<Executor> m_token;
+    public:
+        using allocator_type = ArenaAllocator<void>;
+        using executor_type = boost::asio::associated_executor_t<Handler>;
+
+        ArenaHandler(Handler&& handler, ArenaAwaitable<Executor> token) : m_handler(std::move(handler)), m_token(token) {}
+        allocator_type get_allocator() const noexcept { return allocator_type(m_token.arena); }
+        executor_type get_executor() const noexcept { return boost::asio::get_associated_executor(m_handler); }
+
+        template <typename... Args>
+        void operator()(const boost::system::error_code& ec, Args&&... args)
+        {
+            if (m_token.error != nullptr) {
+                *m_token.error = ec;
+                std::move(m_handler)(boost::system::error_code(), std::forward<Args>(args)...);
+            } else {
+                std::move(m_handler)(ec, std::forward<Args>(args)...);
+            }
+        }
+        template <typename... Args>
+        void operator()(Args&&... args)
+        {
+            std::move(m_handler)(std::forward<Args>(args)...);
+        }
+    };
+
+} //namespace
+
+namespace boost {
+namespace asio {
+
+    ///
+    /// Lets ArenaAwaitable be used wherever use_awaitable is: the operation is started through
+    /// use_awaitable's own machinery with the handler it creates wrapped in an ArenaHandler.
+    ///
+    template <typename Executor, typename R, typename... Args>
+    class async_result<f710::ArenaAwaitable<Executor>, R(Args...)> {
+        using awaitable_result = async_result<use_awaitable_t<Executor>, R(Args...)>;
+    public:
+        using return_type = typename awaitable_result::return_type;
+
+        template <typename Initiation, typename... InitArgs>
+        static return_type initiate(Initiation initiation, f710::ArenaAwaitable<Executor> token, InitArgs... args)
+        {
+            return awaitable_result::initiate(
+                [initiation = std::move(initiation), token](auto&& handler, auto&&... init_args) mutable {
+                    using handler_type = std::decay_t<decltype(handler)>;
+                    std::move(initiation)(f710::ArenaHandler<handler_type, Executor>(std::move(handler), token),
+                        std::forward<decltype(init_args)>(init_args)...);
+                },
+                use_awaitable_t<Executor>(), std::move(args)...);
+        }
+    };
+
+} // namespace asio
+} // namespace boost
+
+#endif
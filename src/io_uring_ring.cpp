@@ -0,0 +1,172 @@
+#include "io_uring_ring.h"
+#include "f710_exceptions.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+    int sys_io_uring_setup(unsigned entries, io_uring_params* params)
+    {
+        return (int)syscall(__NR_io_uring_setup, entries, params);
+    }
+
+    int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+    {
+        return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+    }
+
+    template <typename T>
+    T* ring_field(void* base, uint32_t offset)
+    {
+        return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+    }
+
+    unsigned load_acquire(const unsigned* p)
+    {
+        return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+    }
+
+    void store_release(unsigned* p, unsigned v)
+    {
+        __atomic_store_n(p, v, __ATOMIC_RELEASE);
+    }
+}
+
+f710::IoUring::IoUring(unsigned entries, bool try_sqpoll)
+    : m_ring_fd(-1), m_sqpoll(false), m_sq_ring_ptr(MAP_FAILED), m_sq_ring_size(0),
+    m_cq_ring_ptr(MAP_FAILED), m_cq_ring_size(0), m_sqes(static_cast<io_uring_sqe*>(MAP_FAILED)), m_sqes_size(0),
+    m_sq_local_tail(0), m_sq_submitted_tail(0)
+{
+    io_uring_params params{};
+    if (try_sqpoll) {
+        params.flags = IORING_SETUP_SQPOLL;
+        params.sq_thread_idle = 100; // ms of inactivity before the kernel thread sleeps
+        m_ring_fd = sys_io_uring_setup(entries, &params);
+        m_sqpoll = (m_ring_fd >= 0);
+    }
+    if (m_ring_fd < 0) {
+        memset(&params, 0, sizeof(params));
+        m_ring_fd = sys_io_uring_setup(entries, &params);
+    }
+    if (m_ring_fd < 0) {
+        throw F710UringError();
+    }
+    m_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        m_sq_ring_size = m_cq_ring_size = std::max(m_sq_ring_size, m_cq_ring_size);
+    }
+    m_sq_ring_ptr = mmap(nullptr, m_sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         m_ring_fd, IORING_OFF_SQ_RING);
+    if (m_sq_ring_ptr == MAP_FAILED) {
+        close(m_ring_fd);
+        throw F710UringError();
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        m_cq_ring_ptr = m_sq_ring_ptr;
+    } else {
+        m_cq_ring_ptr = mmap(nullptr, m_cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             m_ring_fd, IORING_OFF_CQ_RING);
+        if (m_cq_ring_ptr == MAP_FAILED) {
+            munmap(m_sq_ring_ptr, m_sq_ring_size);
+            close(m_ring_fd);
+            throw F710UringError();
+        }
+    }
+    m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      m_ring_fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        if (m_cq_ring_ptr != m_sq_ring_ptr) {
+            munmap(m_cq_ring_ptr, m_cq_ring_size);
+        }
+        munmap(m_sq_ring_ptr, m_sq_ring_size);
+        close(m_ring_fd);
+        throw F710UringError();
+    }
+    m_sqes = static_cast<io_uring_sqe*>(sqes);
+
+    m_sq_head = ring_field<unsigned>(m_sq_ring_ptr, params.sq_off.head);
+    m_sq_tail = ring_field<unsigned>(m_sq_ring_ptr, params.sq_off.tail);
+    m_sq_mask = ring_field<unsigned>(m_sq_ring_ptr, params.sq_off.ring_mask);
+    m_sq_flags = ring_field<unsigned>(m_sq_ring_ptr, params.sq_off.flags);
+    m_sq_array = ring_field<unsigned>(m_sq_ring_ptr, params.sq_off.array);
+    m_cq_head = ring_field<unsigned>(m_cq_ring_ptr, params.cq_off.head);
+    m_cq_tail = ring_field<unsigned>(m_cq_ring_ptr, params.cq_off.tail);
+    m_cq_mask = ring_field<unsigned>(m_cq_ring_ptr, params.cq_off.ring_mask);
+    m_cqes = ring_field<io_uring_cqe>(m_cq_ring_ptr, params.cq_off.cqes);
+    m_sq_local_tail = m_sq_submitted_tail = *m_sq_tail;
+}
+
+f710::IoUring::~IoUring()
+{
+    munmap(m_sqes, m_sqes_size);
+    if (m_cq_ring_ptr != m_sq_ring_ptr) {
+        munmap(m_cq_ring_ptr, m_cq_ring_size);
+    }
+    munmap(m_sq_ring_ptr, m_sq_ring_size);
+    close(m_ring_fd);
+}
+
+io_uring_sqe* f710::IoUring::get_sqe()
+{
+    unsigned head = load_acquire(m_sq_head);
+    if (m_sq_local_tail - head > *m_sq_mask) {
+        return nullptr;
+    }
+    unsigned index = m_sq_local_tail & *m_sq_mask;
+    m_sq_array[index] = index;
+    m_sq_local_tail++;
+    io_uring_sqe* sqe = &m_sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int f710::IoUring::submit_and_wait(unsigned wait_nr)
+{
+    unsigned to_submit = m_sq_local_tail - m_sq_submitted_tail;
+    if (to_submit > 0) {
+        store_release(m_sq_tail, m_sq_local_tail);
+        m_sq_submitted_tail = m_sq_local_tail;
+    }
+    unsigned flags = 0;
+    if (m_sqpoll) {
+        // the kernel thread picks up the new tail by itself unless it has gone to sleep
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (__atomic_load_n(m_sq_flags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP) {
+            flags |= IORING_ENTER_SQ_WAKEUP;
+        }
+        to_submit = 0;
+    }
+    if (wait_nr > 0) {
+        flags |= IORING_ENTER_GETEVENTS;
+    }
+    if ((to_submit == 0) && (flags == 0)) {
+        return 0;
+    }
+    while (sys_io_uring_enter(m_ring_fd, to_submit, wait_nr, flags) < 0) {
+        if ((errno != EINTR) && (errno != EAGAIN)) {
+            throw F710UringError();
+        }
+    }
+    return 1;
+}
+
+io_uring_cqe* f710::IoUring::peek_cqe()
+{
+    unsigned head = *m_cq_head;
+    if (head == load_acquire(m_cq_tail)) {
+        return nullptr;
+    }
+    return &m_cqes[head & *m_cq_mask];
+}
+
+void f710::IoUring::cqe_seen()
+{
+    store_release(m_cq_head, *m_cq_head + 1);
+}
@@ -0,0 +1,73 @@
+#ifndef H_f710_io_uring_ring_H
+#define H_f710_io_uring_ring_H
+#include <cinttypes>
+#include <cstddef>
+#include <linux/io_uring.h>
+
+namespace f710 {
+
+    ///
+    /// A minimal io_uring wrapper built directly on the io_uring_setup/io_uring_enter syscalls
+    /// (liburing is not required).
+    ///
+    /// It provides just what the uring Reader needs - get an SQE, submit, wait for and walk CQEs.
+    ///
+    /// If the kernel grants IORING_SETUP_SQPOLL a kernel thread consumes the submission queue so
+    /// submitting is only a store to the ring tail; an io_uring_enter is then only needed to wake
+    /// that thread after it has gone idle or to block waiting for a completion.
+    ///
+    class IoUring {
+        int m_ring_fd;
+        bool m_sqpoll;
+        void* m_sq_ring_ptr;
+        size_t m_sq_ring_size;
+        void* m_cq_ring_ptr;
+        size_t m_cq_ring_size;
+        io_uring_sqe* m_sqes;
+        size_t m_sqes_size;
+
+        unsigned* m_sq_head;
+        unsigned* m_sq_tail;
+        unsigned* m_sq_mask;
+        unsigned* m_sq_flags;
+        unsigned* m_sq_array;
+        unsigned m_sq_local_tail;
+        unsigned m_sq_submitted_tail;
+
+        unsigned* m_cq_head;
+        unsigned* m_cq_tail;
+        unsigned* m_cq_mask;
+        io_uring_cqe* m_cqes;
+    public:
+        IoUring() = delete;
+        IoUring(const IoUring&) = delete;
+        IoUring& operator=(const IoUring&) = delete;
+        /**
+         * @param entries     number of submission queue entries
+         * @param try_sqpoll  ask for a kernel submission thread, silently falls back if refused
+         */
+        explicit IoUring(unsigned entries, bool try_sqpoll = true);
+        ~IoUring();
+
+        [[nodiscard]] bool sqpoll_active() const { return m_sqpoll; }
+        /**
+         * Returns a zeroed SQE or nullptr if the submission queue is full
+         */
+        io_uring_sqe* get_sqe();
+        /**
+         * Makes every SQE obtained since the last call visible to the kernel and, if wait_nr > 0, blocks
+         * until at least that many completions are available.
+         * Returns the number of syscalls made (0 or 1) so callers can account for them.
+         */
+        int submit_and_wait(unsigned wait_nr);
+        /**
+         * Returns the next completion or nullptr if the completion queue is empty.
+         * The entry must be released with cqe_seen() before the next call.
+         */
+        io_uring_cqe* peek_cqe();
+        void cqe_seen();
+    };
+
+} //namespace
+
+#endif
@@ -0,0 +1,57 @@
+#include "latency_histogram.h"
+
+f710::LatencyHistogram::LatencyHistogram() : m_total(0), m_max(0)
+{
+    for (auto& c: m_counts) {
+        c.store(0, std::memory_order_relaxed);
+    }
+}
+
+uint64_t f710::LatencyHistogram::bucket_upper_value(size_t index)
+{
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    size_t shift = (index - SUB_BUCKETS) / SUB_BUCKETS;
+    uint64_t mantissa = SUB_BUCKETS + (index - SUB_BUCKETS) % SUB_BUCKETS;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+uint64_t f710::LatencyHistogram::percentile(double p) const
+{
+    uint64_t total = count();
+    if (total == 0) {
+        return 0;
+    }
+    auto target = (uint64_t)(p * (double)total);
+    if (target >= total) {
+        target = total - 1;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        seen += m_counts[i].load(std::memory_order_relaxed);
+        if (seen > target) {
+            uint64_t upper = bucket_upper_value(i);
+            uint64_t largest = max();
+            return (upper < largest) ? upper : largest;
+        }
+    }
+    return max();
+}
+
+void f710::LatencyHistogram::reset()
+{
+    for (auto& c: m_counts) {
+        c.store(0, std::memory_order_relaxed);
+    }
+    m_total.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+void f710::LatencyHistogram::print(FILE* out, const char* name) const
+{
+    fprintf(out, "%-20s count: %10lu  p50: %10.1f us  p99: %10.1f us  p999: %10.1f us  max: %10.1f us\n",
+            name, count(),
+            (double)percentile(0.50) / 1000.0, (double)percentile(0.99) / 1000.0,
+            (double)percentile(0.999) / 1000.0, (double)max() / 1000.0);
+}
@@ -0,0 +1,73 @@
+#ifndef H_f710_latency_histogram_H
+#define H_f710_latency_histogram_H
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+
+namespace f710 {
+
+    ///
+    /// A fixed size, lock-free, HDR style (log-linear) histogram of non-negative integer values, normally
+    /// nanoseconds.
+    ///
+    /// Every power of two range is split into SUB_BUCKETS equal buckets, so any recorded value is
+    /// reported within 1/SUB_BUCKETS (about 6%) of its true value, from 1 ns up to the full 64 bit range,
+    /// in under 8 KB. record() is a couple of instructions plus one relaxed atomic increment so it can
+    /// be called on the hot path from any number of threads, and percentiles can be read at any time
+    /// from any thread.
+    ///
+    class LatencyHistogram {
+    public:
+        static constexpr int SUB_BUCKET_BITS = 4;
+        static constexpr uint64_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+        static constexpr size_t BUCKET_COUNT = SUB_BUCKETS + (64 - SUB_BUCKET_BITS) * SUB_BUCKETS;
+    private:
+        std::atomic<uint64_t> m_counts[BUCKET_COUNT];
+        std::atomic<uint64_t> m_total;
+        std::atomic<uint64_t> m_max;
+    public:
+        LatencyHistogram();
+        LatencyHistogram(const LatencyHistogram&) = delete;
+        LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+        static size_t bucket_index(uint64_t value)
+        {
+            if (value < SUB_BUCKETS) {
+                return (size_t)value;
+            }
+            int msb = 63 - __builtin_clzll(value);
+            int shift = msb - SUB_BUCKET_BITS;
+            return SUB_BUCKETS + (size_t)shift * SUB_BUCKETS + (size_t)((value >> shift) - SUB_BUCKETS);
+        }
+        /**
+         * The largest value that lands in the given bucket
+         */
+        static uint64_t bucket_upper_value(size_t index);
+        /**
+         * Negative values (a clock that has been misaligned) are recorded as 0
+         */
+        void record(int64_t value)
+        {
+            uint64_t v = (value < 0) ? 0 : (uint64_t)value;
+            m_counts[bucket_index(v)].fetch_add(1, std::memory_order_relaxed);
+            m_total.fetch_add(1, std::memory_order_relaxed);
+            uint64_t prev = m_max.load(std::memory_order_relaxed);
+            while ((v > prev) && !m_max.compare_exchange_weak(prev, v, std::memory_order_relaxed)) {
+            }
+        }
+        [[nodiscard]] uint64_t count() const { return m_total.load(std::memory_order_relaxed); }
+        [[nodiscard]] uint64_t max() const { return m_max.load(std::memory_order_relaxed); }
+        /**
+         * The value at or below which the fraction p (0.0 .. 1.0) of the recorded values lie
+         */
+        [[nodiscard]] uint64_t percentile(double p) const;
+        void reset();
+        /**
+         * One line: name count p50 p99 p999 max, values printed in µs
+         */
+        void print(FILE* out, const char* name) const;
+    };
+
+} //namespace
+
+#endif
@@ -0,0 +1,51 @@
+#include "latency_recorder.h"
+
+f710::Time f710::KernelClockAligner::align(uint32_t event_time_ms, Time received_at)
+{
+    if (m_started && (event_time_ms < m_last_raw) && (m_last_raw - event_time_ms > 0x80000000u)) {
+        m_wraps++;
+    }
+    m_last_raw = event_time_ms;
+    int64_t kernel_ns = (int64_t)((m_wraps << 32) + event_time_ms) * 1000000LL;
+    int64_t offset = received_at.nanosecs - kernel_ns;
+    if (!m_started || (offset < m_offset_ns)) {
+        m_offset_ns = offset;
+        m_started = true;
+    }
+    return Time::from_ns(kernel_ns + m_offset_ns);
+}
+
+f710::LatencyRecorder::LatencyRecorder() : m_pending(), m_pending_count(0), m_pending_dropped(0)
+{
+}
+
+void f710::LatencyRecorder::on_apply(const js_event& event, Time now)
+{
+    Time kernel_time = m_aligner.align(event.time, now);
+    kernel_to_apply.record(Time::diff(now, kernel_time).nanosecs);
+    if (m_pending_count < MAX_PENDING) {
+        m_pending[m_pending_count++] = Pending{kernel_time, now};
+    } else {
+        m_pending_dropped++;
+    }
+}
+
+void f710::LatencyRecorder::on_callback(Time now)
+{
+    for (size_t i = 0; i < m_pending_count; i++) {
+        apply_to_callback.record(Time::diff(now, m_pending[i].applied_at).nanosecs);
+        kernel_to_callback.record(Time::diff(now, m_pending[i].kernel_time).nanosecs);
+    }
+    m_pending_count = 0;
+}
+
+void f710::LatencyRecorder::dump(FILE* out) const
+{
+    kernel_to_apply.print(out, "kernel->apply");
+    apply_to_callback.print(out, "apply->callback");
+    kernel_to_callback.print(out, "kernel->callback");
+    if (m_pending_dropped > 0) {
+        fprintf(out, "%-20s %lu events not tracked to a callback\n", "dropped", m_pending_dropped);
+    }
+    fflush(out);
+}
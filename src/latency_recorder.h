@@ -0,0 +1,112 @@
+#ifndef H_f710_latency_recorder_H
+#define H_f710_latency_recorder_H
+#include <cinttypes>
+#include <cstdio>
+#include <functional>
+#include <linux/joystick.h>
+#include "f710_time.h"
+#include "latency_histogram.h"
+#include "reader_concept.h"
+
+namespace f710 {
+
+    ///
+    /// Maps the 32 bit millisecond js_event.time onto the host CLOCK_MONOTONIC time line.
+    ///
+    /// The driver stamps events with jiffies converted to ms, which wraps every 49.7 days and has an
+    /// unknown offset from CLOCK_MONOTONIC. The time is unwrapped to 64 bits and the offset is estimated
+    /// as the smallest (host receive time - kernel time) seen so far: an event can never be received
+    /// before it was generated, so the minimum converges on the true offset plus the shortest delivery
+    /// delay. Resolution is the driver's: 1 ms at best, one jiffy in practice.
+    ///
+    class KernelClockAligner {
+        bool m_started;
+        uint32_t m_last_raw;
+        uint64_t m_wraps;
+        int64_t m_offset_ns;
+    public:
+        KernelClockAligner() : m_started(false), m_last_raw(0), m_wraps(0), m_offset_ns(0) {}
+        /**
+         * Returns the event time as a host CLOCK_MONOTONIC Time, refining the offset with received_at
+         */
+        Time align(uint32_t event_time_ms, Time received_at);
+    };
+
+    ///
+    /// Input-age instrumentation. For every event it records
+    ///
+    /// -   kernel to apply:     kernel event time -> the model's apply_event ran
+    /// -   apply to callback:   apply_event ran -> the first callback that could see the value
+    /// -   kernel to callback:  the two above together, the age of the input when it is acted on
+    ///
+    /// The histograms are lock-free and can be dumped at any time from any thread. on_apply and
+    /// on_callback must be called from the thread that applies events and runs the callback.
+    ///
+    class LatencyRecorder {
+        static constexpr size_t MAX_PENDING = 256;
+        struct Pending {
+            Time kernel_time;
+            Time applied_at;
+        };
+        KernelClockAligner m_aligner;
+        Pending m_pending[MAX_PENDING];
+        size_t m_pending_count;
+        uint64_t m_pending_dropped;
+    public:
+        LatencyHistogram kernel_to_apply;
+        LatencyHistogram apply_to_callback;
+        LatencyHistogram kernel_to_callback;
+
+        LatencyRecorder();
+        void on_apply(const js_event& event, Time now);
+        void on_callback(Time now);
+        /**
+         * Events whose callback latency was not recorded because more than MAX_PENDING arrived between
+         * two callbacks
+         */
+        [[nodiscard]] uint64_t pending_dropped() const { return m_pending_dropped; }
+        void dump(FILE* out) const;
+    };
+
+    ///
+    /// Wraps any model so that a Reader driving it feeds a LatencyRecorder. Use it as the Reader's state
+    /// type and wrap the callback with instrument_callback().
+    ///
+    template <HasApplyEvent ContState>
+    class InstrumentedState {
+        ContState* m_inner;
+        LatencyRecorder* m_recorder;
+    public:
+        InstrumentedState(ContState* inner, LatencyRecorder* recorder) : m_inner(inner), m_recorder(recorder) {}
+        void apply_event(js_event event)
+        {
+            // init events carry the time the device was opened, not input age
+            if ((event.type & JS_EVENT_INIT) == 0) {
+                m_recorder->on_apply(event, Time::now());
+            }
+            m_inner->apply_event(event);
+        }
+        bool has_changed() { return state_has_changed(*m_inner); }
+        void clear_changed() { state_clear_changed(*m_inner); }
+        void on_disconnect()
+        {
+            if constexpr (requires (ContState& cs) { cs.on_disconnect(); }) {
+                m_inner->on_disconnect();
+            }
+        }
+        ContState& inner() { return *m_inner; }
+        LatencyRecorder& recorder() { return *m_recorder; }
+    };
+
+    template <HasApplyEvent ContState>
+    std::function<void(InstrumentedState<ContState>&)> instrument_callback(std::function<void(ContState&)> on_event_function)
+    {
+        return [on_event_function](InstrumentedState<ContState>& state) {
+            state.recorder().on_callback(Time::now());
+            on_event_function(state.inner());
+        };
+    }
+
+} //namespace
+
+#endif
@@ -1,64 +1,373 @@
 #include "f710_helpers.h"
 #include "f710_exceptions.h"
 #include "model.h"
+#include "controller_state.h"
+#include "response_curve.h"
 #include "model_defines.h"
-#include <format>
-#include <chrono>
+#include "telemetry_sink.h"
+#include <rbl/logger.h>
+#ifdef F710_QUEUED
+#include <thread>
+#include <rbl/simple_exit_guard.h>
+#include "queued_state.h"
+#endif
+#ifdef F710_GENERATOR
+#include "generator_source.h"
+#endif
+#ifdef F710_RECORD
+#include "session_recorder.h"
+#endif
+#ifdef F710_REPLAY
+#include "session_replay.h"
+#endif
+#ifdef F710_FULL_STATE
+#include "full_controller_state.h"
+#include "axis_filter.h"
+#endif
+#ifdef F710_SHM
+#include "shm_state.h"
+#endif
+#ifdef F710_SERIAL
+#include "serial_sink.h"
+#endif
+#if defined(F710_UDP) || defined(F710_UDP_RECEIVER)
+#include <poll.h>
+#include "udp_state.h"
+#endif
+#ifdef F710_LATENCY
+#include <atomic>
+#include <csignal>
+#include "latency_recorder.h"
+#endif
 #ifdef ASIO_READER
 #include "asio_reader.h"
+#elif defined(ASIO_CORO_READER)
+#include "asio_coro_reader.h"
+#elif defined(EPOLL_READER)
+#include "epoll_reader.h"
+#elif defined(URING_READER)
+#include "uring_reader.h"
+#elif defined(MULTI_READER)
+#include "multi_reader.h"
+#elif defined(EVDEV_READER)
+#include "evdev_reader.h"
 #else
 #include "reader.h"
 #endif
-float scale(bool high_gear, int value) {
-    if (value == 0) {
-        return 0.0;
-    }
-    auto multiplier = (value < 0) ? -1: 1;
-    value = value * multiplier;
-    float pwm;
-    if (high_gear) {
-        pwm = multiplier * (round(((float) value / (float) INT16_MAX) * (85.0 - 50.0)) + 50.0);
-    } else {
-        pwm = multiplier * (round(((float) value / (float) INT16_MAX) * (60.0 - 30.0)) + 30.0);
+///
+/// The gear tables, built by the compiler from the curves in response_curve.h
+///
+static constexpr f710::ResponseTable LOW_GEAR{f710::LOW_GEAR_CURVE};
+static constexpr f710::ResponseTable HIGH_GEAR{f710::HIGH_GEAR_CURVE};
+
+static f710::TelemetrySink* g_telemetry = nullptr;
+
+///
+/// A reader that supports output sinks writes cb's status lines from its own loop. With any other
+/// reader the sink stays in write-through mode and each line is written as it is made.
+///
+template <typename R>
+void attach_telemetry(R& reader, f710::TelemetrySink& telemetry)
+{
+    if constexpr (requires { reader.add_output_sink(&telemetry); }) {
+        telemetry.set_mode(f710::TelemetrySink::Mode::LoopDriven);
+        reader.add_output_sink(&telemetry);
     }
-    return pwm;
 }
-std::string format_time_now()
+
+///
+/// The model this program drives a robot with: both sticks fore and aft, and A as a high/low gear toggle
+///
+using LeftStick = f710::Axis<D_AXIS_LEFT_STICK_FWD_BKWD_NUMBER>;
+using RightStick = f710::Axis<D_AXIS_RIGHT_STICK_FWD_BKWD_NUMBER>;
+using GearToggle = f710::Toggle<D_BUTTON_A>;
+using DriveState = f710::BasicControllerState<LeftStick, RightStick, GearToggle>;
+
+struct DriveCommand {
+    int16_t raw_left;
+    int16_t raw_right;
+    int8_t pwm_left;
+    int8_t pwm_right;
+    bool high_gear;
+};
+DriveCommand drive_command(DriveState& state)
 {
-    using namespace std::chrono;
-    auto now = std::chrono::time_point_cast<milliseconds>(std::chrono::system_clock::now());
-    std::string s = std::format("{:%T}", now);
-    return s;
-    // std::time_t now = std::time(nullptr);
-    // std::tm* tm = std::localtime(&now);
-    // char buffer[100];
-    // std::strftime(buffer, sizeof(buffer), "%M:%S", tm);
-    // return buffer;
+    int16_t raw_left = state.get<LeftStick>().latest_event_value;
+    int16_t raw_right = state.get<RightStick>().latest_event_value;
+    bool high_gear = state.get<GearToggle>().event_toggle_value;
+    const f710::ResponseTable& gear = high_gear ? HIGH_GEAR : LOW_GEAR;
+    return DriveCommand{raw_left, raw_right, gear(raw_left), gear(raw_right), high_gear};
 }
-void cb(f710::ControllerState& state) {
-    auto left = -1 * state.m_left.latest_event_value;
-    auto right = -1 * state.m_right.latest_event_value;
-    auto onoff = state.m_button.event_toggle_value;
+void cb(DriveState& state) {
+    DriveCommand command = drive_command(state);
+    auto left = -1 * command.raw_left;
+    auto right = -1 * command.raw_right;
+    auto pwm_left = (float)command.pwm_left;
+    auto pwm_right = (float)command.pwm_right;
 
-    auto pwm_left = scale(onoff, left);
-    auto pwm_right = scale(onoff, right);
-
-    auto tn = format_time_now();
-    printf("from main %s left: %d pwm_left: %f  right: %d pwm_right: %f toggle: %d\n",
-        tn.c_str(),
-        left, pwm_left, right, pwm_right, (int)onoff);
+    char tn[16];
+    f710::format_time_of_day(tn, sizeof(tn));
+    g_telemetry->line("from main %s left: %d pwm_left: %f  right: %d pwm_right: %f toggle: %d\n",
+        tn,
+        left, pwm_left, right, pwm_right, (int)command.high_gear);
 }
+#ifdef F710_LATENCY
+///
+/// SIGUSR1 dumps the latency histograms, SIGINT/SIGTERM dump them and exit. The handler only sets a
+/// flag; the dump happens on the reader thread at the next callback.
+///
+static std::atomic<bool> g_latency_dump_requested{false};
+static std::atomic<bool> g_latency_exit_requested{false};
+static void latency_signal_handler(int signo)
+{
+    if (signo == SIGUSR1) {
+        g_latency_dump_requested.store(true, std::memory_order_relaxed);
+    } else {
+        g_latency_exit_requested.store(true, std::memory_order_relaxed);
+    }
+}
+static void install_latency_signal_handlers()
+{
+    struct sigaction sa{};
+    sa.sa_handler = latency_signal_handler;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR1, &sa, nullptr);
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+}
+#endif
 int main(int argc, char **argv) {
+    // the log thread starts here rather than on the first log call from the event loop
+    rbl::log::start();
     try {
-        f710::ControllerState controller_state{
-            f710::AxisDevice(D_AXIS_LEFT_STICK_FWD_BKWD_NUMBER),
-            f710::AxisDevice(D_AXIS_RIGHT_STICK_FWD_BKWD_NUMBER), 
-            f710::ToggleButton(D_BUTTON_A)};
+        DriveState controller_state{};
+#ifndef F710_UDP_RECEIVER
+        f710::TelemetrySink telemetry{STDOUT_FILENO, f710::TelemetrySink::Mode::WriteThrough};
+        g_telemetry = &telemetry;
+#endif
 
+#if defined(F710_REPLAY)
+        ///
+        /// usage: f710_replay session.f710s [speed]
+        /// speed 1 replays with the recorded timing, 0 as fast as possible. cb runs after every event so
+        /// two replays of the same file print the same model values.
+        ///
+        if (argc < 2) {
+            printf("usage: %s session.f710s [speed]\n", argv[0]);
+            return 1;
+        }
+        f710::SessionReplay session{argv[1]};
+        double speed = (argc > 2) ? atof(argv[2]) : 1.0;
+        telemetry.line("replaying %s recorded from %s\n", argv[1], session.device_name().c_str());
+        auto count = session.replay<DriveState>(controller_state, speed, cb);
+        telemetry.line("replayed %lu events\n", count);
+#elif defined(F710_UDP_RECEIVER)
+        ///
+        /// usage: f710_udp_receiver [port] [max_age_ms]
+        /// the robot base end of f710_udp: prints each drive command and every 5 s a latency and loss report
+        ///
+        f710::UdpStateReceiver receiver{(uint16_t)((argc > 1) ? atoi(argv[1]) : 7100),
+            f710::Time::from_ms((argc > 2) ? atoi(argv[2]) : 0)};
+        f710::Time now = f710::Time::now();
+        f710::Time next_report = now.add_ms(5000);
+        while (true) {
+            pollfd pfd{receiver.fd(), POLLIN, 0};
+            int timeout_ms = (int)((f710::Time::remaining(next_report, now).nanosecs + 999999) / 1000000);
+            if (poll(&pfd, 1, timeout_ms) > 0) {
+                receiver.receive([](const f710::DriveFrame& frame) {
+                    printf("seq %u pwm_left: %d pwm_right: %d gear: %s\n", frame.sequence, frame.left_pwm,
+                           frame.right_pwm, (frame.flags & f710::DriveFrame::FLAG_HIGH_GEAR) ? "high" : "low");
+                });
+            }
+            now = f710::Time::now();
+            if (now.nanosecs >= next_report.nanosecs) {
+                receiver.print(stdout);
+                next_report = next_report.add_ms(5000);
+            }
+        }
+#elif defined(MULTI_READER)
+        ///
+        /// usage: f710_multi /dev/input/js0 /dev/input/js1 ...
+        /// every controller gets the same model and callback here, but they do not need to
+        ///
+        std::vector<DriveState> states(argc - 1, controller_state);
+        f710::MultiReader<DriveState> logitech_f710s{};
+        for (int i = 1; i < argc; i++) {
+            logitech_f710s.add_controller(argv[i], &states[i - 1], cb);
+        }
+        logitech_f710s.run();
+#else
+#ifdef EVDEV_READER
+        std::string js_name = "Logitech";
+#else
         std::string js_name = "js";
-        f710::Reader<f710::ControllerState> logitech_f710{js_name, &controller_state, cb};
+#endif
+#ifdef F710_QUEUED
+        ///
+        /// The reader thread only queues events, the model and cb run on the consumer thread so a slow cb
+        /// can not hold up draining the device. The reader's own tick has nothing to do.
+        ///
+        auto queue = std::make_unique<f710::EventQueue>();
+        f710::ConsumerWaker waker;
+        f710::QueueingState queueing_state{queue.get(), &waker};
+        f710::QueueConsumer<DriveState> consumer{queue.get(), &waker, &controller_state, cb};
+        std::thread consumer_thread([&consumer]() { consumer.run(); });
+        // the consumer uses queue, waker and consumer, so it must be gone before they are, however main leaves
+        exit_guard::Guard consumer_guard([&consumer, &waker, &consumer_thread]() {
+            consumer.stop();
+            waker.notify();
+            consumer_thread.join();
+        });
+        f710::Reader<f710::QueueingState> logitech_f710{js_name, &queueing_state, [](f710::QueueingState&) {}, 60000};
+#elif defined(F710_GENERATOR)
+        ///
+        /// usage: f710_synthetic [events_per_sec] [event_count]
+        /// the whole pipeline on a synthetic controller, no hardware needed
+        ///
+        f710::GeneratorConfig generator_config;
+        if (argc > 1) {
+            generator_config.events_per_sec = atof(argv[1]);
+        }
+        if (argc > 2) {
+            generator_config.event_count = strtoull(argv[2], nullptr, 10);
+        }
+        f710::Reader<DriveState> logitech_f710{std::make_unique<f710::GeneratorSource>(generator_config),
+            &controller_state, cb};
+#elif defined(F710_RECORD)
+        ///
+        /// usage: f710_record [session.f710s]
+        ///
+        f710::SessionRecorder recorder{(argc > 1) ? argv[1] : "f710_session.f710s", js_name};
+        f710::RecordingState<DriveState> recording_state{&controller_state, &recorder};
+        f710::Reader<f710::RecordingState<DriveState>> logitech_f710{js_name, &recording_state,
+            [](f710::RecordingState<DriveState>& state) {
+                state.recorder().flush_if_due(f710::Time::now());
+                cb(state.inner());
+            }};
+#elif defined(F710_LATENCY)
+        f710::LatencyRecorder latency;
+        f710::InstrumentedState<DriveState> instrumented_state{&controller_state, &latency};
+        auto instrumented_cb = f710::instrument_callback<DriveState>(cb);
+        install_latency_signal_handlers();
+        f710::Reader<f710::InstrumentedState<DriveState>> logitech_f710{js_name, &instrumented_state,
+            [&instrumented_cb, &latency](f710::InstrumentedState<DriveState>& state) {
+                instrumented_cb(state);
+                if (g_latency_dump_requested.exchange(false, std::memory_order_relaxed)) {
+                    latency.dump(stderr);
+                }
+                if (g_latency_exit_requested.load(std::memory_order_relaxed)) {
+                    latency.dump(stderr);
+                    // unwinds out of run() so the telemetry sink and the rest of main's objects are destroyed
+                    throw f710::F710StopRequested();
+                }
+            }};
+#elif defined(F710_SERIAL)
+        ///
+        /// usage: f710_serial /dev/ttyUSB0 [baud]
+        /// sends "L<pwm> R<pwm>" lines to a serial motor controller every 20 ms. The callback only fills
+        /// the sink's latest-wins slot; the reader writes it when the port is writable. The sink's
+        /// statistics go to stderr every 5 s through a TelemetrySink the same loop writes, so the reader
+        /// thread never waits on stdio.
+        ///
+        if (argc < 2) {
+            printf("usage: %s serial_device [baud]\n", argv[0]);
+            return 1;
+        }
+        f710::SerialSink serial{argv[1], (argc > 2) ? atoi(argv[2]) : 115200, 32};
+        f710::TelemetrySink serial_stats{STDERR_FILENO, f710::TelemetrySink::Mode::LoopDriven};
+        uint64_t ticks = 0;
+        f710::Reader<DriveState> logitech_f710{js_name, &controller_state,
+            [&serial, &serial_stats, &ticks](DriveState& state) {
+                DriveCommand command = drive_command(state);
+                char line[32];
+                int n = snprintf(line, sizeof(line), "L%d R%d\n", command.pwm_left, command.pwm_right);
+                serial.submit(line, (size_t)n, f710::Time::now());
+                if (++ticks % 250 == 0) {
+                    const f710::LatencyHistogram& latency = serial.write_latency();
+                    serial_stats.line("commands submitted %lu written %lu superseded %lu would block %lu, "
+                                      "submit to written p50 %lu us p99 %lu us\n",
+                                      serial.submitted(), serial.commands_written(), serial.superseded(),
+                                      serial.would_block(), latency.percentile(0.5) / 1000,
+                                      latency.percentile(0.99) / 1000);
+                }
+            }, 20};
+        logitech_f710.add_output_sink(&serial);
+        logitech_f710.add_output_sink(&serial_stats);
+#elif defined(F710_UDP)
+        ///
+        /// usage: f710_udp host [port] [redundancy]
+        /// sends the drive command to f710_udp_receiver on host every 20 ms, each datagram repeating the
+        /// previous redundancy commands, so a lost one is made good 20 ms later
+        ///
+        if (argc < 2) {
+            printf("usage: %s host [port] [redundancy]\n", argv[0]);
+            return 1;
+        }
+        f710::UdpStatePublisher publisher{argv[1], (uint16_t)((argc > 2) ? atoi(argv[2]) : 7100),
+            (argc > 3) ? atoi(argv[3]) : 2};
+        f710::Reader<DriveState> logitech_f710{js_name, &controller_state, [&publisher](DriveState& state) {
+            DriveCommand command = drive_command(state);
+            f710::DriveFrame frame{};
+            frame.left_raw = command.raw_left;
+            frame.right_raw = command.raw_right;
+            frame.left_pwm = command.pwm_left;
+            frame.right_pwm = command.pwm_right;
+            frame.flags = command.high_gear ? f710::DriveFrame::FLAG_HIGH_GEAR : 0;
+            publisher.publish(frame);
+        }, 20};
+#elif defined(F710_FULL_STATE) && defined(F710_SHM)
+        ///
+        /// Every axis and button published to the shared memory segment /f710_state at each callback,
+        /// for any number of other processes to read with ShmStateReader
+        ///
+        f710::FullControllerState full_state;
+        f710::ShmStatePublisher publisher{"/f710_state"};
+        f710::Reader<f710::FullControllerState> logitech_f710{js_name, &full_state,
+            [&publisher](f710::FullControllerState& state) {
+                publisher.publish(state.snapshot(), f710::Time::now());
+            }, 20};
+#elif defined(F710_FULL_STATE)
+        ///
+        /// Every axis and button, printing only what changed since the previous callback. The axes go
+        /// through a median + EMA + slew filter every tick, which keeps settling after the sticks stop.
+        ///
+        f710::FullControllerState full_state;
+        f710::AxisFilter axis_filter{f710::AxisFilterConfig{true, 512, 4000}};
+        int16_t filtered[f710::AxisFilter::LANES] = {};
+        f710::Reader<f710::FullControllerState> logitech_f710{js_name, &full_state,
+            [&axis_filter, &filtered, &telemetry](f710::FullControllerState& state) {
+                f710::ControllerSnapshot snapshot = state.snapshot();
+                int16_t previous[f710::AxisFilter::LANES];
+                memcpy(previous, filtered, sizeof(filtered));
+                axis_filter.apply(snapshot.axis_value, filtered);
+                for (int n = 0; n < f710::AxisFilter::LANES; n++) {
+                    if (filtered[n] != previous[n]) {
+                        telemetry.line("axis %d: %d\n", n, filtered[n]);
+                    }
+                }
+                snapshot.for_each_changed_button([&telemetry](int n, bool pressed, bool toggled) {
+                    telemetry.line("button %d: %s toggle: %d\n", n, pressed ? "down" : "up", (int)toggled);
+                });
+            }, 20};
+#else
+        f710::Reader<DriveState> logitech_f710{js_name, &controller_state, cb};
+#endif
+#ifdef EPOLL_READER
+        logitech_f710.set_hotplug(true);
+#endif
+#ifndef F710_QUEUED
+        attach_telemetry(logitech_f710, telemetry);
+#else
+        // cb writes its lines on the consumer thread, so they can not be left to the reader's loop
+#endif
+#ifdef F710_CHANGE_DRIVEN
+        logitech_f710.set_output_policy(f710::OutputPolicy::change_driven(20, 500));
+#endif
         logitech_f710.run();
+#endif
 
+    } catch(const f710::F710StopRequested&) {
+        return 0;
     } catch(const f710::F710Exception e) {
         printf("F710Exception %s", e.what());
     } catch(...) {
@@ -37,12 +37,11 @@ f710::AxisDevice::AxisDevice(int eventid) : event_number(eventid) {
 void f710::AxisDevice::add_js_event(js_event event) {
     if ((event.type != JS_EVENT_AXIS) || (event.number != event_number))
         return;
-    Time tnow = Time::now();
-    if (!is_new_event) {
-        is_new_event = true;
-    }
-    latest_event_time = event.time;
-    latest_event_value = event.value;
+    apply_matched_event(event);
+}
+void f710::AxisDevice::on_disconnect() {
+    latest_event_value = 0;
+    is_new_event = true;
 }
 /**
  *  Returns {} if there is not a new event since the last call to this function
@@ -65,11 +64,15 @@ f710::ToggleButton::ToggleButton(int button_event) {
     event_toggle_value = false;
     latest_event_time = 0;
     event_value = 0;
+    is_new_event = false;
 }
 
 void f710::ToggleButton::apply_event(js_event event) {
     if ((event.type != JS_EVENT_BUTTON) || (event.number != event_number))
         return;
+    apply_matched_event(event);
+}
+void f710::ToggleButton::apply_matched_event(js_event event) {
     latest_event_time = event.time;
     event_value = event.value;
     switch (event_state) {
@@ -77,11 +80,13 @@ void f710::ToggleButton::apply_event(js_event event) {
             if (event.value == 1) {
                 event_state = EVENT_STATE_B;
                 event_toggle_value = !event_toggle_value;
+                is_new_event = true;
             }
             break;
         case EVENT_STATE_B:
             if (event.value == 0) {
                 event_state = EVENT_STATE_A;
+                is_new_event = true;
             }
             break;
         default:
@@ -91,6 +96,11 @@ void f710::ToggleButton::apply_event(js_event event) {
 void f710::ToggleButton::apply_init_event(js_event event) {
     apply_event(event);
 }
+void f710::ToggleButton::on_disconnect() {
+    // a press in progress is lost with the device, wait for a fresh press
+    event_state = EVENT_STATE_A;
+    event_value = 0;
+}
 js_event f710::ToggleButton::get_latest_event() {
     js_event ev = {.time = latest_event_time,
                  .value = (__s16)((event_toggle_value) ? 1 : 0),
@@ -127,13 +137,26 @@ void f710::ControllerState::apply_event(js_event event)
         default:
             break;
         }
+    } else if (event.type == (JS_EVENT_AXIS | JS_EVENT_INIT)) {
+        // after a reconnect the driver replays the current stick positions as init events
+        event.type = JS_EVENT_AXIS;
+        m_left.add_js_event(event);
+        m_right.add_js_event(event);
     } else {
+        // init button events after a reconnect are ignored so they can not flip the toggle
         m_left.add_js_event(event);
         m_right.add_js_event(event);
         m_button.apply_event(event);
     }
 }
 
+void f710::ControllerState::on_disconnect()
+{
+    m_left.on_disconnect();
+    m_right.on_disconnect();
+    m_button.on_disconnect();
+}
+
 void f710::ControllerState::apply_init_event(js_event event)
 {
     assert(0);
@@ -159,3 +182,15 @@ void f710::ControllerState::apply_init_event(js_event event)
     m_right.add_js_event(event);
     m_button.apply_event(event);
 }
+
+bool f710::ControllerState::has_changed() const
+{
+    return m_left.is_new_event || m_right.is_new_event || m_button.is_new_event;
+}
+
+void f710::ControllerState::clear_changed()
+{
+    m_left.is_new_event = false;
+    m_right.is_new_event = false;
+    m_button.is_new_event = false;
+}
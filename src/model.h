@@ -45,6 +45,19 @@ namespace f710 {
          * Records the most recent event
          */
         void add_js_event(js_event event);
+        /**
+         * Records an event the caller already knows is for this axis
+         */
+        void apply_matched_event(js_event event)
+        {
+            is_new_event = true;
+            latest_event_time = event.time;
+            latest_event_value = event.value;
+        }
+        /**
+         * Back to centre, reported as a new value
+         */
+        void on_disconnect();
         /**
          *  Returns {} if there is not a new event since the last call to this function
          *  Returns the event if there has been one or more new events since the last call
@@ -66,11 +79,21 @@ namespace f710 {
         int event_state;
         uint32_t latest_event_time;
         bool event_toggle_value;
+        /// set on every press or release edge, cleared by the consumer of the state
+        bool is_new_event;
 #define EVENT_STATE_A 11 //act on a 1 ignore a 0
 #define EVENT_STATE_B 22 //ignore a 1 act on a 0
         ToggleButton(int button_event);
         void apply_event(js_event event);
+        /**
+         * apply_event() for an event the caller already knows is for this button
+         */
+        void apply_matched_event(js_event event);
         void apply_init_event(js_event event);
+        /**
+         * A press in progress is lost with the device; the toggle value is kept
+         */
+        void on_disconnect();
         js_event get_latest_event();
     };
 
@@ -89,6 +112,16 @@ namespace f710 {
         bool initialization_done();
         void apply_event(js_event event);
         void apply_init_event(js_event event);
+        /**
+         * Called by a reader when the device has gone away. The sticks are returned to centre so a robot
+         * driven from this state stops, the toggle value is kept so it survives a reconnect.
+         */
+        void on_disconnect();
+        /**
+         * True if an axis has a new value or the button has had an edge since the last clear_changed()
+         */
+        [[nodiscard]] bool has_changed() const;
+        void clear_changed();
     };
 
 } //namespace
@@ -188,6 +188,10 @@ enum class DModeButtonEventNumber {
 
 #define CONST_SELECT_TIMEOUT_INTERVAL_MS 500
 #define CONST_SELECT_TIMEOUT_EPSILON_MS 5
+///
+/// Maximum number of js_event structs pulled from the joystick fd by a single read() call
+///
+#define CONST_READ_BATCH_EVENTS 64
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,149 @@
+#ifndef f710_multi_reader_H
+#define f710_multi_reader_H
+#include <string>
+#include <functional>
+#include <vector>
+#include <cerrno>
+#include <assert.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/joystick.h>
+#include <rbl/simple_exit_guard.h>
+#include "f710_helpers.h"
+#include "f710_exceptions.h"
+#include "event_batch.h"
+#include "model.h"
+#include "model_defines.h"
+#include "reader_concept.h"
+
+namespace f710 {
+
+    ///
+    /// A reader that serves several joysticks from one thread - for example an operator controller and a
+    /// safety supervisor controller. Each controller has its own state object and its own callback.
+    ///
+    /// All device fds and a single timerfd for the output tick share one epoll instance. Fairness:
+    /// every ready device gets exactly one read (at most CONST_READ_BATCH_EVENTS events) per pass of
+    /// the loop. A device that still has buffered events stays ready (level triggered) and is read
+    /// again on the next pass, after the other ready devices have had their turn, so a stick that is
+    /// being moved continuously can not starve the other controller.
+    ///
+    /// On each tick the callbacks are called in the order the controllers were added.
+    ///
+    template <HasApplyEvent ContState>
+        class MultiReader {
+            struct Controller {
+                std::string device_name;
+                ContState* controller_state;
+                std::function<void(ContState& csref)> on_event_function;
+                int fd;
+            };
+            static constexpr uint32_t TIMER_INDEX = UINT32_MAX;
+            int m_output_interval_ms;
+            std::vector<Controller> m_controllers;
+        public:
+            explicit MultiReader(int output_interval_ms = 500) : m_output_interval_ms(output_interval_ms) {}
+            /**
+             * Registers a controller. Must be called before run().
+             * @param device_path   absolute path such as /dev/input/js1 or a name for open_fd_non_blocking
+             */
+            void add_controller(
+                std::string device_path,
+                ContState* controller_state,
+                std::function<void(ContState& csref)> on_event_function)
+            {
+                m_controllers.push_back(Controller{device_path, controller_state, on_event_function, -1});
+            }
+
+            void run()
+            {
+                exit_guard::Guard guard([this]() {
+                    for (auto& c: m_controllers) {
+                        if (c.fd != -1) {
+                            close(c.fd);
+                            c.fd = -1;
+                        }
+                    }
+                });
+                int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+                if (epoll_fd == -1) {
+                    throw F710EpollError();
+                }
+                exit_guard::Guard epoll_guard([epoll_fd]() {close(epoll_fd);});
+                for (uint32_t i = 0; i < m_controllers.size(); i++) {
+                    m_controllers[i].fd = open_fd_non_blocking(m_controllers[i].device_name);
+                    add_to_epoll(epoll_fd, m_controllers[i].fd, i);
+                }
+                int timer_fd = make_periodic_timer_fd(m_output_interval_ms);
+                exit_guard::Guard timer_guard([timer_fd]() {close(timer_fd);});
+                add_to_epoll(epoll_fd, timer_fd, TIMER_INDEX);
+
+                std::vector<epoll_event> ready(m_controllers.size() + 1);
+                while (true) {
+                    int nready = epoll_wait(epoll_fd, ready.data(), (int)ready.size(), -1);
+                    if (nready == -1) {
+                        if (errno == EINTR) {
+                            continue;
+                        }
+                        throw F710EpollError();
+                    }
+                    bool tick_due = false;
+                    for (int i = 0; i < nready; i++) {
+                        uint32_t index = ready[i].data.u32;
+                        if (index == TIMER_INDEX) {
+                            uint64_t expirations = 0;
+                            if (read(timer_fd, &expirations, sizeof(expirations)) == -1) {
+                                if ((errno != EAGAIN) && (errno != EINTR)) {
+                                    throw F710TimerError();
+                                }
+                            }
+                            tick_due = (expirations > 0);
+                        } else {
+                            read_one_batch(m_controllers[index]);
+                        }
+                    }
+                    if (tick_due) {
+                        for (auto& c: m_controllers) {
+                            c.on_event_function(*c.controller_state);
+                        }
+                    }
+                }
+            }
+
+            void operator()(){run();};
+
+        private:
+            ///
+            /// One read per ready device per pass - this is what makes the loop fair
+            ///
+            static void read_one_batch(Controller& controller)
+            {
+                js_event events[CONST_READ_BATCH_EVENTS];
+                ssize_t nread = read(controller.fd, events, sizeof(events));
+                int save_errno = errno;
+                if ((nread == 0) || ((nread == -1) && (save_errno != EAGAIN) && (save_errno != EINTR))) {
+                    throw F710ReadIOError();
+                } else if (nread == -1) {
+                    return;
+                }
+                assert(nread % sizeof(js_event) == 0);
+                size_t kept = collapse_axis_events(events, nread / sizeof(js_event));
+                for (size_t i = 0; i < kept; i++) {
+                    controller.controller_state->apply_event(events[i]);
+                }
+            }
+
+            static void add_to_epoll(int epoll_fd, int fd, uint32_t index)
+            {
+                epoll_event ev{};
+                ev.events = EPOLLIN;
+                ev.data.u32 = index;
+                if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+                    throw F710EpollError();
+                }
+            }
+        };
+} //namespace
+
+#endif
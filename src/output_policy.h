@@ -0,0 +1,77 @@
+#ifndef H_f710_output_policy_H
+#define H_f710_output_policy_H
+#include <cinttypes>
+#include "f710_time.h"
+
+namespace f710 {
+
+    ///
+    /// Says when a Reader calls its callback.
+    ///
+    /// -   FixedInterval: every interval_ms, whatever has happened (the original behaviour)
+    /// -   ChangeDriven: as soon as the state reports a change (a new axis value or a button edge), but
+    ///     never sooner than min_interval_ms after the previous call; when nothing changes the callback
+    ///     still runs every heartbeat_ms so a receiver can tell the link is alive.
+    ///
+    /// In ChangeDriven mode the call rate follows the sticks: a stick that is being moved produces
+    /// calls at up to 1000/min_interval_ms per second, a stick held still produces only heartbeats.
+    ///
+    struct OutputPolicy {
+        enum class Mode { FixedInterval, ChangeDriven };
+        Mode mode;
+        int interval_ms;
+        int min_interval_ms;
+        int heartbeat_ms;
+
+        static OutputPolicy fixed_interval(int interval_ms)
+        {
+            return OutputPolicy{Mode::FixedInterval, interval_ms, interval_ms, interval_ms};
+        }
+        static OutputPolicy change_driven(int min_interval_ms, int heartbeat_ms)
+        {
+            return OutputPolicy{Mode::ChangeDriven, heartbeat_ms, min_interval_ms, heartbeat_ms};
+        }
+        [[nodiscard]] bool is_change_driven() const { return mode == Mode::ChangeDriven; }
+    };
+
+    ///
+    /// The decision logic for OutputPolicy::Mode::ChangeDriven, independent of the event loop that uses it.
+    ///
+    class ChangeDrivenGate {
+        int64_t m_min_interval_ms;
+        int64_t m_heartbeat_ms;
+        Time m_last_output;
+    public:
+        explicit ChangeDrivenGate(const OutputPolicy& policy, Time now)
+            : m_min_interval_ms(policy.min_interval_ms), m_heartbeat_ms(policy.heartbeat_ms), m_last_output(now) {}
+        /**
+         * True if the callback should run now given whether the state has changed since it last ran
+         */
+        [[nodiscard]] bool should_fire(Time now, bool changed) const
+        {
+            if (changed && !Time::is_after(m_last_output.add_ms(m_min_interval_ms), now)) {
+                return true;
+            }
+            return !Time::is_after(m_last_output.add_ms(m_heartbeat_ms), now);
+        }
+        void fired(Time now) { m_last_output = now; }
+        /**
+         * The time at which should_fire() next needs asking: the end of the minimum interval if a change
+         * is waiting, otherwise the next heartbeat
+         */
+        [[nodiscard]] Time next_deadline(bool changed) const
+        {
+            return m_last_output.add_ms(changed ? m_min_interval_ms : m_heartbeat_ms);
+        }
+        /**
+         * next_deadline() as a relative timeout from now, never negative
+         */
+        [[nodiscard]] Time timeout(Time now, bool changed) const
+        {
+            return Time::remaining(next_deadline(changed), now);
+        }
+    };
+
+} //namespace
+
+#endif
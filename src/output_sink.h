@@ -0,0 +1,42 @@
+#ifndef H_f710_output_sink_H
+#define H_f710_output_sink_H
+#include "f710_time.h"
+
+namespace f710 {
+
+    ///
+    /// A non-blocking output that a Reader writes from inside its own event loop. The callback only
+    /// hands the sink something to send; the reader adds fd() to what it waits on for writability
+    /// whenever wants_write() says so, and calls on_writable() when it is. A slow output can therefore
+    /// never hold up reading the controller, and nothing is written from the callback itself.
+    ///
+    /// Supported by the select and epoll readers, see Reader::add_output_sink().
+    ///
+    class OutputSink {
+    public:
+        virtual ~OutputSink() = default;
+        /**
+         * -1 for a sink that has nothing to write to, whose wants_write() is then always false
+         */
+        [[nodiscard]] virtual int fd() const = 0;
+        /**
+         * True while there is something waiting to be written. Asked on every pass of the loop.
+         */
+        [[nodiscard]] virtual bool wants_write() const = 0;
+        /**
+         * fd() is writable: write as much as it takes without blocking. now is the loop's clock read.
+         */
+        virtual void on_writable(Time now) = 0;
+        /**
+         * True once the sink can never write again (its consumer went away); the reader then stops
+         * waiting on it
+         */
+        [[nodiscard]] virtual bool failed() const { return false; }
+    };
+
+    /// how many sinks one Reader can write to
+    constexpr int MAX_OUTPUT_SINKS = 4;
+
+} //namespace
+
+#endif
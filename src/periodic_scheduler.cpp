@@ -0,0 +1,58 @@
+#include "periodic_scheduler.h"
+
+f710::PeriodicScheduler::PeriodicScheduler(int64_t period_ms, OverrunPolicy policy)
+    : m_period(Time::from_ms(period_ms)), m_policy(policy), m_next_deadline(), m_tick_started(),
+    m_tick_count(0), m_overrun_count(0), m_missed_count(0)
+{
+    start(Time::now(), period_ms);
+}
+
+void f710::PeriodicScheduler::start(Time now, int64_t period_ms)
+{
+    m_period = Time::from_ms(period_ms);
+    m_next_deadline = now.add_ns(m_period.nanosecs);
+    m_tick_started = now;
+    m_tick_count = 0;
+    m_overrun_count = 0;
+    m_missed_count = 0;
+    m_lateness.reset();
+    m_callback_duration.reset();
+}
+
+void f710::PeriodicScheduler::end_tick(Time now)
+{
+    m_callback_duration.record(Time::diff(now, m_tick_started).nanosecs);
+    m_tick_count++;
+    Time next = m_next_deadline.add_ns(m_period.nanosecs);
+    if (Time::is_after(next, now)) {
+        m_next_deadline = next;
+        return;
+    }
+    m_overrun_count++;
+    // deadlines from next up to and including now have been missed
+    auto behind = (uint64_t)(Time::diff(now, next).nanosecs / m_period.nanosecs) + 1;
+    switch (m_policy) {
+        case OverrunPolicy::Skip:
+            m_missed_count += behind;
+            m_next_deadline = next.add_ns((int64_t)behind * m_period.nanosecs);
+            break;
+        case OverrunPolicy::CatchUp:
+            if (behind > MAX_CATCH_UP_TICKS) {
+                uint64_t dropped = behind - MAX_CATCH_UP_TICKS;
+                m_missed_count += dropped;
+                next = next.add_ns((int64_t)dropped * m_period.nanosecs);
+            }
+            m_next_deadline = next;
+            break;
+        case OverrunPolicy::Stretch:
+            m_next_deadline = now.add_ns(m_period.nanosecs);
+            break;
+    }
+}
+
+void f710::PeriodicScheduler::print(FILE* out) const
+{
+    fprintf(out, "ticks %lu overruns %lu missed %lu\n", m_tick_count, m_overrun_count, m_missed_count);
+    m_lateness.print(out, "tick lateness");
+    m_callback_duration.print(out, "callback duration");
+}
@@ -0,0 +1,92 @@
+#ifndef H_f710_periodic_scheduler_H
+#define H_f710_periodic_scheduler_H
+#include <cinttypes>
+#include <cstdio>
+#include "f710_time.h"
+#include "latency_histogram.h"
+
+namespace f710 {
+
+    ///
+    /// Keeps a periodic output tick on an absolute schedule: tick n is due at start + n * period, however
+    /// long reading events or the previous callback took. An event loop asks timeout() for how long it
+    /// may wait, and when is_due() it brackets the callback with begin_tick() and end_tick().
+    ///
+    /// A callback that runs past the next deadline is an overrun; what happens to the deadlines it
+    /// covered is the OverrunPolicy:
+    ///
+    /// -   Skip: the missed ticks are dropped and the next tick is the first deadline still in the
+    ///     future, so the stream stays on the original phase (the default)
+    /// -   CatchUp: the missed ticks run back to back, at most MAX_CATCH_UP_TICKS of them; any beyond
+    ///     that are dropped as for Skip
+    /// -   Stretch: the schedule restarts one period after the overrunning callback ended, so the
+    ///     interval between callbacks never drops below one period but the phase moves
+    ///
+    /// Every tick records its lateness (how long after its deadline the callback started) and the
+    /// callback's duration.
+    ///
+    class PeriodicScheduler {
+    public:
+        enum class OverrunPolicy { Skip, CatchUp, Stretch };
+        static constexpr uint64_t MAX_CATCH_UP_TICKS = 5;
+    private:
+        Time m_period;
+        OverrunPolicy m_policy;
+        Time m_next_deadline;
+        Time m_tick_started;
+        uint64_t m_tick_count;
+        uint64_t m_overrun_count;
+        uint64_t m_missed_count;
+        LatencyHistogram m_lateness;
+        LatencyHistogram m_callback_duration;
+    public:
+        explicit PeriodicScheduler(int64_t period_ms, OverrunPolicy policy = OverrunPolicy::Skip);
+        PeriodicScheduler(const PeriodicScheduler&) = delete;
+        PeriodicScheduler& operator=(const PeriodicScheduler&) = delete;
+
+        void set_overrun_policy(OverrunPolicy policy) { m_policy = policy; }
+        /**
+         * Clears the statistics and schedules the first tick one period after now
+         */
+        void start(Time now, int64_t period_ms);
+
+        [[nodiscard]] Time next_deadline() const { return m_next_deadline; }
+        [[nodiscard]] bool is_due(Time now) const { return !Time::is_after(m_next_deadline, now); }
+        /**
+         * How long an event loop may wait before the next tick, zero if it is already due
+         */
+        [[nodiscard]] Time timeout(Time now) const { return Time::remaining(m_next_deadline, now); }
+        /**
+         * Call with the current time just before running the callback for a due tick
+         */
+        void begin_tick(Time now)
+        {
+            m_lateness.record(Time::diff(now, m_next_deadline).nanosecs);
+            m_tick_started = now;
+        }
+        /**
+         * Call with the current time when the callback returns; moves the deadline on according to the
+         * overrun policy
+         */
+        void end_tick(Time now);
+
+        [[nodiscard]] uint64_t tick_count() const { return m_tick_count; }
+        /**
+         * Ticks whose callback ended at or after the following deadline
+         */
+        [[nodiscard]] uint64_t overrun_count() const { return m_overrun_count; }
+        /**
+         * Deadlines dropped without a callback - by Skip, or by CatchUp beyond its limit
+         */
+        [[nodiscard]] uint64_t missed_count() const { return m_missed_count; }
+        [[nodiscard]] const LatencyHistogram& lateness() const { return m_lateness; }
+        [[nodiscard]] const LatencyHistogram& callback_duration() const { return m_callback_duration; }
+        /**
+         * The counts and both histograms, one line each
+         */
+        void print(FILE* out) const;
+    };
+
+} //namespace
+
+#endif
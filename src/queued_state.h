@@ -0,0 +1,144 @@
+#ifndef H_f710_queued_state_H
+#define H_f710_queued_state_H
+#include <atomic>
+#include <cinttypes>
+#include <climits>
+#include <functional>
+#include <linux/futex.h>
+#include <linux/joystick.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include "f710_time.h"
+#include "reader_concept.h"
+#include "spsc_queue.h"
+
+namespace f710 {
+
+    ///
+    /// A js_event stamped with the CLOCK_MONOTONIC time it was put into the queue
+    ///
+    struct QueuedEvent {
+        js_event event;
+        uint64_t enqueue_ns;
+    };
+
+    constexpr size_t EVENT_QUEUE_CAPACITY = 1024;
+    using EventQueue = SpscQueue<QueuedEvent, EVENT_QUEUE_CAPACITY>;
+
+    inline uint64_t monotonic_now_ns()
+    {
+        return (uint64_t)Time::now().nanosecs;
+    }
+
+    ///
+    /// Lets a consumer that has found the queue empty sleep on a futex instead of spinning.
+    ///
+    /// The producer only makes a syscall when the consumer has announced it is going to sleep, so in
+    /// the busy state a push costs one extra atomic load.
+    ///
+    class ConsumerWaker {
+        alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> m_sleeping;
+    public:
+        ConsumerWaker() : m_sleeping(0) {}
+        /**
+         * Producer side - call after every successful push
+         */
+        void notify()
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_sleeping.load(std::memory_order_relaxed) != 0) {
+                m_sleeping.store(0, std::memory_order_relaxed);
+                syscall(SYS_futex, &m_sleeping, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+            }
+        }
+        /**
+         * Consumer side - sleeps until notify() or timeout_ns, unless still_empty() turns false after
+         * the intent to sleep has been published (that closes the lost wake-up race)
+         */
+        template <typename F>
+        void wait(uint64_t timeout_ns, F still_empty)
+        {
+            m_sleeping.store(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (still_empty()) {
+                timespec ts{.tv_sec = (time_t)(timeout_ns / 1000000000ULL), .tv_nsec = (long)(timeout_ns % 1000000000ULL)};
+                syscall(SYS_futex, &m_sleeping, FUTEX_WAIT_PRIVATE, 1, &ts, nullptr, 0);
+            }
+            m_sleeping.store(0, std::memory_order_relaxed);
+        }
+    };
+
+    ///
+    /// The model a Reader drives in queued mode. apply_event() only stamps the event and pushes it into the
+    /// queue, so the reader thread goes straight back to draining the device however slow the real model
+    /// and callback are. Events that do not fit are dropped and counted by the queue.
+    ///
+    class QueueingState {
+        EventQueue* m_queue;
+        ConsumerWaker* m_waker;
+    public:
+        QueueingState(EventQueue* queue, ConsumerWaker* waker) : m_queue(queue), m_waker(waker) {}
+        void apply_event(js_event event)
+        {
+            if (m_queue->try_push(QueuedEvent{event, monotonic_now_ns()})) {
+                m_waker->notify();
+            }
+        }
+        [[nodiscard]] uint64_t overflow_count() const { return m_queue->overflow_count(); }
+    };
+
+    ///
+    /// The other half of queued mode. run() on a thread of its own drains the queue into the real model
+    /// and calls the callback every output_interval_ms, sleeping on the waker when there is nothing to do.
+    ///
+    template <HasApplyEvent ContState>
+    class QueueConsumer {
+        EventQueue* m_queue;
+        ConsumerWaker* m_waker;
+        ContState* m_controller_state;
+        std::function<void(ContState& csref)> m_on_event_function;
+        uint64_t m_output_interval_ns;
+        std::atomic<bool> m_stop;
+    public:
+        QueueConsumer(
+            EventQueue* queue,
+            ConsumerWaker* waker,
+            ContState* controller_state,
+            std::function<void(ContState& csref)> on_event_function,
+            int output_interval_ms = 500)
+            : m_queue(queue), m_waker(waker), m_controller_state(controller_state),
+            m_on_event_function(on_event_function), m_output_interval_ns((uint64_t)output_interval_ms * 1000000ULL),
+            m_stop(false)
+        {}
+        /**
+         * Asks run() to return. Safe from any thread; takes effect within one output interval.
+         */
+        void stop() { m_stop.store(true, std::memory_order_relaxed); }
+
+        void run()
+        {
+            uint64_t next_tick = monotonic_now_ns() + m_output_interval_ns;
+            QueuedEvent item{};
+            while (!m_stop.load(std::memory_order_relaxed)) {
+                while (m_queue->try_pop(item)) {
+                    m_controller_state->apply_event(item.event);
+                }
+                uint64_t now = monotonic_now_ns();
+                if (now >= next_tick) {
+                    m_on_event_function(*m_controller_state);
+                    next_tick += m_output_interval_ns;
+                    if (next_tick <= now) {
+                        next_tick = now + m_output_interval_ns;
+                    }
+                    continue;
+                }
+                m_waker->wait(next_tick - now, [this]() { return m_queue->empty(); });
+            }
+        }
+        void operator()(){run();};
+    };
+
+} //namespace
+
+#endif
@@ -3,17 +3,27 @@
 #include <string>
 #include <functional>
 #include <concepts>
+#include <memory>
+#include <algorithm>
 #include <rbl/simple_exit_guard.h>
-#include "timeout_context.h"
+#include "event_source.h"
+#include "f710_exceptions.h"
+#include "reader_concept.h"
 #include "model.h"
+#include "model_defines.h"
+#include "event_batch.h"
+#include "output_policy.h"
+#include "periodic_scheduler.h"
+#include "output_sink.h"
 
 namespace f710 {
 
-    template <typename ContState>
-    concept HasApplyEvent = requires(ContState csref, js_event  arg) {
-        {csref.apply_event(arg)} -> std::same_as<void>;
-    };
-
+    ///
+    /// A Reader built on select(). In fixed interval mode the output tick is kept on an absolute
+    /// schedule by a PeriodicScheduler: the select timeout is always the time left to the next
+    /// deadline, and a due tick runs on whichever pass of the loop first sees it due, so a stream of
+    /// events can delay a tick by at most one read but can never starve it.
+    ///
     template <HasApplyEvent ContState>
         class Reader {
             bool m_is_open;
@@ -26,6 +36,11 @@ namespace f710 {
             std::string m_joy_dev;
             std::string m_joy_dev_name;
             ContState *m_controller_state;
+            OutputPolicy m_output_policy;
+            PeriodicScheduler m_scheduler;
+            std::unique_ptr<EventSource> m_source;
+            OutputSink* m_output_sinks[MAX_OUTPUT_SINKS];
+            int m_output_sink_count;
         public:
             Reader() = delete;
             explicit Reader(
@@ -34,36 +49,120 @@ namespace f710 {
                 std::function<void(ContState& csref)> on_event_function,
                 int output_interval_ms = 500
             )
-                        : m_fd(-1), m_axis_count(0), m_button_count(0),m_initialize_done(false),
-                        m_on_event_function(on_event_function), m_controller_state(controller_state),
-                        m_output_interval_ms(output_interval_ms)
+                        : Reader(std::make_unique<DeviceSource>(device_path), controller_state, on_event_function,
+                        output_interval_ms)
+            {
+            }
+            /**
+             * Reads from any EventSource - a pipe, socketpair, replayed session or generator instead of
+             * the device. run() ends with F710EndOfStream when the source runs out.
+             */
+            explicit Reader(
+                std::unique_ptr<EventSource> source,
+                ContState* controller_state,
+                std::function<void(ContState& csref)> on_event_function,
+                int output_interval_ms = 500
+            )
+                        : m_fd(-1), m_button_count(0), m_axis_count(0), m_initialize_done(false),
+                        m_output_interval_ms(output_interval_ms), m_on_event_function(on_event_function),
+                        m_controller_state(controller_state), m_scheduler(output_interval_ms),
+                        m_source(std::move(source)), m_output_sinks(), m_output_sink_count(0)
             {
-                m_joy_dev_name = device_path;
+                m_joy_dev_name = m_source->name();
                 m_is_open = false;
                 m_joy_dev = "";
+                m_output_policy = OutputPolicy::fixed_interval(output_interval_ms);
+            }
+            /**
+             * Replaces the default fixed interval policy, see output_policy.h. Call before run().
+             */
+            void set_output_policy(OutputPolicy policy) { m_output_policy = policy; }
+            /**
+             * What happens to ticks missed by a callback that overran its period, see
+             * periodic_scheduler.h. Call before run().
+             */
+            void set_overrun_policy(PeriodicScheduler::OverrunPolicy policy) { m_scheduler.set_overrun_policy(policy); }
+            /**
+             * Tick counts, lateness and callback duration statistics for the fixed interval mode
+             */
+            const PeriodicScheduler& scheduler() const { return m_scheduler; }
+            /**
+             * A non-blocking output written from this loop when its fd is writable, see output_sink.h.
+             * Not owned. Call before run(); false if there are already MAX_OUTPUT_SINKS.
+             */
+            bool add_output_sink(OutputSink* sink)
+            {
+                if (m_output_sink_count == MAX_OUTPUT_SINKS) {
+                    return false;
+                }
+                m_output_sinks[m_output_sink_count++] = sink;
+                return true;
             }
 
             void run()
             {
                 fd_set set;
-                int f710_fd = open_fd_non_blocking(m_joy_dev_name);
+                fd_set write_set;
+                int f710_fd = m_source->open();
                 this->m_is_open = false;
                 exit_guard::Guard guard([f710_fd]() {close(f710_fd);});
-                SelectTimeoutContext to_context(CONST_SELECT_TIMEOUT_INTERVAL_MS, m_output_interval_ms);
-                struct timeval tv = to_context.current_timeout();
+                Time now = Time::now();
+                m_scheduler.start(now, m_output_policy.interval_ms);
+                struct timeval tv = m_scheduler.timeout(now).as_timeval();
+                ChangeDrivenGate gate(m_output_policy, now);
                 while (true) {
                     FD_ZERO(&set);
                     FD_SET(f710_fd, &set);
-                    int select_out = select(f710_fd + 1, &set, nullptr, nullptr, &tv);
+                    int max_fd = f710_fd;
+                    bool want_write[MAX_OUTPUT_SINKS];
+                    bool any_write = false;
+                    FD_ZERO(&write_set);
+                    for (int i = 0; i < m_output_sink_count; i++) {
+                        want_write[i] = m_output_sinks[i]->wants_write();
+                        if (want_write[i]) {
+                            FD_SET(m_output_sinks[i]->fd(), &write_set);
+                            max_fd = std::max(max_fd, m_output_sinks[i]->fd());
+                            any_write = true;
+                        }
+                    }
+                    int select_out = select(max_fd + 1, &set, any_write ? &write_set : nullptr, nullptr, &tv);
+                    ///
+                    /// one clock read per pass of the loop, everything below uses this value
+                    ///
+                    now = Time::now();
                     if (select_out == -1) {
                         throw F710SelectError();
-                    } else if (select_out == 0) {
-                        m_on_event_function(*m_controller_state);
-                        tv = to_context.after_select_timedout();
-                    } else {
+                    } else if (select_out > 0) {
                         if (FD_ISSET(f710_fd, &set)) {
+#if defined(F710_READBATCH)
+                            ///
+                            /// This block pulls the whole driver buffer into a fixed array with one read, drops
+                            /// all but the latest value of each axis and applies what is left. It only goes
+                            /// round again if the array was filled - a short read means the buffer is drained
+                            ///
+                            js_event events[CONST_READ_BATCH_EVENTS];
+                            bool drained = false;
+                            while (!drained) {
+                                int nread = read(f710_fd, events, sizeof(events));
+                                int save_errno = errno;
+                                if (nread == 0) {
+                                    throw F710EndOfStream();
+                                } else if ((nread == -1) && save_errno != EAGAIN) {
+                                    throw F710ReadIOError();
+                                } else if (nread > 0) {
+                                    assert(nread % sizeof(js_event) == 0);
+                                    size_t count = nread / sizeof(js_event);
+                                    size_t kept = collapse_axis_events(events, count);
+                                    for (size_t i = 0; i < kept; i++) {
+                                        m_controller_state->apply_event(events[i]);
+                                    }
+                                    drained = (count < CONST_READ_BATCH_EVENTS);
+                                } else if (nread == -1) {
+                                    drained = true;
+                                }
+                            }
+#elif defined(F710_READLOOP)
                             js_event event;
-#ifdef F710_READLOOP
                             ///
                             /// This block reads all available events and may get stuck here is the driver keeps moving
                             /// one of the axis controls
@@ -72,32 +171,51 @@ namespace f710 {
                             while (!eagain_break) {
                                 int nread = read(f710_fd, &event, sizeof(js_event));
                                 int save_errno = errno;
-                                if ((nread == 0) || ((nread == -1) && save_errno != EAGAIN)) {
+                                if (nread == 0) {
+                                    throw F710EndOfStream();
+                                } else if ((nread == -1) && save_errno != EAGAIN) {
                                     throw F710ReadIOError();
                                 } else if (nread > 0) {
                                     assert(nread == sizeof(js_event));
                                     m_controller_state->apply_event(event);
-                                    tv = to_context.after_js_event();
                                 } else if (nread == -1) {
                                     eagain_break = true;;
                                 }
                             }
 #else
+                            js_event event;
                             ///
                             /// This reads only a single event before checking select - this increases the
                             /// number of select calls a lot
                             ///
                             int nread = read(f710_fd, &event, sizeof(js_event));
                             int save_errno = errno;
-                            if ((nread == 0) || ((nread == -1) && save_errno != EAGAIN)) {
+                            if (nread == 0) {
+                                throw F710EndOfStream();
+                            } else if ((nread == -1) && save_errno != EAGAIN) {
                                 throw F710ReadIOError();
                             } else if (nread > 0) {
                                 assert(nread == sizeof(js_event));
                                 m_controller_state->apply_event(event);
-                                tv = to_context.after_js_event();
                             }
 #endif
                         }
+                        for (int i = 0; i < m_output_sink_count; i++) {
+                            if (want_write[i] && FD_ISSET(m_output_sinks[i]->fd(), &write_set)) {
+                                m_output_sinks[i]->on_writable(now);
+                            }
+                        }
+                    }
+                    if (m_output_policy.is_change_driven()) {
+                        tv = apply_change_driven_policy(gate, now);
+                    } else {
+                        if (m_scheduler.is_due(now)) {
+                            m_scheduler.begin_tick(now);
+                            m_on_event_function(*m_controller_state);
+                            now = Time::now();
+                            m_scheduler.end_tick(now);
+                        }
+                        tv = m_scheduler.timeout(now).as_timeval();
                     }
                 }
                 close(f710_fd);
@@ -105,6 +223,22 @@ namespace f710 {
 
             void operator()(){run();};
 
+        private:
+            ///
+            /// Runs the callback if the gate says so and returns the select timeout to the next decision point
+            ///
+            timeval apply_change_driven_policy(ChangeDrivenGate& gate, Time now)
+            {
+                bool changed = state_has_changed(*m_controller_state);
+                if (gate.should_fire(now, changed)) {
+                    m_on_event_function(*m_controller_state);
+                    state_clear_changed(*m_controller_state);
+                    gate.fired(now);
+                    changed = false;
+                }
+                return gate.timeout(now, changed).as_timeval();
+            }
+
         };
 } //namespace
 
@@ -0,0 +1,46 @@
+#ifndef f710_reader_concept_H
+#define f710_reader_concept_H
+#include <concepts>
+#include <linux/joystick.h>
+
+namespace f710 {
+
+    ///
+    /// Every Reader implementation drives a controller state model through this single entry point.
+    ///
+    template <typename ContState>
+    concept HasApplyEvent = requires(ContState csref, js_event  arg) {
+        {csref.apply_event(arg)} -> std::same_as<void>;
+    };
+
+    ///
+    /// A state that can say whether anything has changed since the last time it was told to forget.
+    /// Readers use this for the change-driven output policy; a state without it is treated as always changed.
+    ///
+    template <typename ContState>
+    concept HasChangeTracking = requires(ContState csref) {
+        {csref.has_changed()} -> std::convertible_to<bool>;
+        {csref.clear_changed()} -> std::same_as<void>;
+    };
+
+    template <typename ContState>
+    bool state_has_changed(ContState& state)
+    {
+        if constexpr (HasChangeTracking<ContState>) {
+            return state.has_changed();
+        } else {
+            return true;
+        }
+    }
+
+    template <typename ContState>
+    void state_clear_changed(ContState& state)
+    {
+        if constexpr (HasChangeTracking<ContState>) {
+            state.clear_changed();
+        }
+    }
+
+} //namespace
+
+#endif
@@ -0,0 +1,20 @@
+#include "replay_source.h"
+
+void f710::ReplaySource::produce()
+{
+    const bool paced = (m_speed > 0.0);
+    m_session.rewind();
+    Time start = Time::now();
+    js_event event;
+    while (m_session.next(event)) {
+        if (paced && !sleep_until(m_session.due(start, m_speed))) {
+            return;
+        }
+        if (!write(event)) {
+            return;
+        }
+        if (paced && !flush()) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef H_f710_replay_source_H
+#define H_f710_replay_source_H
+#include <string>
+#include "event_source.h"
+#include "session_replay.h"
+
+namespace f710 {
+
+    ///
+    /// Plays a recorded session (session_replay.h) into a Reader through a socketpair, so the whole read
+    /// loop runs on recorded input. speed is as for SessionReplay::replay: 1.0 for the recorded timing,
+    /// N for N times faster, 0 for as fast as the Reader will take the events. End of the recording
+    /// is end of stream.
+    ///
+    class ReplaySource: public ThreadedSource {
+        SessionReplay m_session;
+        double m_speed;
+    public:
+        ReplaySource(const std::string& path, double speed) : m_session(path), m_speed(speed) {}
+        ~ReplaySource() override { stop(); }
+        [[nodiscard]] std::string name() const override { return m_session.device_name(); }
+    protected:
+        void produce() override;
+    };
+
+} //namespace
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef H_f710_response_curve_H
+#define H_f710_response_curve_H
+#include <cinttypes>
+#include <climits>
+
+namespace f710 {
+
+    ///
+    /// How a raw axis value (-32768 .. 32767) becomes a motor command, applied in this order:
+    ///
+    /// -   invert: use -value, the F710 sticks report forward as negative
+    /// -   deadzone: |value| <= deadzone gives 0, so a stick that does not quite return to centre does
+    ///     not creep the robot; the rest of the travel is rescaled to start from 0
+    /// -   expo: 0 is linear, 1 is cubic - more resolution near centre, full output at full travel
+    /// -   band: any travel outside the deadzone gives between pwm_min and pwm_max, with the input's sign
+    /// -   clamp: the result is limited to -clamp .. clamp
+    ///
+    /// With deadzone 0 and expo 0 the result is exactly that of the original scale() in main.cpp, which
+    /// is band(30, 60) for low gear and band(50, 85) for high gear.
+    ///
+    struct ResponseCurve {
+        int deadzone;
+        double expo;
+        int pwm_min;
+        int pwm_max;
+        int clamp;
+        bool invert;
+
+        static constexpr ResponseCurve band(int pwm_min, int pwm_max)
+        {
+            return ResponseCurve{0, 0.0, pwm_min, pwm_max, pwm_max, false};
+        }
+        [[nodiscard]] constexpr ResponseCurve with_deadzone(int dz) const
+        {
+            ResponseCurve c = *this;
+            c.deadzone = dz;
+            return c;
+        }
+        [[nodiscard]] constexpr ResponseCurve with_expo(double e) const
+        {
+            ResponseCurve c = *this;
+            c.expo = e;
+            return c;
+        }
+        [[nodiscard]] constexpr ResponseCurve inverted() const
+        {
+            ResponseCurve c = *this;
+            c.invert = !c.invert;
+            return c;
+        }
+    };
+
+    namespace detail {
+        /// std::round is not constexpr in C++20; this rounds half away from zero the same way
+        constexpr double round_half_away(double x)
+        {
+            if (x < 0) {
+                return -round_half_away(-x);
+            }
+            auto whole = (double)(int64_t)x;
+            return (x - whole >= 0.5) ? whole + 1.0 : whole;
+        }
+    }
+
+    ///
+    /// The curve's output for one raw value. Slow (float division, a cube, rounding), the tables below
+    /// call it once per possible input.
+    ///
+    constexpr int response_value(const ResponseCurve& curve, int raw)
+    {
+        int value = curve.invert ? -raw : raw;
+        if (value == 0) {
+            return 0;
+        }
+        int sign = (value < 0) ? -1 : 1;
+        int magnitude = value * sign;
+        if (magnitude <= curve.deadzone) {
+            return 0;
+        }
+        // the same float division as the original scale(), so deadzone 0 and expo 0 reproduce it exactly
+        double x = (float)(magnitude - curve.deadzone) / (float)(INT16_MAX - curve.deadzone);
+        if (curve.expo != 0.0) {
+            x = (1.0 - curve.expo) * x + curve.expo * x * x * x;
+        }
+        double pwm = sign * (detail::round_half_away(x * (double)(curve.pwm_max - curve.pwm_min)) + curve.pwm_min);
+        if (pwm > curve.clamp) {
+            pwm = curve.clamp;
+        } else if (pwm < -curve.clamp) {
+            pwm = -curve.clamp;
+        }
+        return (int)pwm;
+    }
+
+    ///
+    /// A ResponseCurve evaluated for every int16 input: mapping an axis value is one byte load.
+    ///
+    /// When the curve is a constant the table is built by the compiler:
+    ///
+    ///     static constexpr ResponseTable LOW_GEAR{ResponseCurve::band(30, 60).with_deadzone(1000)};
+    ///
+    /// otherwise (a curve read from a config file, say) it is built at startup by the same constructor.
+    /// Outputs are limited to what fits in an int8_t, which covers PWM percentages.
+    ///
+    class ResponseTable {
+        int8_t m_values[1 << 16];
+    public:
+        explicit constexpr ResponseTable(const ResponseCurve& curve) : m_values()
+        {
+            for (int raw = INT16_MIN; raw <= INT16_MAX; raw++) {
+                int v = response_value(curve, raw);
+                m_values[(uint16_t)raw] = (int8_t)((v > INT8_MAX) ? INT8_MAX : (v < INT8_MIN) ? INT8_MIN : v);
+            }
+        }
+        constexpr int8_t operator()(int16_t raw) const { return m_values[(uint16_t)raw]; }
+    };
+
+    ///
+    /// The stick to PWM mapping main.cpp drives the robot with: the sticks report forward as negative so
+    /// the curves invert, A toggles between the 30-60 and 50-85 bands, and travel within the deadzone of
+    /// centre is a stop. Here rather than in main.cpp so the tests can check them.
+    ///
+    constexpr int AXIS_DEADZONE = 1000;
+    constexpr ResponseCurve LOW_GEAR_CURVE = ResponseCurve::band(30, 60).with_deadzone(AXIS_DEADZONE).inverted();
+    constexpr ResponseCurve HIGH_GEAR_CURVE = ResponseCurve::band(50, 85).with_deadzone(AXIS_DEADZONE).inverted();
+
+    static_assert(response_value(ResponseCurve::band(30, 60), 0) == 0);
+    static_assert(response_value(ResponseCurve::band(30, 60), 1) == 30);
+    static_assert(response_value(ResponseCurve::band(30, 60), INT16_MAX) == 60);
+    static_assert(response_value(ResponseCurve::band(30, 60), INT16_MIN) == -60);
+    static_assert(response_value(ResponseCurve::band(50, 85), -16384) == -68);
+    static_assert(response_value(ResponseCurve::band(50, 85).inverted(), -16384) == 68);
+    static_assert(response_value(ResponseCurve::band(30, 60).with_deadzone(1000), 1000) == 0);
+    static_assert(response_value(ResponseCurve::band(30, 60).with_deadzone(1000), 1001) == 30);
+    static_assert(response_value(ResponseCurve::band(30, 60).with_deadzone(1000), INT16_MAX) == 60);
+    static_assert(response_value(ResponseCurve::band(30, 60).with_expo(1.0), INT16_MAX / 2) == 34);
+    static_assert(response_value(ResponseCurve{0, 0.0, 30, 60, 45, false}, INT16_MAX) == 45);
+
+} //namespace
+
+#endif
@@ -0,0 +1,130 @@
+#include "serial_sink.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+#include "f710_exceptions.h"
+
+namespace {
+    speed_t baud_constant(int baud)
+    {
+        switch (baud) {
+            case 9600: return B9600;
+            case 19200: return B19200;
+            case 38400: return B38400;
+            case 57600: return B57600;
+            case 115200: return B115200;
+            case 230400: return B230400;
+            case 460800: return B460800;
+            case 921600: return B921600;
+            default: return B0;
+        }
+    }
+}
+
+f710::SerialSink::SerialSink(const std::string& device_path, int baud, int max_queued_bytes)
+    : m_fd(-1), m_max_queued_bytes(max_queued_bytes), m_pending(), m_in_flight(), m_first_submit(),
+    m_submitted(0), m_superseded(0), m_commands_written(0), m_bytes_written(0), m_would_block(0)
+{
+    m_fd = open(device_path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (m_fd < 0) {
+        throw F710SerialError();
+    }
+    termios tio{};
+    if (tcgetattr(m_fd, &tio) != 0) {
+        close(m_fd);
+        throw F710SerialError();
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    if (baud != 0) {
+        speed_t speed = baud_constant(baud);
+        if ((speed == B0) || (cfsetspeed(&tio, speed) != 0)) {
+            close(m_fd);
+            throw F710SerialError();
+        }
+    }
+    if (tcsetattr(m_fd, TCSANOW, &tio) != 0) {
+        close(m_fd);
+        throw F710SerialError();
+    }
+}
+f710::SerialSink::~SerialSink()
+{
+    close(m_fd);
+}
+bool f710::SerialSink::submit(const char* data, size_t size, Time now)
+{
+    if (size > MAX_COMMAND_SIZE) {
+        return false;
+    }
+    if (m_submitted == 0) {
+        m_first_submit = now;
+    }
+    m_submitted++;
+    if (m_pending.size != 0) {
+        m_superseded++;
+    }
+    memcpy(m_pending.data, data, size);
+    m_pending.size = size;
+    m_pending.written = 0;
+    m_pending.submitted = now;
+    return true;
+}
+bool f710::SerialSink::wants_write() const
+{
+    if (m_in_flight.size != 0) {
+        return true;
+    }
+    if (m_pending.size == 0) {
+        return false;
+    }
+    if (m_max_queued_bytes > 0) {
+        int queued = 0;
+        if ((ioctl(m_fd, TIOCOUTQ, &queued) == 0) && (queued > m_max_queued_bytes)) {
+            // asked again on the next pass of the loop, at the latest the next tick
+            return false;
+        }
+    }
+    return true;
+}
+void f710::SerialSink::on_writable(Time now)
+{
+    while (true) {
+        if (m_in_flight.size == 0) {
+            if (m_pending.size == 0) {
+                return;
+            }
+            m_in_flight = m_pending;
+            m_pending.size = 0;
+        }
+        ssize_t n = write(m_fd, m_in_flight.data + m_in_flight.written, m_in_flight.size - m_in_flight.written);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                m_would_block++;
+                return;
+            }
+            throw F710SerialError();
+        }
+        m_bytes_written += (uint64_t)n;
+        m_in_flight.written += (size_t)n;
+        if (m_in_flight.written == m_in_flight.size) {
+            m_commands_written++;
+            m_write_latency.record(Time::diff(now, m_in_flight.submitted).nanosecs);
+            m_in_flight.size = 0;
+        }
+    }
+}
+void f710::SerialSink::print(FILE* out, Time now) const
+{
+    double seconds = (double)Time::diff(now, m_first_submit).nanosecs / 1e9;
+    fprintf(out, "commands submitted %lu written %lu superseded %lu bytes %lu (%.0f bytes/s) would block %lu\n",
+            m_submitted, m_commands_written, m_superseded, m_bytes_written,
+            (seconds > 0) ? (double)m_bytes_written / seconds : 0.0, m_would_block);
+    m_write_latency.print(out, "submit to written");
+}
@@ -0,0 +1,82 @@
+#ifndef H_f710_serial_sink_H
+#define H_f710_serial_sink_H
+#include <cinttypes>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include "f710_time.h"
+#include "latency_histogram.h"
+#include "output_sink.h"
+
+namespace f710 {
+
+    ///
+    /// Motor commands to a serial (tty) motor controller, as an OutputSink.
+    ///
+    /// The port is opened non-blocking and raw. submit() puts a command in a single latest-wins slot:
+    /// a command still waiting there when the next one is submitted is replaced and counted as
+    /// superseded, so a UART slower than the command rate only ever sends the newest command and never
+    /// works through a backlog of stale ones. A command the kernel has partly taken is always finished
+    /// first so the controller never sees half a command.
+    ///
+    /// The kernel's own tty buffer can hold a backlog too. With max_queued_bytes > 0 the slot is only
+    /// written once the driver's output queue (TIOCOUTQ) is down to that many bytes, which keeps the
+    /// backlog to about one command on a real UART. A pty always reports an empty queue.
+    ///
+    class SerialSink: public OutputSink {
+    public:
+        static constexpr size_t MAX_COMMAND_SIZE = 64;
+    private:
+        struct Slot {
+            char data[MAX_COMMAND_SIZE];
+            size_t size;
+            size_t written;
+            Time submitted;
+        };
+        int m_fd;
+        int m_max_queued_bytes;
+        Slot m_pending;
+        Slot m_in_flight;
+        Time m_first_submit;
+        uint64_t m_submitted;
+        uint64_t m_superseded;
+        uint64_t m_commands_written;
+        uint64_t m_bytes_written;
+        uint64_t m_would_block;
+        LatencyHistogram m_write_latency;
+    public:
+        /**
+         * Opens and configures the port; throws F710SerialError. baud 0 leaves the speed as it is.
+         */
+        explicit SerialSink(const std::string& device_path, int baud = 115200, int max_queued_bytes = 0);
+        ~SerialSink() override;
+        SerialSink(const SerialSink&) = delete;
+        SerialSink& operator=(const SerialSink&) = delete;
+
+        /**
+         * Replaces whatever is waiting in the slot. False (and nothing changes) if size is over
+         * MAX_COMMAND_SIZE.
+         */
+        bool submit(const char* data, size_t size, Time now);
+
+        [[nodiscard]] int fd() const override { return m_fd; }
+        [[nodiscard]] bool wants_write() const override;
+        void on_writable(Time now) override;
+
+        [[nodiscard]] uint64_t submitted() const { return m_submitted; }
+        [[nodiscard]] uint64_t superseded() const { return m_superseded; }
+        [[nodiscard]] uint64_t commands_written() const { return m_commands_written; }
+        [[nodiscard]] uint64_t bytes_written() const { return m_bytes_written; }
+        /// write() calls that found the port full
+        [[nodiscard]] uint64_t would_block() const { return m_would_block; }
+        /// submit() to the last byte of the command accepted by the kernel, in ns
+        [[nodiscard]] const LatencyHistogram& write_latency() const { return m_write_latency; }
+        /**
+         * One line of counts and bytes/s since the first submit, and the write latency percentiles
+         */
+        void print(FILE* out, Time now) const;
+    };
+
+} //namespace
+
+#endif
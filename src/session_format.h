@@ -0,0 +1,102 @@
+#ifndef H_f710_session_format_H
+#define H_f710_session_format_H
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+#include <endian.h>
+
+namespace f710 {
+
+    ///
+    /// On-disk layout of a recorded session (.f710s file). All integers are little endian; the header
+    /// goes through encode_header()/decode_header() so a file moves between hosts of either byte order.
+    ///
+    ///     SessionHeader                                   (SESSION_HEADER_SIZE bytes, no padding)
+    ///     char device_name[header.device_name_length]     (not 0 terminated)
+    ///     record*
+    ///
+    /// Each record is one js_event:
+    ///
+    ///     varint  time delta in ms from the previous record (the first record from 0), modulo 2^32
+    ///     varint  zigzag encoded value
+    ///     uint8   type
+    ///     uint8   number
+    ///
+    /// so a typical stick event takes 4 to 6 bytes instead of 8. The file is append-only; a record cut
+    /// short by a crash is simply where replay stops.
+    ///
+    struct SessionHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t device_name_length;
+        int64_t open_monotonic_ns;
+        int64_t open_realtime_ns;
+    };
+    constexpr char SESSION_MAGIC[8] = {'F', '7', '1', '0', 'S', 'E', 'S', '\0'};
+    constexpr uint32_t SESSION_VERSION = 1;
+    constexpr size_t SESSION_MAX_RECORD_SIZE = 5 + 3 + 1 + 1;
+    constexpr size_t SESSION_HEADER_SIZE = 32;
+    static_assert(sizeof(SessionHeader) == SESSION_HEADER_SIZE, "SessionHeader must have no padding");
+
+    /**
+     * header in its on-disk, little endian form
+     */
+    inline void encode_header(const SessionHeader& header, uint8_t* out)
+    {
+        SessionHeader le = header;
+        le.version = htole32(header.version);
+        le.device_name_length = htole32(header.device_name_length);
+        le.open_monotonic_ns = (int64_t)htole64((uint64_t)header.open_monotonic_ns);
+        le.open_realtime_ns = (int64_t)htole64((uint64_t)header.open_realtime_ns);
+        memcpy(out, &le, SESSION_HEADER_SIZE);
+    }
+    inline SessionHeader decode_header(const uint8_t* in)
+    {
+        SessionHeader header;
+        memcpy(&header, in, SESSION_HEADER_SIZE);
+        header.version = le32toh(header.version);
+        header.device_name_length = le32toh(header.device_name_length);
+        header.open_monotonic_ns = (int64_t)le64toh((uint64_t)header.open_monotonic_ns);
+        header.open_realtime_ns = (int64_t)le64toh((uint64_t)header.open_realtime_ns);
+        return header;
+    }
+
+    inline uint32_t zigzag_encode(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+    inline int32_t zigzag_decode(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+    /**
+     * Writes v at p and returns the position after it - at most 5 bytes
+     */
+    inline uint8_t* varint_encode(uint8_t* p, uint32_t v)
+    {
+        while (v >= 0x80) {
+            *p++ = (uint8_t)(v | 0x80);
+            v >>= 7;
+        }
+        *p++ = (uint8_t)v;
+        return p;
+    }
+    /**
+     * Reads a varint starting at p, never reading at or past end. Returns nullptr if the varint is
+     * truncated or longer than 5 bytes.
+     */
+    inline const uint8_t* varint_decode(const uint8_t* p, const uint8_t* end, uint32_t& v)
+    {
+        uint32_t result = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            if (p >= end) {
+                return nullptr;
+            }
+            uint8_t b = *p++;
+            result |= (uint32_t)(b & 0x7F) << shift;
+            if ((b & 0x80) == 0) {
+                v = result;
+                return p;
+            }
+        }
+        return nullptr;
+    }
+
+} //namespace
+
+#endif
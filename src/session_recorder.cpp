@@ -0,0 +1,73 @@
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include "f710_exceptions.h"
+#include "session_recorder.h"
+
+namespace {
+    void write_all(int fd, const void* data, size_t length)
+    {
+        auto p = (const uint8_t*)data;
+        while (length > 0) {
+            ssize_t n = write(fd, p, length);
+            if (n == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw f710::F710SessionFileError();
+            }
+            p += n;
+            length -= n;
+        }
+    }
+}
+
+f710::SessionRecorder::SessionRecorder(const std::string& path, const std::string& device_name)
+    : m_fd(-1), m_last_time_ms(0), m_event_count(0), m_last_flush(Time::now()), m_used(0)
+{
+    m_fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (m_fd == -1) {
+        throw F710SessionFileError();
+    }
+    timespec realtime{};
+    clock_gettime(CLOCK_REALTIME, &realtime);
+    SessionHeader header{};
+    memcpy(header.magic, SESSION_MAGIC, sizeof(header.magic));
+    header.version = SESSION_VERSION;
+    header.device_name_length = (uint32_t)device_name.size();
+    header.open_monotonic_ns = m_last_flush.nanosecs;
+    header.open_realtime_ns = (int64_t)realtime.tv_sec * 1000000000LL + realtime.tv_nsec;
+    uint8_t encoded[SESSION_HEADER_SIZE];
+    encode_header(header, encoded);
+    write_all(m_fd, encoded, sizeof(encoded));
+    write_all(m_fd, device_name.data(), device_name.size());
+}
+
+f710::SessionRecorder::~SessionRecorder()
+{
+    try {
+        flush();
+    } catch (...) {
+    }
+    close(m_fd);
+}
+
+void f710::SessionRecorder::flush_if_due(Time now)
+{
+    if ((m_used > 0) && (Time::diff(now, m_last_flush).nanosecs >= Time::from_ms(FLUSH_INTERVAL_MS).nanosecs)) {
+        flush();
+    }
+}
+
+void f710::SessionRecorder::flush()
+{
+    m_last_flush = Time::now();
+    if (m_used == 0) {
+        return;
+    }
+    size_t used = m_used;
+    m_used = 0;
+    write_all(m_fd, m_buffer, used);
+}
@@ -0,0 +1,91 @@
+#ifndef H_f710_session_recorder_H
+#define H_f710_session_recorder_H
+#include <cinttypes>
+#include <string>
+#include <linux/joystick.h>
+#include "f710_time.h"
+#include "reader_concept.h"
+#include "session_format.h"
+
+namespace f710 {
+
+    ///
+    /// Appends js_events to a session file (see session_format.h).
+    ///
+    /// Records are encoded into an in-memory buffer and written out when it fills, when more than
+    /// FLUSH_INTERVAL_MS has passed since the last write, on flush() and in the destructor. So at most
+    /// about a second of input is lost if the process dies.
+    ///
+    class SessionRecorder {
+        static constexpr size_t BUFFER_SIZE = 64 * 1024;
+        static constexpr int FLUSH_INTERVAL_MS = 1000;
+        int m_fd;
+        uint32_t m_last_time_ms;
+        uint64_t m_event_count;
+        Time m_last_flush;
+        size_t m_used;
+        uint8_t m_buffer[BUFFER_SIZE];
+    public:
+        /**
+         * Creates (or truncates) path and writes the header. device_name is whatever the Reader was
+         * given, the open time is now.
+         */
+        SessionRecorder(const std::string& path, const std::string& device_name);
+        ~SessionRecorder();
+        SessionRecorder(const SessionRecorder&) = delete;
+        SessionRecorder& operator=(const SessionRecorder&) = delete;
+
+        void record(const js_event& event)
+        {
+            if (m_used + SESSION_MAX_RECORD_SIZE > BUFFER_SIZE) {
+                flush();
+            }
+            uint8_t* p = m_buffer + m_used;
+            p = varint_encode(p, event.time - m_last_time_ms);
+            p = varint_encode(p, zigzag_encode(event.value));
+            *p++ = event.type;
+            *p++ = event.number;
+            m_used = p - m_buffer;
+            m_last_time_ms = event.time;
+            m_event_count++;
+            flush_if_due(Time::now());
+        }
+        /**
+         * Writes the buffer out if FLUSH_INTERVAL_MS has passed since the last write. record() calls it,
+         * call it from the output tick as well so the tail of a burst is not held back until the next event
+         */
+        void flush_if_due(Time now);
+        void flush();
+        [[nodiscard]] uint64_t event_count() const { return m_event_count; }
+    };
+
+    ///
+    /// Wraps any model so that every event a Reader applies to it is also recorded. Use it as the
+    /// Reader's state type and unwrap it in the callback with inner().
+    ///
+    template <HasApplyEvent ContState>
+    class RecordingState {
+        ContState* m_inner;
+        SessionRecorder* m_recorder;
+    public:
+        RecordingState(ContState* inner, SessionRecorder* recorder) : m_inner(inner), m_recorder(recorder) {}
+        void apply_event(js_event event)
+        {
+            m_recorder->record(event);
+            m_inner->apply_event(event);
+        }
+        bool has_changed() { return state_has_changed(*m_inner); }
+        void clear_changed() { state_clear_changed(*m_inner); }
+        void on_disconnect()
+        {
+            if constexpr (requires (ContState& cs) { cs.on_disconnect(); }) {
+                m_inner->on_disconnect();
+            }
+        }
+        ContState& inner() { return *m_inner; }
+        SessionRecorder& recorder() { return *m_recorder; }
+    };
+
+} //namespace
+
+#endif
@@ -0,0 +1,54 @@
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <rbl/simple_exit_guard.h>
+#include "f710_exceptions.h"
+#include "session_replay.h"
+
+f710::SessionReplay::SessionReplay(const std::string& path)
+    : m_map(nullptr), m_map_size(0), m_header(), m_records(nullptr), m_pos(nullptr), m_end(nullptr),
+    m_last_time_ms(0), m_elapsed_ms(0), m_started(false)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        throw F710SessionFileError();
+    }
+    exit_guard::Guard guard([fd]() {close(fd);});
+    struct stat st{};
+    if ((fstat(fd, &st) == -1) || ((size_t)st.st_size < sizeof(SessionHeader))) {
+        throw F710SessionFileError();
+    }
+    m_map_size = (size_t)st.st_size;
+    void* map = mmap(nullptr, m_map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        throw F710SessionFileError();
+    }
+    m_map = (const uint8_t*)map;
+    madvise(map, m_map_size, MADV_SEQUENTIAL);
+    m_header = decode_header(m_map);
+    if ((memcmp(m_header.magic, SESSION_MAGIC, sizeof(SESSION_MAGIC)) != 0)
+        || (m_header.version != SESSION_VERSION)
+        || (m_header.device_name_length > m_map_size - sizeof(SessionHeader))) {
+        munmap(map, m_map_size);
+        throw F710SessionFileError();
+    }
+    m_device_name.assign((const char*)m_map + sizeof(SessionHeader), m_header.device_name_length);
+    m_records = m_map + sizeof(SessionHeader) + m_header.device_name_length;
+    m_end = m_map + m_map_size;
+    rewind();
+}
+
+f710::SessionReplay::~SessionReplay()
+{
+    munmap((void*)m_map, m_map_size);
+}
+
+void f710::SessionReplay::rewind()
+{
+    m_pos = m_records;
+    m_last_time_ms = 0;
+    m_elapsed_ms = 0;
+    m_started = false;
+}
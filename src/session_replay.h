@@ -0,0 +1,116 @@
+#ifndef H_f710_session_replay_H
+#define H_f710_session_replay_H
+#include <cerrno>
+#include <cinttypes>
+#include <functional>
+#include <string>
+#include <time.h>
+#include <linux/joystick.h>
+#include "f710_time.h"
+#include "reader_concept.h"
+#include "session_format.h"
+
+namespace f710 {
+
+    ///
+    /// Reads a session file recorded by SessionRecorder. The file is mmapped read-only and decoded in
+    /// place, so replay costs no syscalls per event and no copies.
+    ///
+    class SessionReplay {
+        const uint8_t* m_map;
+        size_t m_map_size;
+        SessionHeader m_header;
+        std::string m_device_name;
+        const uint8_t* m_records;
+        const uint8_t* m_pos;
+        const uint8_t* m_end;
+        uint32_t m_last_time_ms;
+        uint64_t m_elapsed_ms;
+        bool m_started;
+    public:
+        /**
+         * Throws F710SessionFileError if path can not be opened or is not a session file
+         */
+        explicit SessionReplay(const std::string& path);
+        ~SessionReplay();
+        SessionReplay(const SessionReplay&) = delete;
+        SessionReplay& operator=(const SessionReplay&) = delete;
+
+        [[nodiscard]] const std::string& device_name() const { return m_device_name; }
+        [[nodiscard]] Time open_monotonic() const { return Time::from_ns(m_header.open_monotonic_ns); }
+        [[nodiscard]] int64_t open_realtime_ns() const { return m_header.open_realtime_ns; }
+        /**
+         * Milliseconds from the first event to the one last returned by next()
+         */
+        [[nodiscard]] uint64_t elapsed_ms() const { return m_elapsed_ms; }
+        /**
+         * Decodes the next event. Returns false at the end of the recording, including when the last
+         * record was cut short.
+         */
+        bool next(js_event& event)
+        {
+            uint32_t delta;
+            uint32_t value;
+            const uint8_t* p = varint_decode(m_pos, m_end, delta);
+            if (p == nullptr) {
+                return false;
+            }
+            p = varint_decode(p, m_end, value);
+            if ((p == nullptr) || (m_end - p < 2)) {
+                return false;
+            }
+            m_last_time_ms += delta;
+            // the first delta is from 0, ie the absolute driver time, and does not count as elapsed
+            m_elapsed_ms += m_started ? delta : 0;
+            m_started = true;
+            event.time = m_last_time_ms;
+            event.value = (int16_t)zigzag_decode(value);
+            event.type = p[0];
+            event.number = p[1];
+            m_pos = p + 2;
+            return true;
+        }
+        void rewind();
+        /**
+         * When the event last returned by next() is due if replay started at start and runs at speed
+         * times the recorded rate
+         */
+        [[nodiscard]] Time due(Time start, double speed) const
+        {
+            return start.add_ns((int64_t)((double)m_elapsed_ms * 1000000.0 / speed));
+        }
+
+        ///
+        /// Feeds the whole recording to state, calling on_event (if given) after each event.
+        ///
+        /// speed is a multiple of the recorded timing: 1.0 reproduces the original gaps between events,
+        /// 10.0 plays ten times faster, and 0 (or less) plays as fast as possible. Timing is against
+        /// absolute deadlines from the start of replay, so oversleeping one event does not delay the
+        /// rest. Returns the number of events applied.
+        ///
+        template <HasApplyEvent ContState>
+        uint64_t replay(ContState& state, double speed, std::function<void(ContState&)> on_event = nullptr)
+        {
+            rewind();
+            Time start = Time::now();
+            uint64_t count = 0;
+            js_event event;
+            while (next(event)) {
+                if (speed > 0.0) {
+                    timespec ts = due(start, speed).as_timespec();
+                    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+                    }
+                }
+                state.apply_event(event);
+                if (on_event) {
+                    on_event(state);
+                }
+                count++;
+            }
+            return count;
+        }
+    };
+
+} //namespace
+
+#endif
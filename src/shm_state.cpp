@@ -0,0 +1,103 @@
+#include "shm_state.h"
+#include <cerrno>
+#include <new>
+#include <climits>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "f710_exceptions.h"
+
+namespace {
+    /// the segment is shared between processes, so these are the non-private futex operations
+    long futex(std::atomic<uint32_t>* word, int op, uint32_t value, const timespec* timeout)
+    {
+        return syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), op, value, timeout, nullptr, 0);
+    }
+}
+
+f710::ShmStatePublisher::ShmStatePublisher(const std::string& name)
+    : m_name(name), m_segment(nullptr)
+{
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        throw F710SharedMemoryError();
+    }
+    if (ftruncate(fd, sizeof(SharedStateSegment)) != 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        throw F710SharedMemoryError();
+    }
+    void* p = mmap(nullptr, sizeof(SharedStateSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        throw F710SharedMemoryError();
+    }
+    // a segment left behind by a publisher that crashed is simply taken over
+    m_segment = new (p) SharedStateSegment{};
+    memcpy(m_segment->magic, SharedStateSegment::MAGIC, sizeof(m_segment->magic));
+    m_segment->version = SharedStateSegment::VERSION;
+    m_segment->segment_size = sizeof(SharedStateSegment);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+f710::ShmStatePublisher::~ShmStatePublisher()
+{
+    munmap(m_segment, sizeof(SharedStateSegment));
+    shm_unlink(m_name.c_str());
+}
+void f710::ShmStatePublisher::wake_readers()
+{
+    futex(&m_segment->sequence, FUTEX_WAKE, INT_MAX, nullptr);
+}
+
+f710::ShmStateReader::ShmStateReader(const std::string& name)
+    : m_segment(nullptr), m_retry_count(0)
+{
+    // read-write because wait_for_update() registers itself in the waiters count
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        throw F710SharedMemoryError();
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(SharedStateSegment)) {
+        close(fd);
+        throw F710SharedMemoryError();
+    }
+    void* p = mmap(nullptr, sizeof(SharedStateSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        throw F710SharedMemoryError();
+    }
+    m_segment = static_cast<SharedStateSegment*>(p);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (memcmp(m_segment->magic, SharedStateSegment::MAGIC, sizeof(m_segment->magic)) != 0
+        || m_segment->version != SharedStateSegment::VERSION
+        || m_segment->segment_size != sizeof(SharedStateSegment)) {
+        munmap(p, sizeof(SharedStateSegment));
+        throw F710SharedMemoryError();
+    }
+}
+f710::ShmStateReader::~ShmStateReader()
+{
+    munmap(m_segment, sizeof(SharedStateSegment));
+}
+bool f710::ShmStateReader::wait_for_update(uint64_t last_publish_count, Time timeout)
+{
+    // every publish advances the sequence by 2, so after publish n it is 2n (mod 2^32)
+    auto seen = (uint32_t)(last_publish_count * 2);
+    m_segment->waiters.fetch_add(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint32_t current = m_segment->sequence.load(std::memory_order_acquire);
+    if (current == seen) {
+        timespec ts = timeout.as_timespec();
+        // returns at once with EAGAIN if a publish got in between the load and the wait
+        while (futex(&m_segment->sequence, FUTEX_WAIT, seen, &ts) != 0 && errno == EINTR) {
+        }
+        current = m_segment->sequence.load(std::memory_order_acquire);
+    }
+    m_segment->waiters.fetch_sub(1, std::memory_order_relaxed);
+    return current != seen;
+}
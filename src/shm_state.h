@@ -0,0 +1,170 @@
+#ifndef H_f710_shm_state_H
+#define H_f710_shm_state_H
+#include <atomic>
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include "f710_time.h"
+#include "full_controller_state.h"
+
+namespace f710 {
+
+    ///
+    /// What a publisher shares: the whole controller state, when it was published and how many
+    /// publishes there have been. snapshot.dirty says what changed since the previous publish.
+    ///
+    struct SharedControllerState {
+        uint64_t publish_count;
+        /// CLOCK_MONOTONIC, which every process on the machine shares, so a reader can compute the age
+        int64_t publish_time_ns;
+        ControllerSnapshot snapshot;
+    };
+    static_assert(std::is_trivially_copyable_v<SharedControllerState>);
+    static_assert(sizeof(SharedControllerState) % sizeof(uint64_t) == 0);
+
+    ///
+    /// The layout of the POSIX shared memory segment. The payload is stored as relaxed atomic words so
+    /// that a reader copying it while the writer is part way through is a race the seqlock detects
+    /// rather than undefined behaviour.
+    ///
+    /// sequence is the seqlock counter: odd while a publish is in progress, advanced by 2 per publish.
+    /// It is also the futex word blocking readers sleep on.
+    ///
+    struct SharedStateSegment {
+        static constexpr char MAGIC[8] = {'F', '7', '1', '0', 'S', 'H', 'M', '\0'};
+        static constexpr uint32_t VERSION = 1;
+        static constexpr size_t PAYLOAD_WORDS = sizeof(SharedControllerState) / sizeof(uint64_t);
+
+        char magic[8];
+        uint32_t version;
+        uint32_t segment_size;
+        alignas(64) std::atomic<uint32_t> sequence;
+        std::atomic<uint32_t> waiters;
+        alignas(64) std::atomic<uint64_t> payload[PAYLOAD_WORDS];
+    };
+    static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+                  "shared memory atomics must be lock free to work across processes");
+
+    ///
+    /// The one writer of a shared state segment. Creates the segment (named like "/f710_state", it
+    /// appears in /dev/shm) and removes the name again when destroyed; readers that have it mapped keep
+    /// their mapping.
+    ///
+    /// publish() never blocks and makes a syscall only when a reader is asleep in wait_for_update().
+    ///
+    class ShmStatePublisher {
+        std::string m_name;
+        SharedStateSegment* m_segment;
+    public:
+        explicit ShmStatePublisher(const std::string& name);
+        ~ShmStatePublisher();
+        ShmStatePublisher(const ShmStatePublisher&) = delete;
+        ShmStatePublisher& operator=(const ShmStatePublisher&) = delete;
+
+        void publish(const ControllerSnapshot& snapshot, Time now)
+        {
+            SharedControllerState state{};
+            // the count lives only in the segment, so sequence == 2 * publish_count holds whoever publishes
+            state.publish_count = publish_count() + 1;
+            state.publish_time_ns = now.nanosecs;
+            state.snapshot = snapshot;
+            uint64_t words[SharedStateSegment::PAYLOAD_WORDS];
+            memcpy(words, &state, sizeof(words));
+
+            uint32_t seq = m_segment->sequence.load(std::memory_order_relaxed);
+            m_segment->sequence.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for (size_t i = 0; i < SharedStateSegment::PAYLOAD_WORDS; i++) {
+                m_segment->payload[i].store(words[i], std::memory_order_relaxed);
+            }
+            m_segment->sequence.store(seq + 2, std::memory_order_release);
+            // pairs with the fence in wait_for_update: either the reader sees the new sequence or we see it waiting
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_segment->waiters.load(std::memory_order_relaxed) != 0) {
+                wake_readers();
+            }
+        }
+        [[nodiscard]] uint64_t publish_count() const
+        {
+            static_assert(offsetof(SharedControllerState, publish_count) == 0);
+            return m_segment->payload[0].load(std::memory_order_relaxed);
+        }
+    private:
+        void wake_readers();
+    };
+
+    ///
+    /// A reader of a shared state segment, any number of them in any number of processes. read() is a
+    /// copy of the segment between two loads of the sequence - no syscalls, no locks, and a writer can
+    /// never be held up by a reader.
+    ///
+    class ShmStateReader {
+        SharedStateSegment* m_segment;
+        uint64_t m_retry_count;
+    public:
+        /**
+         * Maps an existing segment; throws F710SharedMemoryError if there is none or it is not ours
+         */
+        explicit ShmStateReader(const std::string& name);
+        ~ShmStateReader();
+        ShmStateReader(const ShmStateReader&) = delete;
+        ShmStateReader& operator=(const ShmStateReader&) = delete;
+
+        /**
+         * One attempt at a consistent copy; false if a publish was in progress or overlapped the copy
+         */
+        bool try_read(SharedControllerState& out)
+        {
+            uint32_t before = m_segment->sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                return false;
+            }
+            uint64_t words[SharedStateSegment::PAYLOAD_WORDS];
+            for (size_t i = 0; i < SharedStateSegment::PAYLOAD_WORDS; i++) {
+                words[i] = m_segment->payload[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (m_segment->sequence.load(std::memory_order_relaxed) != before) {
+                return false;
+            }
+            memcpy(&out, words, sizeof(words));
+            return true;
+        }
+        /**
+         * A consistent copy, retrying while a publish is in progress. publish_count is 0 until the
+         * first publish.
+         */
+        SharedControllerState read()
+        {
+            SharedControllerState state;
+            while (!try_read(state)) {
+                m_retry_count++;
+                cpu_relax();
+            }
+            return state;
+        }
+        /**
+         * Sleeps until there has been a publish after the one numbered last_publish_count, or timeout
+         * has passed. True if there is something newer to read().
+         */
+        bool wait_for_update(uint64_t last_publish_count, Time timeout);
+        /**
+         * How many times read() found a publish in progress and had to try again
+         */
+        [[nodiscard]] uint64_t retry_count() const { return m_retry_count; }
+    private:
+        static void cpu_relax()
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#elif defined(__aarch64__)
+            asm volatile("yield");
+#endif
+        }
+    };
+
+} //namespace
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef H_f710_spsc_queue_H
+#define H_f710_spsc_queue_H
+#include <atomic>
+#include <cinttypes>
+#include <cstddef>
+
+namespace f710 {
+
+    constexpr size_t CACHE_LINE_SIZE = 64;
+
+    ///
+    /// A bounded, wait-free, single-producer/single-consumer ring buffer.
+    ///
+    /// -   try_push() may only be called from one thread and try_pop() from one (other) thread
+    /// -   both complete in a bounded number of steps - no locks, no retries, no syscalls
+    /// -   the producer's and the consumer's indices live on separate cache lines, each side keeps a
+    ///     private cached copy of the other side's index so the shared line is only touched when the
+    ///     cached copy says the queue looks full (producer) or empty (consumer)
+    /// -   a push into a full queue drops the item and counts it in overflow_count()
+    ///
+    /// Capacity must be a power of 2.
+    ///
+    template <typename T, size_t Capacity>
+    class SpscQueue {
+        static_assert((Capacity > 1) && ((Capacity & (Capacity - 1)) == 0), "Capacity must be a power of 2");
+        static constexpr size_t MASK = Capacity - 1;
+
+        // consumer owned
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_head;
+        size_t m_cached_tail;
+        // producer owned
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_tail;
+        size_t m_cached_head;
+        std::atomic<uint64_t> m_overflow_count;
+        std::atomic<uint64_t> m_push_count;
+
+        alignas(CACHE_LINE_SIZE) T m_slots[Capacity];
+    public:
+        SpscQueue() : m_head(0), m_cached_tail(0), m_tail(0), m_cached_head(0), m_overflow_count(0), m_push_count(0), m_slots() {}
+        SpscQueue(const SpscQueue&) = delete;
+        SpscQueue& operator=(const SpscQueue&) = delete;
+
+        /**
+         * Producer only. Returns false, and counts an overflow, if the queue is full.
+         */
+        bool try_push(const T& item)
+        {
+            const size_t tail = m_tail.load(std::memory_order_relaxed);
+            if (tail - m_cached_head == Capacity) {
+                m_cached_head = m_head.load(std::memory_order_acquire);
+                if (tail - m_cached_head == Capacity) {
+                    // only the producer writes the counters so a relaxed load/store pair is enough
+                    m_overflow_count.store(m_overflow_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                    return false;
+                }
+            }
+            m_slots[tail & MASK] = item;
+            m_tail.store(tail + 1, std::memory_order_release);
+            m_push_count.store(m_push_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return true;
+        }
+        /**
+         * Consumer only. Returns false if the queue is empty.
+         */
+        bool try_pop(T& item)
+        {
+            const size_t head = m_head.load(std::memory_order_relaxed);
+            if (head == m_cached_tail) {
+                m_cached_tail = m_tail.load(std::memory_order_acquire);
+                if (head == m_cached_tail) {
+                    return false;
+                }
+            }
+            item = m_slots[head & MASK];
+            m_head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+        /**
+         * Safe from either thread; the answer may be stale by the time it is used.
+         */
+        [[nodiscard]] bool empty() const
+        {
+            return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+        }
+        [[nodiscard]] uint64_t overflow_count() const { return m_overflow_count.load(std::memory_order_relaxed); }
+        [[nodiscard]] uint64_t push_count() const { return m_push_count.load(std::memory_order_relaxed); }
+        static constexpr size_t capacity() { return Capacity; }
+    };
+
+} //namespace
+
+#endif
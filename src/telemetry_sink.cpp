@@ -0,0 +1,179 @@
+#include "telemetry_sink.h"
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <cstdarg>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+    ///
+    /// A descriptor for fd's file that this process alone uses, non-blocking where that matters; -1 on failure
+    ///
+    int open_private(int fd, bool& is_socket)
+    {
+        struct stat st{};
+        if (fstat(fd, &st) != 0) {
+            return -1;
+        }
+        is_socket = S_ISSOCK(st.st_mode);
+        if (is_socket || S_ISREG(st.st_mode)) {
+            return fcntl(fd, F_DUPFD_CLOEXEC, 0);
+        }
+        char path[32];
+        snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+        return open(path, O_WRONLY | O_NONBLOCK | O_CLOEXEC | O_NOCTTY);
+    }
+}
+
+f710::TelemetrySink::TelemetrySink(int fd, Mode mode)
+    : m_fd(-1), m_is_socket(false), m_mode(mode), m_failed(false), m_slots(), m_head(0), m_tail(0),
+    m_written(0), m_pending_drops(0), m_lines(0), m_dropped(0), m_bytes_written(0), m_writev_calls(0),
+    m_would_block(0)
+{
+    // a pipe whose reader has gone must come back as EPIPE, not kill the process with SIGPIPE
+    struct sigaction current{};
+    if ((sigaction(SIGPIPE, nullptr, &current) == 0) && (current.sa_handler == SIG_DFL)) {
+        signal(SIGPIPE, SIG_IGN);
+    }
+    m_fd = open_private(fd, m_is_socket);
+    if (m_fd == -1) {
+        // nothing to write to; lines are counted and dropped
+        m_failed = true;
+    }
+}
+f710::TelemetrySink::~TelemetrySink()
+{
+    if (m_fd != -1) {
+        // a last non-blocking attempt, saying what was lost since the last notice
+        if ((m_pending_drops > 0) && !m_failed && (claim_slot() != nullptr)) {
+            queue_drop_notice();
+        }
+        on_writable(Time::now());
+        close(m_fd);
+    }
+}
+f710::TelemetrySink::Slot* f710::TelemetrySink::claim_slot()
+{
+    if (m_head - m_tail >= (uint64_t)LINE_COUNT) {
+        return nullptr;
+    }
+    return &m_slots[m_head % LINE_COUNT];
+}
+void f710::TelemetrySink::queue_drop_notice()
+{
+    Slot* notice = claim_slot();
+    int n = snprintf(notice->text, LINE_SIZE, "[telemetry: %lu lines dropped]\n", m_pending_drops);
+    notice->size = (size_t)n;
+    m_head++;
+    m_pending_drops = 0;
+}
+bool f710::TelemetrySink::line(const char* format, ...)
+{
+    m_lines++;
+    if (m_failed) {
+        m_dropped++;
+        return false;
+    }
+    // a dropped-lines notice needs a slot of its own ahead of this line
+    if ((m_pending_drops > 0) && (m_head - m_tail <= (uint64_t)LINE_COUNT - 2)) {
+        queue_drop_notice();
+    }
+    Slot* slot = (m_pending_drops == 0) ? claim_slot() : nullptr;
+    if (slot == nullptr) {
+        m_dropped++;
+        m_pending_drops++;
+        return false;
+    }
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(slot->text, LINE_SIZE, format, args);
+    va_end(args);
+    if (n < 0) {
+        n = 0;
+    } else if ((size_t)n >= LINE_SIZE) {
+        // truncated: keep the line a line
+        n = (int)LINE_SIZE - 1;
+        slot->text[n - 1] = '\n';
+    }
+    slot->size = (size_t)n;
+    m_head++;
+    if (m_mode == Mode::WriteThrough) {
+        on_writable(Time::now());
+    }
+    return true;
+}
+void f710::TelemetrySink::on_writable(Time now)
+{
+    (void)now;
+    while (!m_failed && (m_head != m_tail)) {
+        iovec iov[LINE_COUNT];
+        int count = 0;
+        for (uint64_t i = m_tail; (i != m_head) && (count < LINE_COUNT) && (count < IOV_MAX); i++) {
+            Slot& slot = m_slots[i % LINE_COUNT];
+            size_t skip = (i == m_tail) ? m_written : 0;
+            iov[count].iov_base = slot.text + skip;
+            iov[count].iov_len = slot.size - skip;
+            count++;
+        }
+        ssize_t n = write_out(iov, count);
+        m_writev_calls++;
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                m_would_block++;
+                return;
+            }
+            // the consumer has gone; what is queued can never be delivered
+            m_failed = true;
+            m_dropped += m_head - m_tail;
+            m_tail = m_head;
+            m_written = 0;
+            return;
+        }
+        m_bytes_written += (uint64_t)n;
+        auto remaining = (size_t)n;
+        while ((remaining > 0) && (m_tail != m_head)) {
+            Slot& slot = m_slots[m_tail % LINE_COUNT];
+            size_t left = slot.size - m_written;
+            if (remaining < left) {
+                m_written += remaining;
+                remaining = 0;
+            } else {
+                remaining -= left;
+                m_written = 0;
+                m_tail++;
+            }
+        }
+    }
+}
+ssize_t f710::TelemetrySink::write_out(const iovec* iov, int count)
+{
+    if (!m_is_socket) {
+        return writev(m_fd, iov, count);
+    }
+    msghdr message{};
+    message.msg_iov = const_cast<iovec*>(iov);
+    message.msg_iovlen = (size_t)count;
+    return sendmsg(m_fd, &message, MSG_DONTWAIT | MSG_NOSIGNAL);
+}
+void f710::TelemetrySink::print(FILE* out) const
+{
+    fprintf(out, "telemetry lines %lu dropped %lu bytes %lu writev calls %lu would block %lu%s\n", m_lines,
+            m_dropped, m_bytes_written, m_writev_calls, m_would_block, m_failed ? " (output failed)" : "");
+}
+
+void f710::format_time_of_day(char* out, size_t size)
+{
+    timespec ts{};
+    clock_gettime(CLOCK_REALTIME, &ts);
+    struct tm tm{};
+    gmtime_r(&ts.tv_sec, &tm);
+    snprintf(out, size, "%02d:%02d:%02d.%03ld", tm.tm_hour, tm.tm_min, tm.tm_sec, ts.tv_nsec / 1000000);
+}
@@ -0,0 +1,100 @@
+#ifndef H_f710_telemetry_sink_H
+#define H_f710_telemetry_sink_H
+#include <cinttypes>
+#include <cstddef>
+#include <cstdio>
+#include <sys/uio.h>
+#include "f710_time.h"
+#include "output_sink.h"
+
+namespace f710 {
+
+    ///
+    /// Status lines (stdout by default) that can never block the control loop, as an OutputSink.
+    ///
+    /// line() formats with vsnprintf straight into one of LINE_COUNT preallocated slots; the reader
+    /// writes the queued slots with a single writev when the fd is writable. The sink never changes the
+    /// flags of the fd it is given, since O_NONBLOCK belongs to the open file and would reach every other
+    /// writer of the same terminal or pipe. It writes through a private descriptor instead: a pipe or
+    /// terminal is opened again through /proc/self/fd, non-blocking; a socket is dup'ed and written with
+    /// MSG_DONTWAIT; a regular file, which never reports EAGAIN, is dup'ed. If that fails the sink is off.
+    ///
+    /// When the consumer - a slow ssh session, a full pipe - falls LINE_COUNT lines behind, new lines
+    /// are dropped and counted, and the next line that fits (or, failing that, the destructor) writes
+    /// one saying how many were lost. A write error other than EAGAIN (the pipe's reader went away)
+    /// discards the queue and turns the sink off rather than disturbing the loop; to get EPIPE rather
+    /// than a fatal SIGPIPE the constructor ignores SIGPIPE if it still has its default action.
+    ///
+    /// In write-through mode line() also tries to write at once, for callers whose reader does not
+    /// support output sinks, or that call line() from another thread than the reader's. It is still
+    /// non-blocking; what the fd will not take waits for the next line.
+    ///
+    class TelemetrySink: public OutputSink {
+    public:
+        static constexpr int LINE_COUNT = 64;
+        static constexpr size_t LINE_SIZE = 192;
+        enum class Mode { LoopDriven, WriteThrough };
+    private:
+        struct Slot {
+            char text[LINE_SIZE];
+            size_t size;
+        };
+        /// the private descriptor, -1 if there is none
+        int m_fd;
+        bool m_is_socket;
+        Mode m_mode;
+        bool m_failed;
+        Slot m_slots[LINE_COUNT];
+        /// slots in use are m_tail .. m_head - 1, modulo LINE_COUNT; m_written bytes of the tail slot are out
+        uint64_t m_head;
+        uint64_t m_tail;
+        size_t m_written;
+        uint64_t m_pending_drops;
+        uint64_t m_lines;
+        uint64_t m_dropped;
+        uint64_t m_bytes_written;
+        uint64_t m_writev_calls;
+        uint64_t m_would_block;
+    public:
+        explicit TelemetrySink(int fd = 1, Mode mode = Mode::LoopDriven);
+        ~TelemetrySink() override;
+        TelemetrySink(const TelemetrySink&) = delete;
+        TelemetrySink& operator=(const TelemetrySink&) = delete;
+
+        /**
+         * printf into the next free slot, truncated to LINE_SIZE; the format should end with a newline.
+         * False if the line was dropped.
+         */
+        [[gnu::format(printf, 2, 3)]] bool line(const char* format, ...);
+        /**
+         * For a caller that only knows once the reader exists whether it will drive the sink
+         */
+        void set_mode(Mode mode) { m_mode = mode; }
+
+        [[nodiscard]] int fd() const override { return m_fd; }
+        [[nodiscard]] bool wants_write() const override { return !m_failed && (m_head != m_tail); }
+        void on_writable(Time now) override;
+
+        [[nodiscard]] uint64_t lines() const { return m_lines; }
+        [[nodiscard]] uint64_t dropped() const { return m_dropped; }
+        [[nodiscard]] uint64_t bytes_written() const { return m_bytes_written; }
+        [[nodiscard]] uint64_t writev_calls() const { return m_writev_calls; }
+        [[nodiscard]] uint64_t would_block() const { return m_would_block; }
+        [[nodiscard]] bool failed() const override { return m_failed; }
+        void print(FILE* out) const;
+    private:
+        Slot* claim_slot();
+        /// "[telemetry: N lines dropped]" into the next slot, which the caller has checked is free
+        void queue_drop_notice();
+        /// writev, or sendmsg with MSG_DONTWAIT for a socket
+        ssize_t write_out(const iovec* iov, int count);
+    };
+
+    /**
+     * "hh:mm:ss.mmm" of the UTC wall clock into out, which must hold 13 bytes; no allocation
+     */
+    void format_time_of_day(char* out, size_t size);
+
+} //namespace
+
+#endif
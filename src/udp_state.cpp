@@ -0,0 +1,263 @@
+#include "udp_state.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <endian.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/random.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <rbl/simple_exit_guard.h>
+#include "f710_exceptions.h"
+
+namespace {
+    template <typename T, typename U>
+    void put(uint8_t*& p, U host_value)
+    {
+        T v = (T)host_value;
+        if constexpr (sizeof(T) == 2) {
+            v = (T)htole16((uint16_t)v);
+        } else if constexpr (sizeof(T) == 4) {
+            v = (T)htole32((uint32_t)v);
+        } else if constexpr (sizeof(T) == 8) {
+            v = (T)htole64((uint64_t)v);
+        }
+        memcpy(p, &v, sizeof(T));
+        p += sizeof(T);
+    }
+    template <typename T>
+    T get(const uint8_t*& p)
+    {
+        T v;
+        memcpy(&v, p, sizeof(T));
+        p += sizeof(T);
+        if constexpr (sizeof(T) == 2) {
+            return (T)le16toh((uint16_t)v);
+        } else if constexpr (sizeof(T) == 4) {
+            return (T)le32toh((uint32_t)v);
+        } else if constexpr (sizeof(T) == 8) {
+            return (T)le64toh((uint64_t)v);
+        } else {
+            return v;
+        }
+    }
+}
+
+void f710::udp_wire::encode_frame(const DriveFrame& frame, uint8_t* out)
+{
+    uint8_t* p = out;
+    put<uint32_t>(p, frame.sequence);
+    put<int64_t>(p, frame.capture_time_ns);
+    put<int16_t>(p, frame.left_raw);
+    put<int16_t>(p, frame.right_raw);
+    put<int8_t>(p, frame.left_pwm);
+    put<int8_t>(p, frame.right_pwm);
+    put<uint8_t>(p, frame.flags);
+    put<uint8_t>(p, 0);
+}
+f710::DriveFrame f710::udp_wire::decode_frame(const uint8_t* in)
+{
+    const uint8_t* p = in;
+    DriveFrame frame{};
+    frame.sequence = get<uint32_t>(p);
+    frame.capture_time_ns = get<int64_t>(p);
+    frame.left_raw = get<int16_t>(p);
+    frame.right_raw = get<int16_t>(p);
+    frame.left_pwm = get<int8_t>(p);
+    frame.right_pwm = get<int8_t>(p);
+    frame.flags = get<uint8_t>(p);
+    return frame;
+}
+uint32_t f710::udp_wire::decode_session(const uint8_t* header)
+{
+    const uint8_t* p = header + 4;
+    return get<uint32_t>(p);
+}
+int64_t f710::wall_clock_ns()
+{
+    timespec ts{};
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+f710::UdpStatePublisher::UdpStatePublisher(const std::string& host, uint16_t port, int redundancy)
+    : m_fd(-1), m_redundancy(std::clamp(redundancy, 0, udp_wire::MAX_REDUNDANCY)), m_session(0), m_next_sequence(1),
+    m_packet(), m_frame_count(0), m_sent(0), m_send_failures(0)
+{
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = AI_NUMERICSERV;
+    addrinfo* addresses = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0) {
+        throw F710UdpError();
+    }
+    exit_guard::Guard guard([addresses]() {freeaddrinfo(addresses);});
+    for (addrinfo* a = addresses; a != nullptr; a = a->ai_next) {
+        int fd = socket(a->ai_family, a->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, a->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        if (connect(fd, a->ai_addr, a->ai_addrlen) == 0) {
+            m_fd = fd;
+            break;
+        }
+        close(fd);
+    }
+    if (m_fd < 0) {
+        throw F710UdpError();
+    }
+    m_packet[0] = udp_wire::MAGIC_0;
+    m_packet[1] = udp_wire::MAGIC_1;
+    m_packet[2] = udp_wire::VERSION;
+    if (getrandom(&m_session, sizeof(m_session), 0) != (ssize_t)sizeof(m_session)) {
+        m_session = (uint32_t)wall_clock_ns() ^ ((uint32_t)getpid() << 16);
+    }
+    uint8_t* p = m_packet + 4;
+    put<uint32_t>(p, m_session);
+}
+f710::UdpStatePublisher::~UdpStatePublisher()
+{
+    close(m_fd);
+}
+bool f710::UdpStatePublisher::publish(DriveFrame frame)
+{
+    frame.sequence = m_next_sequence++;
+    frame.capture_time_ns = wall_clock_ns();
+    // shift the previous frames one slot older, dropping the oldest once there are redundancy + 1
+    int keep = std::min(m_frame_count, m_redundancy);
+    uint8_t* frames = m_packet + udp_wire::HEADER_SIZE;
+    memmove(frames + udp_wire::FRAME_SIZE, frames, (size_t)keep * udp_wire::FRAME_SIZE);
+    udp_wire::encode_frame(frame, frames);
+    m_frame_count = keep + 1;
+    m_packet[3] = (uint8_t)m_frame_count;
+    size_t length = udp_wire::HEADER_SIZE + (size_t)m_frame_count * udp_wire::FRAME_SIZE;
+    if (send(m_fd, m_packet, length, MSG_DONTWAIT | MSG_NOSIGNAL) != (ssize_t)length) {
+        m_send_failures++;
+        return false;
+    }
+    m_sent++;
+    return true;
+}
+
+f710::UdpStateReceiver::UdpStateReceiver(uint16_t port, Time max_age)
+    : m_fd(-1), m_max_age_ns(max_age.nanosecs), m_have_sequence(false), m_session(0), m_last_sequence(0),
+    m_packets(0), m_bad_packets(0), m_delivered(0), m_recovered(0), m_duplicates(0), m_late(0), m_stale(0),
+    m_lost(0), m_restarts(0)
+{
+    // dual stack where IPv6 is available, so publishers can use either family
+    m_fd = socket(AF_INET6, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_fd >= 0) {
+        int off = 0;
+        setsockopt(m_fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+        sockaddr_in6 address{};
+        address.sin6_family = AF_INET6;
+        address.sin6_addr = in6addr_any;
+        address.sin6_port = htons(port);
+        if (bind(m_fd, (sockaddr*)&address, sizeof(address)) == 0) {
+            return;
+        }
+        close(m_fd);
+    }
+    m_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_fd < 0) {
+        throw F710UdpError();
+    }
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(m_fd, (sockaddr*)&address, sizeof(address)) != 0) {
+        close(m_fd);
+        throw F710UdpError();
+    }
+}
+f710::UdpStateReceiver::~UdpStateReceiver()
+{
+    close(m_fd);
+}
+uint16_t f710::UdpStateReceiver::port() const
+{
+    sockaddr_storage address{};
+    socklen_t length = sizeof(address);
+    if (getsockname(m_fd, (sockaddr*)&address, &length) != 0) {
+        return 0;
+    }
+    if (address.ss_family == AF_INET6) {
+        return ntohs(((sockaddr_in6*)&address)->sin6_port);
+    }
+    return ntohs(((sockaddr_in*)&address)->sin_port);
+}
+ssize_t f710::UdpStateReceiver::receive_datagram(uint8_t* buffer, size_t size)
+{
+    while (true) {
+        ssize_t n = recv(m_fd, buffer, size, MSG_DONTWAIT);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        return n;
+    }
+}
+int f710::UdpStateReceiver::check_datagram(const uint8_t* data, size_t length)
+{
+    if (length < udp_wire::HEADER_SIZE || data[0] != udp_wire::MAGIC_0 || data[1] != udp_wire::MAGIC_1
+        || data[2] != udp_wire::VERSION) {
+        return 0;
+    }
+    int count = data[3];
+    if (count < 1 || count > udp_wire::MAX_REDUNDANCY + 1
+        || length != udp_wire::HEADER_SIZE + (size_t)count * udp_wire::FRAME_SIZE) {
+        return 0;
+    }
+    return count;
+}
+void f710::UdpStateReceiver::follow_restart(uint32_t session, const DriveFrame& newest)
+{
+    if (!m_have_sequence) {
+        m_session = session;
+        return;
+    }
+    if ((session != m_session) || ((int32_t)(newest.sequence - m_last_sequence) < -udp_wire::RESTART_DISTANCE)) {
+        m_session = session;
+        m_have_sequence = false;
+        m_restarts++;
+    }
+}
+bool f710::UdpStateReceiver::accept(const DriveFrame& frame, int64_t now_ns, bool redundant_copy)
+{
+    if (m_have_sequence) {
+        // signed distance so the comparison survives the sequence wrapping
+        auto ahead = (int32_t)(frame.sequence - m_last_sequence);
+        if (ahead <= 0) {
+            if (redundant_copy) {
+                m_duplicates++;
+            } else {
+                m_late++;
+            }
+            return false;
+        }
+        m_lost += (uint64_t)(ahead - 1);
+    }
+    m_have_sequence = true;
+    m_last_sequence = frame.sequence;
+    int64_t age = now_ns - frame.capture_time_ns;
+    if (m_max_age_ns > 0 && age > m_max_age_ns) {
+        m_stale++;
+        return false;
+    }
+    m_age.record(age);
+    m_delivered++;
+    if (redundant_copy) {
+        m_recovered++;
+    }
+    return true;
+}
+void f710::UdpStateReceiver::print(FILE* out) const
+{
+    fprintf(out, "packets %lu bad %lu frames delivered %lu recovered %lu duplicates %lu late %lu stale %lu lost %lu "
+            "restarts %lu\n", m_packets, m_bad_packets, m_delivered, m_recovered, m_duplicates, m_late, m_stale,
+            m_lost, m_restarts);
+    m_age.print(out, "capture to delivery");
+}
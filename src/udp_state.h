@@ -0,0 +1,207 @@
+#ifndef H_f710_udp_state_H
+#define H_f710_udp_state_H
+#include <cinttypes>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <sys/types.h>
+#include "f710_time.h"
+#include "latency_histogram.h"
+
+namespace f710 {
+
+    ///
+    /// One drive command as sent to the robot base. sequence and capture_time_ns are filled in by
+    /// UdpStatePublisher::publish().
+    ///
+    /// capture_time_ns is CLOCK_REALTIME so a receiver on another machine can compare it with its own
+    /// clock; ages are only meaningful when the two clocks are synchronised (chrony, PTP) or on loopback.
+    ///
+    struct DriveFrame {
+        static constexpr uint8_t FLAG_HIGH_GEAR = 0x01;
+
+        uint32_t sequence;
+        int64_t capture_time_ns;
+        int16_t left_raw;
+        int16_t right_raw;
+        int8_t left_pwm;
+        int8_t right_pwm;
+        uint8_t flags;
+    };
+
+    ///
+    /// The datagram format, little endian whatever the host:
+    ///
+    ///     header   'F' '7' version frame_count, u32 session
+    ///     frames   frame_count x 20 bytes, newest first:
+    ///              u32 sequence, i64 capture_time_ns, i16 left_raw, i16 right_raw,
+    ///              i8 left_pwm, i8 right_pwm, u8 flags, u8 reserved
+    ///
+    /// frame_count is 1 plus the redundancy: every datagram repeats the previous K frames so a receiver
+    /// gets them back after up to K consecutive lost datagrams, with no retransmission.
+    ///
+    /// session is chosen at random by each publisher when it starts. Sequences restart at 1 with it, so
+    /// a receiver that sees a new session starts counting again instead of taking the new frames for
+    /// late ones.
+    ///
+    namespace udp_wire {
+        constexpr uint8_t MAGIC_0 = 'F';
+        constexpr uint8_t MAGIC_1 = '7';
+        constexpr uint8_t VERSION = 2;
+        constexpr size_t HEADER_SIZE = 8;
+        constexpr size_t FRAME_SIZE = 20;
+        constexpr int MAX_REDUNDANCY = 7;
+        constexpr size_t MAX_PACKET_SIZE = HEADER_SIZE + FRAME_SIZE * (MAX_REDUNDANCY + 1);
+        /// a datagram whose newest frame is this far behind the newest delivered is from a restarted
+        /// publisher, whatever its session - no network reorders by anything like this much
+        constexpr int32_t RESTART_DISTANCE = 1000;
+
+        void encode_frame(const DriveFrame& frame, uint8_t* out);
+        DriveFrame decode_frame(const uint8_t* in);
+        uint32_t decode_session(const uint8_t* header);
+    }
+
+    /// CLOCK_REALTIME in nanoseconds, the clock DriveFrame::capture_time_ns is stamped with
+    int64_t wall_clock_ns();
+
+    ///
+    /// Sends DriveFrames as UDP datagrams to one destination. The socket is non-blocking and publish()
+    /// never waits: a datagram the kernel will not take right now (or that is refused because nothing
+    /// is listening yet) is counted as a send failure and the next publish carries it as redundancy.
+    ///
+    class UdpStatePublisher {
+        int m_fd;
+        int m_redundancy;
+        uint32_t m_session;
+        uint32_t m_next_sequence;
+        /// the last m_redundancy + 1 frames, already encoded, newest at m_packet's first frame slot
+        uint8_t m_packet[udp_wire::MAX_PACKET_SIZE];
+        int m_frame_count;
+        uint64_t m_sent;
+        uint64_t m_send_failures;
+    public:
+        /**
+         * host is a name or a numeric IPv4/IPv6 address; throws F710UdpError if it can not be resolved
+         * or the socket can not be set up. redundancy is limited to udp_wire::MAX_REDUNDANCY.
+         */
+        UdpStatePublisher(const std::string& host, uint16_t port, int redundancy = 0);
+        ~UdpStatePublisher();
+        UdpStatePublisher(const UdpStatePublisher&) = delete;
+        UdpStatePublisher& operator=(const UdpStatePublisher&) = delete;
+        /**
+         * Stamps frame with the next sequence number and the current time, and sends it along with
+         * the previous frames. True if the kernel accepted the datagram.
+         */
+        bool publish(DriveFrame frame);
+        [[nodiscard]] uint32_t session() const { return m_session; }
+        [[nodiscard]] uint32_t next_sequence() const { return m_next_sequence; }
+        [[nodiscard]] uint64_t sent() const { return m_sent; }
+        [[nodiscard]] uint64_t send_failures() const { return m_send_failures; }
+    };
+
+    ///
+    /// Receives UdpStatePublisher datagrams and hands each frame to the caller exactly once, in sequence
+    /// order. A frame at or behind the newest one delivered is a duplicate (a redundant copy) or arrived
+    /// late and is dropped, so a reordered datagram can never move the robot backwards in time. A gap in
+    /// the sequence that no later datagram fills is counted as lost.
+    ///
+    /// A datagram from a new session, or one far behind the sequence (udp_wire::RESTART_DISTANCE), means
+    /// the publisher has restarted: the receiver counts a restart and follows the new sequence.
+    ///
+    /// With a max_age the frames whose capture time is older than that by the local clock are dropped
+    /// as stale as well (this needs synchronised clocks).
+    ///
+    class UdpStateReceiver {
+        int m_fd;
+        int64_t m_max_age_ns;
+        bool m_have_sequence;
+        uint32_t m_session;
+        uint32_t m_last_sequence;
+        uint64_t m_packets;
+        uint64_t m_bad_packets;
+        uint64_t m_delivered;
+        uint64_t m_recovered;
+        uint64_t m_duplicates;
+        uint64_t m_late;
+        uint64_t m_stale;
+        uint64_t m_lost;
+        uint64_t m_restarts;
+        LatencyHistogram m_age;
+    public:
+        /**
+         * Binds to port on all addresses (port 0 picks a free one, see port()); throws F710UdpError
+         */
+        explicit UdpStateReceiver(uint16_t port, Time max_age = Time::from_ms(0));
+        ~UdpStateReceiver();
+        UdpStateReceiver(const UdpStateReceiver&) = delete;
+        UdpStateReceiver& operator=(const UdpStateReceiver&) = delete;
+
+        /// non-blocking, for adding to the caller's select/epoll set
+        [[nodiscard]] int fd() const { return m_fd; }
+        [[nodiscard]] uint16_t port() const;
+        /**
+         * Reads every datagram waiting on the socket, calling on_frame(const DriveFrame&) for each new
+         * frame. Returns the number of frames delivered.
+         */
+        template <typename F>
+        int receive(F&& on_frame)
+        {
+            uint8_t buffer[udp_wire::MAX_PACKET_SIZE + 1];
+            int delivered = 0;
+            ssize_t n;
+            while ((n = receive_datagram(buffer, sizeof(buffer))) >= 0) {
+                delivered += handle_datagram(buffer, (size_t)n, wall_clock_ns(), on_frame);
+            }
+            return delivered;
+        }
+        /**
+         * Everything receive() does with one datagram, for callers that read the socket themselves
+         */
+        template <typename F>
+        int handle_datagram(const uint8_t* data, size_t length, int64_t now_ns, F&& on_frame)
+        {
+            m_packets++;
+            int count = check_datagram(data, length);
+            if (count == 0) {
+                m_bad_packets++;
+                return 0;
+            }
+            follow_restart(udp_wire::decode_session(data), udp_wire::decode_frame(data + udp_wire::HEADER_SIZE));
+            int delivered = 0;
+            // oldest first, so frames recovered from the redundancy are delivered in order
+            for (int i = count - 1; i >= 0; i--) {
+                DriveFrame frame = udp_wire::decode_frame(data + udp_wire::HEADER_SIZE + (size_t)i * udp_wire::FRAME_SIZE);
+                if (!accept(frame, now_ns, i != 0)) {
+                    continue;
+                }
+                on_frame(frame);
+                delivered++;
+            }
+            return delivered;
+        }
+        void print(FILE* out) const;
+
+        [[nodiscard]] uint64_t packets() const { return m_packets; }
+        [[nodiscard]] uint64_t delivered() const { return m_delivered; }
+        [[nodiscard]] uint64_t recovered() const { return m_recovered; }
+        [[nodiscard]] uint64_t duplicates() const { return m_duplicates; }
+        [[nodiscard]] uint64_t lost() const { return m_lost; }
+        [[nodiscard]] uint64_t late() const { return m_late; }
+        [[nodiscard]] uint64_t stale() const { return m_stale; }
+        [[nodiscard]] uint64_t restarts() const { return m_restarts; }
+        /// capture to delivery time of the delivered frames, in ns
+        [[nodiscard]] const LatencyHistogram& age() const { return m_age; }
+    private:
+        ssize_t receive_datagram(uint8_t* buffer, size_t size);
+        /// the number of frames in a well formed datagram, 0 otherwise
+        static int check_datagram(const uint8_t* data, size_t length);
+        /// starts following a new sequence if the datagram with this session and newest frame is from a
+        /// restarted publisher
+        void follow_restart(uint32_t session, const DriveFrame& newest);
+        /// the sequence and age checks and the counting for one frame; true if it is to be delivered
+        bool accept(const DriveFrame& frame, int64_t now_ns, bool redundant_copy);
+    };
+
+} //namespace
+
+#endif
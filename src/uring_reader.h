@@ -0,0 +1,161 @@
+#ifndef f710_uring_reader_H
+#define f710_uring_reader_H
+#include <string>
+#include <functional>
+#include <cerrno>
+#include <assert.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <linux/joystick.h>
+#include <rbl/simple_exit_guard.h>
+#include "f710_helpers.h"
+#include "f710_exceptions.h"
+#include "f710_time.h"
+#include "io_uring_ring.h"
+#include "model.h"
+#include "model_defines.h"
+#include "reader_concept.h"
+
+namespace f710 {
+
+    ///
+    /// A Reader built on io_uring.
+    ///
+    /// Two requests are kept in flight at all times:
+    ///
+    /// -   a read of up to CONST_READ_BATCH_EVENTS js_events from the joystick, re-queued as soon as
+    ///     its completion has been applied to the model
+    /// -   an IORING_OP_TIMEOUT with an absolute CLOCK_MONOTONIC deadline for the output tick, re-armed
+    ///     at previous deadline + interval so the kernel keeps the tick schedule
+    ///
+    /// Completions are drained from the shared ring without a syscall. The loop only enters the kernel
+    /// when the completion queue is empty (to block) or, without SQPOLL, to submit the re-queued
+    /// requests - which it does in the same io_uring_enter as the wait.
+    ///
+    template <HasApplyEvent ContState>
+        class Reader {
+            static constexpr uint64_t READ_TAG = 1;
+            static constexpr uint64_t TICK_TAG = 2;
+            bool m_is_open;
+            int m_output_interval_ms;
+            std::function<void(ContState& csref)> m_on_event_function;
+            std::string m_joy_dev_name;
+            ContState *m_controller_state;
+            js_event m_events[CONST_READ_BATCH_EVENTS];
+            Time m_next_tick;
+            __kernel_timespec m_deadline;
+        public:
+            Reader() = delete;
+            explicit Reader(
+                std::string device_path,
+                ContState* controller_state,
+                std::function<void(ContState& csref)> on_event_function,
+                int output_interval_ms = 500
+            )
+                        : m_is_open(false), m_output_interval_ms(output_interval_ms),
+                        m_on_event_function(on_event_function), m_joy_dev_name(device_path),
+                        m_controller_state(controller_state), m_events(), m_next_tick(), m_deadline()
+            {
+            }
+
+            void run()
+            {
+                int f710_fd = open_fd_non_blocking(m_joy_dev_name);
+                exit_guard::Guard guard([f710_fd]() {close(f710_fd);});
+                ///
+                /// io_uring hands EAGAIN straight back for an O_NONBLOCK fd instead of waiting
+                /// for readiness, so the read requests need a blocking fd
+                ///
+                fcntl(f710_fd, F_SETFL, fcntl(f710_fd, F_GETFL, 0) & ~O_NONBLOCK);
+                IoUring ring(8);
+                m_next_tick = Time::now();
+                queue_read(ring, f710_fd);
+                queue_tick(ring);
+                m_is_open = true;
+                while (true) {
+                    ///
+                    /// Completions already in the ring are taken without entering the kernel; it is only
+                    /// asked to wait when there are none. Under SQPOLL the submit then needs no syscall
+                    /// either, unless the submission thread has gone idle and must be woken.
+                    ///
+                    ring.submit_and_wait((ring.peek_cqe() == nullptr) ? 1 : 0);
+                    bool tick_due = false;
+                    io_uring_cqe* cqe;
+                    while ((cqe = ring.peek_cqe()) != nullptr) {
+                        uint64_t tag = cqe->user_data;
+                        int res = cqe->res;
+                        ring.cqe_seen();
+                        if (tag == READ_TAG) {
+                            if (res == -EINTR || res == -EAGAIN) {
+                                queue_read(ring, f710_fd);
+                                continue;
+                            }
+                            if (res <= 0) {
+                                throw F710ReadIOError();
+                            }
+                            assert(res % sizeof(js_event) == 0);
+                            size_t count = res / sizeof(js_event);
+                            for (size_t i = 0; i < count; i++) {
+                                m_controller_state->apply_event(m_events[i]);
+                            }
+                            queue_read(ring, f710_fd);
+                        } else if (tag == TICK_TAG) {
+                            if (res != -ETIME) {
+                                throw F710TimerError();
+                            }
+                            tick_due = true;
+                            queue_tick(ring);
+                        }
+                    }
+                    if (tick_due) {
+                        m_on_event_function(*m_controller_state);
+                    }
+                }
+            }
+
+            void operator()(){run();};
+
+        private:
+            void queue_read(IoUring& ring, int f710_fd)
+            {
+                io_uring_sqe* sqe = ring.get_sqe();
+                assert(sqe != nullptr);
+                sqe->opcode = IORING_OP_READ;
+                sqe->fd = f710_fd;
+                sqe->addr = (uint64_t)(uintptr_t)m_events;
+                sqe->len = sizeof(m_events);
+                sqe->off = (uint64_t)-1; // use and advance the file position, as read() would
+                sqe->user_data = READ_TAG;
+            }
+            ///
+            /// Advances the absolute deadline by one interval and queues a timeout for it. If the loop has
+            /// fallen more than a whole interval behind the missed ticks are skipped, not replayed.
+            ///
+            void queue_tick(IoUring& ring)
+            {
+                const int64_t interval_ns = Time::from_ms(m_output_interval_ms).nanosecs;
+                Time now = Time::now();
+                Time deadline = m_next_tick.add_ns(interval_ns);
+                if (!Time::is_after(deadline, now)) {
+                    deadline = deadline.add_ns((Time::diff(now, deadline).nanosecs / interval_ns + 1) * interval_ns);
+                }
+                m_next_tick = deadline;
+                timespec ts = deadline.as_timespec();
+                m_deadline.tv_sec = ts.tv_sec;
+                m_deadline.tv_nsec = ts.tv_nsec;
+                io_uring_sqe* sqe = ring.get_sqe();
+                assert(sqe != nullptr);
+                sqe->opcode = IORING_OP_TIMEOUT;
+                sqe->fd = -1;
+                sqe->addr = (uint64_t)(uintptr_t)&m_deadline;
+                sqe->len = 1;
+                sqe->off = 0; // complete on the deadline only, not after some number of other completions
+                sqe->timeout_flags = IORING_TIMEOUT_ABS;
+                sqe->user_data = TICK_TAG;
+            }
+        };
+} //namespace
+
+#endif
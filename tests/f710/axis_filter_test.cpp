@@ -0,0 +1,183 @@
+///
+/// AxisFilter (axis_filter.h) against a plain scalar implementation of the same fixed point arithmetic,
+/// one lane at a time. The outputs must be bit identical for:
+///
+/// -   random input on all 8 lanes, for each combination of the stages
+/// -   the int16 extremes: lanes pinned at INT16_MIN / INT16_MAX, and lanes swinging full scale between
+///     them every tick, which is the largest step the EMA and the slew limit ever see
+/// -   alpha at its edges, 0, 1 and 1024, and outside them, which the constructor clamps; slew limits of
+///     1 unit a tick and above UINT16_MAX
+///
+/// and a few properties hold on their own: alpha 1024 with no other stage passes the input through,
+/// alpha 0 holds the primed value, the median removes a single tick spike, and a slew limit of 1 moves
+/// the output exactly one unit a tick.
+///
+#include "check.h"
+#include "axis_filter.h"
+#include <algorithm>
+#include <climits>
+
+namespace {
+
+    constexpr int LANES = f710::AxisFilter::LANES;
+
+    ///
+    /// The same filter one lane at a time with plain ints, including the constructor's clamping
+    ///
+    class ScalarAxisFilter {
+        static constexpr int F = f710::AxisFilter::FRACTION_BITS;
+        bool m_median;
+        int32_t m_alpha;
+        int32_t m_max_slew;
+        int32_t m_h1[LANES]{}, m_h2[LANES]{}, m_ema[LANES]{}, m_out[LANES]{};
+        bool m_primed = false;
+    public:
+        explicit ScalarAxisFilter(const f710::AxisFilterConfig& config)
+            : m_median(config.median), m_alpha(std::max(0, std::min(1024, config.ema_alpha_q10))),
+            m_max_slew(std::min(config.max_slew_per_tick, (int)UINT16_MAX)) {}
+        void apply(const int16_t (&in)[LANES], int16_t (&out)[LANES])
+        {
+            for (int i = 0; i < LANES; i++) {
+                int32_t x = in[i];
+                if (!m_primed) {
+                    m_h1[i] = m_h2[i] = x;
+                    m_ema[i] = m_out[i] = x << F;
+                }
+                int32_t v = x;
+                if (m_median) {
+                    int32_t a = m_h1[i], b = m_h2[i];
+                    v = std::max(std::min(a, b), std::min(std::max(a, b), x));
+                    m_h2[i] = m_h1[i];
+                    m_h1[i] = x;
+                }
+                m_ema[i] += (m_alpha * ((v << F) - m_ema[i]) + (1 << 9)) >> 10;
+                if (m_max_slew > 0) {
+                    int32_t limit = m_max_slew << F;
+                    m_out[i] += std::max(std::min(m_ema[i] - m_out[i], limit), -limit);
+                } else {
+                    m_out[i] = m_ema[i];
+                }
+                out[i] = (int16_t)((m_out[i] + (1 << (F - 1))) >> F);
+            }
+            m_primed = true;
+        }
+    };
+
+    uint32_t xorshift(uint32_t& x)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        return x;
+    }
+
+    const f710::AxisFilterConfig CONFIGS[] = {
+        {true, 1024, 0},
+        {false, 1024, 0},
+        {false, 256, 0},
+        {true, 300, 2000},
+        {true, 1024, 500},
+        {false, 0, 0},
+        {true, 1, 0},
+        {false, 1, 1},
+        {true, -5, 0},
+        {false, 5000, 0},
+        {true, 700, 1},
+        {false, 1024, UINT16_MAX},
+        {true, 512, 100000},
+    };
+
+    /// input for tick t on lane i: lanes 0-1 pinned at the extremes, 2-3 swinging full scale every
+    /// tick, 4 a full scale square wave with a period of 64 ticks, 5-7 random
+    int16_t input(uint64_t t, int i, uint32_t& seed)
+    {
+        switch (i) {
+            case 0: return INT16_MIN;
+            case 1: return INT16_MAX;
+            case 2: return (t & 1) ? INT16_MAX : INT16_MIN;
+            case 3: return (t & 1) ? INT16_MIN : INT16_MAX;
+            case 4: return (t & 32) ? INT16_MAX : INT16_MIN;
+            default: return (int16_t)(xorshift(seed) >> 16);
+        }
+    }
+
+    uint64_t mismatches(const f710::AxisFilterConfig& config, uint64_t ticks)
+    {
+        f710::AxisFilter vector_filter{config};
+        ScalarAxisFilter scalar_filter{config};
+        uint32_t seed = 99;
+        uint64_t count = 0;
+        for (uint64_t t = 0; t < ticks; t++) {
+            int16_t in[LANES], a[LANES], b[LANES];
+            for (int i = 0; i < LANES; i++) {
+                in[i] = input(t, i, seed);
+            }
+            vector_filter.apply(in, a);
+            scalar_filter.apply(in, b);
+            for (int i = 0; i < LANES; i++) {
+                count += (a[i] != b[i]) ? 1 : 0;
+            }
+        }
+        return count;
+    }
+
+    void check_exact()
+    {
+        for (const auto& config: CONFIGS) {
+            CHECK(mismatches(config, 100000) == 0);
+        }
+    }
+
+    void check_properties()
+    {
+        const int16_t extremes[LANES] = {INT16_MIN, INT16_MAX, -1, 0, 1, INT16_MIN + 1, INT16_MAX - 1, 12345};
+        int16_t out[LANES];
+
+        f710::AxisFilter pass{{false, 1024, 0}};
+        pass.apply(extremes, out);
+        CHECK(std::equal(out, out + LANES, extremes));
+        const int16_t swapped[LANES] = {INT16_MAX, INT16_MIN, 1, 0, -1, INT16_MAX - 1, INT16_MIN + 1, -12345};
+        pass.apply(swapped, out);
+        CHECK(std::equal(out, out + LANES, swapped));
+
+        f710::AxisFilter hold{{false, 0, 0}};
+        hold.apply(extremes, out);
+        for (int t = 0; t < 100; t++) {
+            hold.apply(swapped, out);
+        }
+        CHECK(std::equal(out, out + LANES, extremes));
+
+        // one tick at the opposite extreme between steady values never reaches the output
+        f710::AxisFilter median{{true, 1024, 0}};
+        const int16_t low[LANES] = {INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN};
+        const int16_t high[LANES] = {INT16_MAX, INT16_MAX, INT16_MAX, INT16_MAX, INT16_MAX, INT16_MAX, INT16_MAX, INT16_MAX};
+        bool spike_seen = false;
+        for (int t = 0; t < 5; t++) {
+            median.apply((t == 2) ? high : low, out);
+            spike_seen = spike_seen || (out[0] != INT16_MIN) || (out[7] != INT16_MIN);
+        }
+        CHECK(!spike_seen);
+
+        // full scale in 65535 ticks of exactly 1 each
+        f710::AxisFilter slew{{false, 1024, 1}};
+        slew.apply(low, out);
+        int wrong_step = 0;
+        int16_t previous = out[0];
+        for (int t = 0; t < 65535; t++) {
+            slew.apply(high, out);
+            wrong_step += (out[0] - previous != 1) ? 1 : 0;
+            previous = out[0];
+        }
+        CHECK(wrong_step == 0);
+        CHECK(out[0] == INT16_MAX);
+        slew.apply(high, out);
+        CHECK(out[0] == INT16_MAX);
+    }
+}
+
+int main()
+{
+    check_exact();
+    check_properties();
+    return f710_test::check_result();
+}
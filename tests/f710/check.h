@@ -0,0 +1,27 @@
+#ifndef H_f710_tests_check_H
+#define H_f710_tests_check_H
+#include <cstdio>
+
+///
+/// The whole test framework: CHECK prints the failing condition and where it is, and a test's main
+/// returns check_result(), non-zero if any CHECK failed, for ctest.
+///
+namespace f710_test {
+    inline int g_failures = 0;
+    inline int check_result()
+    {
+        if (g_failures > 0) {
+            printf("%d checks failed\n", g_failures);
+        }
+        return (g_failures == 0) ? 0 : 1;
+    }
+}
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            ::f710_test::g_failures++; \
+        } \
+    } while (0)
+
+#endif
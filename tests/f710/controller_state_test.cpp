@@ -0,0 +1,140 @@
+///
+/// The three ways of modelling the controller agree: the hand written ControllerState (model.h),
+/// BasicControllerState (controller_state.h) with the same three devices and with every axis and button
+/// of the F710 in D mode, and the structure of arrays FullControllerState (full_controller_state.h).
+///
+/// The event stream is the one model_bench times: the D mode init burst, then a pseudo random mix of
+/// events on all 6 axes and 12 buttons. After every event the three device models must hold the same
+/// values, and at the end every axis and toggle of the two full models must match, as must the dirty
+/// bits FullControllerState reports against the devices BasicControllerState saw change.
+///
+#include "check.h"
+#include "controller_state.h"
+#include "full_controller_state.h"
+#include "model.h"
+#include "model_defines.h"
+#include <utility>
+#include <vector>
+
+namespace {
+
+    using LeftStick = f710::Axis<D_AXIS_LEFT_STICK_FWD_BKWD_NUMBER>;
+    using RightStick = f710::Axis<D_AXIS_RIGHT_STICK_FWD_BKWD_NUMBER>;
+    using GearToggle = f710::Toggle<D_BUTTON_A>;
+    using DriveState = f710::BasicControllerState<LeftStick, RightStick, GearToggle>;
+    using FullState = f710::BasicControllerState<
+        f710::Axis<0>, f710::Axis<1>, f710::Axis<2>, f710::Axis<3>, f710::Axis<4>, f710::Axis<5>,
+        f710::Toggle<0>, f710::Toggle<1>, f710::Toggle<2>, f710::Toggle<3>, f710::Toggle<4>, f710::Toggle<5>,
+        f710::Toggle<6>, f710::Toggle<7>, f710::Toggle<8>, f710::Toggle<9>, f710::Toggle<10>, f710::Toggle<11>>;
+    constexpr size_t AXES = 6;
+    constexpr size_t BUTTONS = 12;
+
+    std::vector<js_event> make_events(uint64_t count)
+    {
+        std::vector<js_event> events;
+        events.reserve(count + 18);
+        for (__u8 n = 0; n < 12; n++) {
+            events.push_back(js_event{0, 0, JS_EVENT_BUTTON | JS_EVENT_INIT, n});
+        }
+        for (__u8 n = 0; n < 6; n++) {
+            events.push_back(js_event{0, 0, JS_EVENT_AXIS | JS_EVENT_INIT, n});
+        }
+        bool pressed[12] = {};
+        uint32_t x = 12345;
+        for (uint64_t i = 0; i < count; i++) {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            auto time = (uint32_t)(i / 4);
+            if ((x & 0x7) == 0) {
+                auto n = (__u8)((x >> 3) % 12);
+                pressed[n] = !pressed[n];
+                events.push_back(js_event{time, (__s16)(pressed[n] ? 1 : 0), JS_EVENT_BUTTON, n});
+            } else {
+                events.push_back(js_event{time, (__s16)(x >> 16), JS_EVENT_AXIS, (__u8)((x >> 3) % 6)});
+            }
+        }
+        return events;
+    }
+
+    f710::ControllerState make_controller_state()
+    {
+        return f710::ControllerState{
+            f710::AxisDevice(D_AXIS_LEFT_STICK_FWD_BKWD_NUMBER),
+            f710::AxisDevice(D_AXIS_RIGHT_STICK_FWD_BKWD_NUMBER),
+            f710::ToggleButton(D_BUTTON_A)};
+    }
+
+    bool drive_models_agree(f710::ControllerState& legacy, DriveState& drive, f710::FullControllerState& soa)
+    {
+        const f710::ControllerSnapshot& s = soa.state();
+        return (legacy.m_left.latest_event_value == drive.get<LeftStick>().latest_event_value)
+            && (legacy.m_right.latest_event_value == drive.get<RightStick>().latest_event_value)
+            && (legacy.m_button.event_toggle_value == drive.get<GearToggle>().event_toggle_value)
+            && (legacy.m_left.latest_event_value == s.axis(D_AXIS_LEFT_STICK_FWD_BKWD_NUMBER))
+            && (legacy.m_right.latest_event_value == s.axis(D_AXIS_RIGHT_STICK_FWD_BKWD_NUMBER))
+            && (legacy.m_button.event_toggle_value == s.is_toggled(D_BUTTON_A));
+    }
+
+    /// number of axes and buttons on which the 18 device BasicControllerState and the arrays differ
+    template <size_t... A, size_t... B>
+    int full_models_differ(FullState& full, const f710::ControllerSnapshot& s, bool compare_dirty,
+                           std::index_sequence<A...>, std::index_sequence<B...>)
+    {
+        int differ = 0;
+        ((differ += ((full.get<A>().latest_event_value != s.axis((int)A))
+            || (full.get<A>().latest_event_time != s.axis_time[A])
+            || (compare_dirty && (full.get<A>().is_new_event != s.axis_changed((int)A)))) ? 1 : 0), ...);
+        ((differ += ((full.get<AXES + B>().event_toggle_value != s.is_toggled((int)B))
+            || (compare_dirty && (full.get<AXES + B>().is_new_event != s.button_changed((int)B)))) ? 1 : 0), ...);
+        return differ;
+    }
+
+    int full_models_differ(FullState& full, const f710::ControllerSnapshot& s, bool compare_dirty)
+    {
+        return full_models_differ(full, s, compare_dirty, std::make_index_sequence<AXES>{},
+                                  std::make_index_sequence<BUTTONS>{});
+    }
+
+    void check_agreement()
+    {
+        std::vector<js_event> events = make_events(200000);
+        auto legacy = make_controller_state();
+        DriveState drive;
+        FullState full;
+        f710::FullControllerState soa;
+        uint64_t disagreements = 0;
+        for (const auto& event: events) {
+            legacy.apply_event(event);
+            drive.apply_event(event);
+            full.apply_event(event);
+            soa.apply_event(event);
+            disagreements += drive_models_agree(legacy, drive, soa) ? 0 : 1;
+        }
+        CHECK(disagreements == 0);
+        CHECK(full_models_differ(full, soa.state(), false) == 0);
+        CHECK(full.axis_count == (int)AXES);
+        CHECK(full.button_count == (int)BUTTONS);
+        CHECK(soa.mode() == f710::ControllerMode::D);
+
+        // what changed over a short burst, after both sides were cleared
+        full.clear_changed();
+        soa.clear_changed();
+        CHECK(!full.has_changed() && !soa.has_changed());
+        for (size_t i = 18; i < 18 + 10; i++) {
+            full.apply_event(events[i]);
+            soa.apply_event(events[i]);
+        }
+        CHECK(full.has_changed() && soa.has_changed());
+        CHECK(full_models_differ(full, soa.state(), true) == 0);
+        f710::ControllerSnapshot snapshot = soa.snapshot();
+        CHECK(snapshot.dirty != 0);
+        CHECK(!soa.has_changed());
+    }
+}
+
+int main()
+{
+    check_agreement();
+    return f710_test::check_result();
+}
@@ -0,0 +1,92 @@
+///
+/// The epoll reader (epoll_reader.h) with a TelemetrySink on a pipe whose read end is closed part way
+/// through. epoll reports EPOLLERR on a pipe with no reader whatever events were asked for, so unless
+/// the reader takes the sink out of its epoll set the loop spins from then on. The reader thread's CPU
+/// time over the ticks after the close must stay a small part of the wall time, both when the sink
+/// is idle at the close and when it keeps writing, sees EPIPE and fails.
+///
+#include "check.h"
+#include "epoll_reader.h"
+#include "event_source.h"
+#include "telemetry_sink.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+    constexpr int TICK_INTERVAL_MS = 10;
+    constexpr int TICKS_BEFORE_CLOSE = 5;
+    constexpr int TICKS = 30;
+
+    struct NullState {
+        void apply_event(js_event) {}
+    };
+
+    int64_t thread_cpu_ns()
+    {
+        timespec ts{};
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    }
+
+    ///
+    /// Runs TICKS ticks, closing the pipe's read end after TICKS_BEFORE_CLOSE. Returns the reader's CPU
+    /// time as a fraction of the wall time from the first tick after the close to the last.
+    ///
+    double cpu_share_after_close(bool keep_writing, bool& sink_failed)
+    {
+        int events[2];
+        int telemetry[2];
+        CHECK(pipe2(events, O_CLOEXEC) == 0);
+        CHECK(pipe2(telemetry, O_CLOEXEC) == 0);
+        f710::TelemetrySink sink{telemetry[1]};
+        close(telemetry[1]);
+        NullState state;
+        int ticks = 0;
+        int64_t cpu_start = 0;
+        int64_t wall_start = 0;
+        int64_t cpu_end = 0;
+        int64_t wall_end = 0;
+        f710::Reader<NullState> reader{std::make_unique<f710::FdSource>(events[0]), &state,
+            [&](NullState&) {
+                ticks++;
+                if ((ticks < TICKS_BEFORE_CLOSE) || keep_writing) {
+                    sink.line("tick %d\n", ticks);
+                }
+                if (ticks == TICKS_BEFORE_CLOSE) {
+                    close(telemetry[0]);
+                } else if (ticks == TICKS_BEFORE_CLOSE + 1) {
+                    cpu_start = thread_cpu_ns();
+                    wall_start = f710::Time::now().nanosecs;
+                } else if (ticks == TICKS) {
+                    cpu_end = thread_cpu_ns();
+                    wall_end = f710::Time::now().nanosecs;
+                    throw f710::F710StopRequested();
+                }
+            }, TICK_INTERVAL_MS};
+        reader.add_output_sink(&sink);
+        try {
+            reader.run();
+        } catch (const f710::F710StopRequested&) {
+        }
+        close(events[1]);
+        sink_failed = sink.failed();
+        CHECK(ticks == TICKS);
+        CHECK(wall_end > wall_start);
+        return (double)(cpu_end - cpu_start) / (double)(wall_end - wall_start);
+    }
+}
+
+int main()
+{
+    bool failed = false;
+    // nothing queued when the reader goes: only EPOLLERR says so
+    double idle_share = cpu_share_after_close(false, failed);
+    CHECK(idle_share < 0.2);
+    CHECK(!failed);
+    // a line every tick: the first write after the close gets EPIPE and the sink fails
+    double writing_share = cpu_share_after_close(true, failed);
+    CHECK(writing_share < 0.2);
+    CHECK(failed);
+    return f710_test::check_result();
+}
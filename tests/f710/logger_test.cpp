@@ -0,0 +1,127 @@
+///
+/// The rbl logger (rbl/logger.h):
+///
+/// -   formatting: statements covering each argument kind and conversion are logged, and the background
+///     thread's output is compared line by line with what snprintf makes of the same format and
+///     arguments - negative 32 bit ints under %d, %u and %x, %ld, %f and %g, %c, %p, %%, * widths and
+///     precisions, and strings cut at STRING_BYTES per record
+/// -   rings: more threads than the pool has rings, one after another, each log without a drop
+///
+#define RBL_LOG_LEVEL 2
+#include <rbl/logger.h>
+#include "check.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    /// the message part of a line: everything after "hh:mm:ss.mmm LOG function[line] "
+    std::string message_of(const char* line)
+    {
+        const char* p = strchr(line, ']');
+        std::string s = (p != nullptr) ? std::string(p + 2) : std::string();
+        if (!s.empty() && s.back() == '\n') {
+            s.pop_back();
+        }
+        return s;
+    }
+
+    std::vector<std::string> read_messages(FILE* out)
+    {
+        std::vector<std::string> messages;
+        rewind(out);
+        char line[1024];
+        while (fgets(line, sizeof(line), out) != nullptr) {
+            messages.push_back(message_of(line));
+        }
+        return messages;
+    }
+
+    void check_formatting()
+    {
+        FILE* out = tmpfile();
+        CHECK(out != nullptr);
+        rbl::log::set_output(out);
+        std::vector<std::string> expected;
+        char buffer[256];
+#define LOG_AND_EXPECT(f_, ...) do { \
+            snprintf(buffer, sizeof(buffer), f_, ##__VA_ARGS__); \
+            expected.emplace_back(buffer); \
+            RBL_LOG_FMT(f_, ##__VA_ARGS__); \
+        } while (0)
+        int32_t negative = -123456;
+        int16_t value = -32767;
+        uint8_t type = 0x81;
+        LOG_AND_EXPECT("plain text, 100%% literal");
+        LOG_AND_EXPECT("%d %u %x %X %o", negative, negative, negative, negative, negative);
+        LOG_AND_EXPECT("%d %u %x", -1, -1, -1);
+        LOG_AND_EXPECT("%d %x %u %Xh", value, value, type, type);
+        LOG_AND_EXPECT("%ld %lu %lx", -7L, 18446744073709551615UL, -1L);
+        LOG_AND_EXPECT("%lld %llu", (long long)-1234567890123LL, 18446744073709551615ULL);
+        LOG_AND_EXPECT("%5d|%-5d|%05d|%+d|% d", 42, 42, 42, 42, 42);
+        LOG_AND_EXPECT("%f %.3f %10.2f %e %g %g", 3.14159, 3.14159, -2.5, 12345.678, 0.0001, 1e20);
+        LOG_AND_EXPECT("%g %f", (double)0.1f, -0.0);
+        LOG_AND_EXPECT("char %c%c and hex %#x", 'A', '-', 255);
+        LOG_AND_EXPECT("pointers %p %p", (void*)&negative, (void*)nullptr);
+        LOG_AND_EXPECT("%*d|%-*d|%*d|", 6, 42, 6, 42, -6, 42);
+        LOG_AND_EXPECT("%.*f|%.*f|%*.*f", 2, 3.14159, -1, 2.5, 9, 3, -1.0 / 3.0);
+        LOG_AND_EXPECT("%*.*s|%0*x", 8, 3, "abcdef", 8, 255u);
+        LOG_AND_EXPECT("device %s at %8s|%-6s|", "js0", "x", "left");
+#undef LOG_AND_EXPECT
+
+        // strings share STRING_BYTES per record, each copy ending in a nul: what does not fit is cut
+        const std::string long_string(60, 'a');
+        RBL_LOG_FMT("[%s]", long_string.c_str());
+        expected.push_back("[" + long_string.substr(0, rbl::log::STRING_BYTES - 1) + "]");
+        const std::string first(30, 'b');
+        const std::string second(30, 'c');
+        RBL_LOG_FMT("[%s][%s][%s]", first.c_str(), second.c_str(), "d");
+        expected.push_back("[" + first + "][" + second.substr(0, rbl::log::STRING_BYTES - first.size() - 2) + "][]");
+
+        rbl::log::flush();
+        rbl::log::set_output(stdout);
+        std::vector<std::string> messages = read_messages(out);
+        fclose(out);
+        CHECK(messages.size() == expected.size());
+        for (size_t i = 0; (i < messages.size()) && (i < expected.size()); i++) {
+            if (messages[i] != expected[i]) {
+                fprintf(stderr, "expected: %s\ngot:      %s\n", expected[i].c_str(), messages[i].c_str());
+            }
+            CHECK(messages[i] == expected[i]);
+        }
+    }
+
+    void check_rings()
+    {
+        FILE* out = tmpfile();
+        CHECK(out != nullptr);
+        rbl::log::set_output(out);
+        uint64_t dropped_before = rbl::log::dropped();
+        const int threads = 40;
+        for (int i = 0; i < threads; i++) {
+            std::thread t([i]() { RBL_LOG_FMT("thread %d", i); });
+            t.join();
+            // the ring is free for the next thread once its last record is printed
+            rbl::log::flush();
+        }
+        rbl::log::set_output(stdout);
+        std::vector<std::string> messages = read_messages(out);
+        fclose(out);
+        CHECK(rbl::log::dropped() == dropped_before);
+        CHECK(messages.size() == (size_t)threads);
+        for (size_t i = 0; i < messages.size(); i++) {
+            CHECK(messages[i] == "thread " + std::to_string(i));
+        }
+    }
+}
+
+int main()
+{
+    rbl::log::start();
+    check_formatting();
+    check_rings();
+    return f710_test::check_result();
+}
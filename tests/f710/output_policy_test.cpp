@@ -0,0 +1,113 @@
+///
+/// The change-driven output policy (output_policy.h):
+///
+/// -   ChangeDrivenGate on synthetic Times: a change is held back until the minimum interval is up, a
+///     heartbeat comes when nothing changes, nothing comes between heartbeats when nothing changes, and
+///     next_deadline()/timeout() point at the right one of the two
+/// -   the epoll reader driven by a generator: with a state that always reports a change the callback
+///     runs at most once per minimum interval; with one that never does, only on the heartbeat
+///
+#include "check.h"
+#include "output_policy.h"
+#include "generator_source.h"
+#include "epoll_reader.h"
+#include <vector>
+
+namespace {
+
+    constexpr int MIN_INTERVAL_MS = 20;
+    constexpr int HEARTBEAT_MS = 200;
+
+    f710::Time at_ms(int64_t ms) { return f710::Time::from_ms(1000000 + ms); }
+
+    void check_gate()
+    {
+        f710::OutputPolicy policy = f710::OutputPolicy::change_driven(MIN_INTERVAL_MS, HEARTBEAT_MS);
+        CHECK(policy.is_change_driven());
+        CHECK(!f710::OutputPolicy::fixed_interval(50).is_change_driven());
+        f710::ChangeDrivenGate gate{policy, at_ms(0)};
+
+        // min interval: a change waits until 20 ms after the previous output
+        CHECK(!gate.should_fire(at_ms(1), true));
+        CHECK(!gate.should_fire(at_ms(19), true));
+        CHECK(gate.next_deadline(true).nanosecs == at_ms(20).nanosecs);
+        CHECK(gate.timeout(at_ms(5), true).nanosecs == f710::Time::from_ms(15).nanosecs);
+        CHECK(gate.should_fire(at_ms(20), true));
+        gate.fired(at_ms(20));
+        CHECK(!gate.should_fire(at_ms(39), true));
+        CHECK(gate.should_fire(at_ms(40), true));
+        gate.fired(at_ms(40));
+
+        // no change: nothing until the heartbeat, 200 ms after the last output
+        int fired_early = 0;
+        for (int ms = 41; ms < 240; ms++) {
+            fired_early += gate.should_fire(at_ms(ms), false) ? 1 : 0;
+        }
+        CHECK(fired_early == 0);
+        CHECK(gate.next_deadline(false).nanosecs == at_ms(240).nanosecs);
+        CHECK(gate.should_fire(at_ms(240), false));
+        CHECK(gate.should_fire(at_ms(1000), false));
+        gate.fired(at_ms(240));
+        CHECK(gate.timeout(at_ms(500), false).nanosecs == 0);
+        CHECK(gate.timeout(at_ms(250), false).nanosecs == f710::Time::from_ms(190).nanosecs);
+
+        // a change long after the last output goes at once
+        CHECK(gate.should_fire(at_ms(300), true));
+    }
+
+    ///
+    /// A model whose change tracking the test sets
+    ///
+    struct TrackedState {
+        bool always_changed;
+        uint64_t events = 0;
+        void apply_event(js_event) { events++; }
+        [[nodiscard]] bool has_changed() const { return always_changed && (events > 0); }
+        void clear_changed() {}
+    };
+
+    std::vector<int64_t> run_reader(bool always_changed, int seconds)
+    {
+        f710::GeneratorConfig config;
+        config.events_per_sec = 500;
+        config.event_count = (uint64_t)seconds * 500;
+        TrackedState state{always_changed};
+        std::vector<int64_t> calls;
+        f710::Reader<TrackedState> reader{std::make_unique<f710::GeneratorSource>(config), &state,
+            [&calls](TrackedState&) { calls.push_back(f710::Time::now().nanosecs); }, 5};
+        reader.set_output_policy(f710::OutputPolicy::change_driven(MIN_INTERVAL_MS, HEARTBEAT_MS));
+        try {
+            reader.run();
+        } catch (const f710::F710EndOfStream&) {
+        }
+        return calls;
+    }
+
+    void check_epoll_reader()
+    {
+        // changing all the time: paced by the minimum interval, about 50 calls a second
+        std::vector<int64_t> calls = run_reader(true, 1);
+        int too_close = 0;
+        for (size_t i = 1; i < calls.size(); i++) {
+            too_close += (calls[i] - calls[i - 1] < (MIN_INTERVAL_MS * 1000000LL) - 100000) ? 1 : 0;
+        }
+        CHECK(too_close == 0);
+        CHECK(calls.size() >= 30 && calls.size() <= 51);
+
+        // never changing: heartbeats only, 5 in a second, where the fixed 5 ms interval would make 200
+        calls = run_reader(false, 1);
+        int off_beat = 0;
+        for (size_t i = 1; i < calls.size(); i++) {
+            off_beat += (calls[i] - calls[i - 1] < (HEARTBEAT_MS * 1000000LL) - 100000) ? 1 : 0;
+        }
+        CHECK(off_beat == 0);
+        CHECK(calls.size() >= 3 && calls.size() <= 6);
+    }
+}
+
+int main()
+{
+    check_gate();
+    check_epoll_reader();
+    return f710_test::check_result();
+}
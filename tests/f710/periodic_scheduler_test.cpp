@@ -0,0 +1,129 @@
+///
+/// PeriodicScheduler (periodic_scheduler.h) on synthetic Times, a 10 ms period started at 0:
+///
+/// -   on time: each tick moves the deadline on by exactly one period, with no overruns
+/// -   Skip: a callback that ends at 55 ms drops the deadlines at 30, 40 and 50 and the next is 60
+/// -   CatchUp: the same overrun owes three ticks that run back to back; one that ends at 220 ms owes
+///     sixteen, of which only MAX_CATCH_UP_TICKS run and the rest are counted missed
+/// -   Stretch: the next deadline is one period after the late callback ended, and nothing is missed
+///
+#include "check.h"
+#include "periodic_scheduler.h"
+
+namespace {
+
+    using Policy = f710::PeriodicScheduler::OverrunPolicy;
+
+    constexpr int64_t PERIOD_MS = 10;
+
+    f710::Time at_ms(int64_t ms) { return f710::Time::from_ms(1000000 + ms); }
+
+    bool deadline_is(const f710::PeriodicScheduler& scheduler, int64_t ms)
+    {
+        return scheduler.next_deadline().nanosecs == at_ms(ms).nanosecs;
+    }
+
+    void tick(f710::PeriodicScheduler& scheduler, int64_t begin_ms, int64_t end_ms)
+    {
+        scheduler.begin_tick(at_ms(begin_ms));
+        scheduler.end_tick(at_ms(end_ms));
+    }
+
+    /// runs every tick due at now with a callback that takes no time, returns how many ran
+    uint64_t ticks_owed(f710::PeriodicScheduler& scheduler, int64_t now_ms)
+    {
+        uint64_t count = 0;
+        while (scheduler.is_due(at_ms(now_ms)) && (count < 1000)) {
+            tick(scheduler, now_ms, now_ms);
+            count++;
+        }
+        return count;
+    }
+
+    /// checks ticks that keep to the schedule, then leaves the scheduler with its second tick due at 20 ms
+    void start_on_time(f710::PeriodicScheduler& scheduler)
+    {
+        scheduler.start(at_ms(0), PERIOD_MS);
+        CHECK(deadline_is(scheduler, 10));
+        CHECK(!scheduler.is_due(at_ms(9)));
+        CHECK(scheduler.timeout(at_ms(4)).nanosecs == f710::Time::from_ms(6).nanosecs);
+        CHECK(scheduler.is_due(at_ms(10)));
+        tick(scheduler, 10, 11);
+        CHECK(deadline_is(scheduler, 20));
+        // a callback that is late to start but ends before the next deadline is not an overrun
+        tick(scheduler, 27, 29);
+        CHECK(deadline_is(scheduler, 30));
+        CHECK(scheduler.overrun_count() == 0);
+        CHECK(scheduler.lateness().max() >= 7000000);
+        // back to the 20 ms tick for the scenarios below
+        scheduler.start(at_ms(0), PERIOD_MS);
+        tick(scheduler, 10, 10);
+        CHECK(scheduler.is_due(at_ms(20)));
+    }
+
+    void check_skip()
+    {
+        f710::PeriodicScheduler scheduler{PERIOD_MS, Policy::Skip};
+        start_on_time(scheduler);
+        tick(scheduler, 20, 55);
+        CHECK(deadline_is(scheduler, 60));
+        CHECK(scheduler.overrun_count() == 1);
+        CHECK(scheduler.missed_count() == 3);
+        CHECK(ticks_owed(scheduler, 59) == 0);
+        CHECK(ticks_owed(scheduler, 60) == 1);
+        CHECK(deadline_is(scheduler, 70));
+
+        // ending exactly on the next deadline is an overrun that misses that one deadline
+        tick(scheduler, 70, 80);
+        CHECK(deadline_is(scheduler, 90));
+        CHECK(scheduler.overrun_count() == 2);
+        CHECK(scheduler.missed_count() == 4);
+        CHECK(scheduler.tick_count() == 4);
+    }
+
+    void check_catch_up()
+    {
+        f710::PeriodicScheduler scheduler{PERIOD_MS, Policy::CatchUp};
+        start_on_time(scheduler);
+        tick(scheduler, 20, 55);
+        // the missed deadlines stay owed: 30, 40 and 50 run at once, then 60 is in the future again
+        CHECK(deadline_is(scheduler, 30));
+        CHECK(scheduler.missed_count() == 0);
+        CHECK(ticks_owed(scheduler, 55) == 3);
+        CHECK(deadline_is(scheduler, 60));
+        CHECK(scheduler.missed_count() == 0);
+
+        // 16 deadlines from 70 to 220 are missed: the first 11 are dropped, the last 5 run back to back
+        tick(scheduler, 60, 220);
+        CHECK(scheduler.missed_count() == 16 - f710::PeriodicScheduler::MAX_CATCH_UP_TICKS);
+        CHECK(deadline_is(scheduler, 180));
+        CHECK(ticks_owed(scheduler, 220) == f710::PeriodicScheduler::MAX_CATCH_UP_TICKS);
+        CHECK(deadline_is(scheduler, 230));
+        CHECK(scheduler.missed_count() == 16 - f710::PeriodicScheduler::MAX_CATCH_UP_TICKS);
+    }
+
+    void check_stretch()
+    {
+        f710::PeriodicScheduler scheduler{PERIOD_MS, Policy::Stretch};
+        start_on_time(scheduler);
+        tick(scheduler, 20, 55);
+        CHECK(deadline_is(scheduler, 65));
+        CHECK(scheduler.overrun_count() == 1);
+        CHECK(ticks_owed(scheduler, 64) == 0);
+        CHECK(ticks_owed(scheduler, 65) == 1);
+        // the new phase holds once callbacks are short again
+        CHECK(deadline_is(scheduler, 75));
+        tick(scheduler, 75, 76);
+        CHECK(deadline_is(scheduler, 85));
+        CHECK(scheduler.missed_count() == 0);
+        CHECK(scheduler.overrun_count() == 1);
+    }
+}
+
+int main()
+{
+    check_skip();
+    check_catch_up();
+    check_stretch();
+    return f710_test::check_result();
+}
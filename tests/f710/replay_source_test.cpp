@@ -0,0 +1,79 @@
+///
+/// ReplaySource (replay_source.h) through the select Reader: every event of a recorded session must
+/// reach the state exactly once and in order, and the Reader must end with F710EndOfStream.
+///
+#include "check.h"
+#include "reader.h"
+#include "replay_source.h"
+#include "session_recorder.h"
+#include "session_replay.h"
+#include <cstdlib>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+    struct EventLog {
+        std::vector<js_event> events;
+        void apply_event(js_event event) { events.push_back(event); }
+    };
+
+    bool same_events(const std::vector<js_event>& a, const std::vector<js_event>& b)
+    {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); i++) {
+            if ((a[i].time != b[i].time) || (a[i].value != b[i].value) || (a[i].type != b[i].type)
+                || (a[i].number != b[i].number)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void record_session(const char* path, int count)
+    {
+        f710::SessionRecorder recorder{path, "recorded"};
+        uint32_t t = 1000;
+        for (uint8_t n = 0; n < 12; n++) {
+            recorder.record(js_event{t, 0, JS_EVENT_BUTTON | JS_EVENT_INIT, n});
+        }
+        for (uint8_t n = 0; n < 6; n++) {
+            recorder.record(js_event{t, 0, JS_EVENT_AXIS | JS_EVENT_INIT, n});
+        }
+        for (int i = 0; i < count; i++) {
+            t += (uint32_t)(i % 3);
+            recorder.record(js_event{t, (int16_t)(i * 37 - 20000), JS_EVENT_AXIS, (uint8_t)(i % 6)});
+        }
+    }
+}
+
+int main()
+{
+    char path[] = "/tmp/f710_replay_source_test_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd != -1);
+    close(fd);
+    record_session(path, 5000);
+
+    EventLog expected;
+    f710::SessionReplay session{path};
+    session.replay(expected, 0.0);
+    CHECK(expected.events.size() == 5018);
+
+    EventLog replayed;
+    auto source = std::make_unique<f710::ReplaySource>(path, 0.0);
+    CHECK(source->name() == "recorded");
+    f710::Reader<EventLog> reader{std::move(source), &replayed, [](EventLog&) {}, 10};
+    bool ended = false;
+    try {
+        reader.run();
+    } catch (const f710::F710EndOfStream&) {
+        ended = true;
+    }
+    CHECK(ended);
+    CHECK(same_events(replayed.events, expected.events));
+    unlink(path);
+    return f710_test::check_result();
+}
@@ -0,0 +1,125 @@
+///
+/// ResponseTable (response_curve.h) for every possible int16 axis value:
+///
+/// -   with deadzone and expo 0 the tables equal the scale() function they replaced in main.cpp, in
+///     both gears and both signs, and a table built at run time equals the compiler's
+/// -   the gear tables main drives the robot with (LOW_GEAR_CURVE, HIGH_GEAR_CURVE) equal a plain
+///     reference of the inverted, deadzoned band, and have the shape a driver relies on: a stop inside
+///     the deadzone, the band's minimum just outside it, its maximum at full travel, the sign of the
+///     inverted stick, symmetry, and never a smaller command for more travel
+///
+#include "check.h"
+#include "response_curve.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+
+namespace {
+
+    ///
+    /// scale() exactly as it was in main.cpp
+    ///
+    float scale(bool high_gear, int value) {
+        if (value == 0) {
+            return 0.0;
+        }
+        auto multiplier = (value < 0) ? -1: 1;
+        value = value * multiplier;
+        float pwm;
+        if (high_gear) {
+            pwm = multiplier * (round(((float) value / (float) INT16_MAX) * (85.0 - 50.0)) + 50.0);
+        } else {
+            pwm = multiplier * (round(((float) value / (float) INT16_MAX) * (60.0 - 30.0)) + 30.0);
+        }
+        return pwm;
+    }
+
+    ///
+    /// The gear mapping spelled out with the C library: negate, stop within the deadzone, scale the
+    /// rest of the travel linearly into the band
+    ///
+    int gear_reference(int pwm_min, int pwm_max, int deadzone, int raw)
+    {
+        int value = -raw;
+        int magnitude = std::abs(value);
+        if (magnitude <= deadzone) {
+            return 0;
+        }
+        float x = (float)(magnitude - deadzone) / (float)(INT16_MAX - deadzone);
+        int pwm = (int)std::round((double)x * (pwm_max - pwm_min)) + pwm_min;
+        pwm = std::min(pwm, pwm_max);
+        return (value < 0) ? -pwm : pwm;
+    }
+
+    constexpr f710::ResponseCurve LOW = f710::ResponseCurve::band(30, 60);
+    constexpr f710::ResponseCurve HIGH = f710::ResponseCurve::band(50, 85);
+    static constexpr f710::ResponseTable LOW_TABLE{LOW};
+    static constexpr f710::ResponseTable HIGH_TABLE{HIGH};
+    static constexpr f710::ResponseTable LOW_INVERTED_TABLE{LOW.inverted()};
+    static constexpr f710::ResponseTable LOW_GEAR{f710::LOW_GEAR_CURVE};
+    static constexpr f710::ResponseTable HIGH_GEAR{f710::HIGH_GEAR_CURVE};
+
+    void check_matches_scale()
+    {
+        int mismatches = 0;
+        for (int raw = INT16_MIN; raw <= INT16_MAX; raw++) {
+            auto v = (int16_t)raw;
+            mismatches += ((float)LOW_TABLE(v) != scale(false, raw)) ? 1 : 0;
+            mismatches += ((float)HIGH_TABLE(v) != scale(true, raw)) ? 1 : 0;
+            // main negated the raw value before scale(), the inverted table does it itself
+            mismatches += ((float)LOW_INVERTED_TABLE(v) != scale(false, -1 * raw)) ? 1 : 0;
+        }
+        CHECK(mismatches == 0);
+    }
+
+    void check_runtime_table()
+    {
+        auto runtime_table = std::make_unique<f710::ResponseTable>(f710::LOW_GEAR_CURVE);
+        int mismatches = 0;
+        for (int raw = INT16_MIN; raw <= INT16_MAX; raw++) {
+            mismatches += ((*runtime_table)((int16_t)raw) != LOW_GEAR((int16_t)raw)) ? 1 : 0;
+        }
+        CHECK(mismatches == 0);
+    }
+
+    void check_gear(const f710::ResponseTable& table, int pwm_min, int pwm_max)
+    {
+        const int dz = f710::AXIS_DEADZONE;
+        int mismatches = 0;
+        int asymmetric = 0;
+        int non_monotonic = 0;
+        int previous = 0;
+        for (int raw = INT16_MIN; raw <= INT16_MAX; raw++) {
+            int pwm = table((int16_t)raw);
+            mismatches += (pwm != gear_reference(pwm_min, pwm_max, dz, raw)) ? 1 : 0;
+            if (raw > INT16_MIN) {
+                asymmetric += (pwm != -table((int16_t)-raw)) ? 1 : 0;
+                // inverted: pushing forward (more negative raw) never asks for less forward drive
+                non_monotonic += (pwm > previous) ? 1 : 0;
+            }
+            previous = pwm;
+        }
+        CHECK(mismatches == 0);
+        CHECK(asymmetric == 0);
+        CHECK(non_monotonic == 0);
+
+        CHECK(table(0) == 0);
+        CHECK(table((int16_t)dz) == 0);
+        CHECK(table((int16_t)-dz) == 0);
+        CHECK(table((int16_t)-(dz + 1)) == pwm_min);
+        CHECK(table((int16_t)(dz + 1)) == -pwm_min);
+        CHECK(table((int16_t)-INT16_MAX) == pwm_max);
+        CHECK(table((int16_t)INT16_MAX) == -pwm_max);
+        CHECK(table((int16_t)INT16_MIN) == pwm_max);
+    }
+}
+
+int main()
+{
+    check_matches_scale();
+    check_runtime_table();
+    check_gear(LOW_GEAR, 30, 60);
+    check_gear(HIGH_GEAR, 50, 85);
+    return f710_test::check_result();
+}
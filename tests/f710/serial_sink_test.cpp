@@ -0,0 +1,152 @@
+///
+/// SerialSink (serial_sink.h) end to end through a Reader against a pty pair: every 1 ms tick submits a
+/// numbered command line, and the master side of the pty plays the motor controller. With a controller
+/// that keeps up every command arrives; with one that stalls until the run is over the pty fills and
+/// the sink supersedes commands. Either way every line that arrives is whole and in order, and every
+/// submitted command is either written or counted as superseded.
+///
+/// Built once per reader, like serial_bench: serial_sink_test_select and serial_sink_test_epoll.
+///
+#include "check.h"
+#include "serial_sink.h"
+#include "f710_time.h"
+#include "generator_source.h"
+#ifdef EPOLL_READER
+#include "epoll_reader.h"
+#else
+#include "reader.h"
+#endif
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+    constexpr int TICK_INTERVAL_MS = 1;
+    /// long enough that a second of commands is several times what a pty holds
+    constexpr size_t LINE_SIZE = 60;
+
+    struct CountingState {
+        void apply_event(js_event) {}
+    };
+
+    ///
+    /// Reads lines from the pty master, checking each is LINE_SIZE long, parses and follows the last
+    ///
+    struct Controller {
+        int fd;
+        char line[LINE_SIZE + 8]{};
+        size_t used = 0;
+        uint64_t lines = 0;
+        uint64_t bad_lines = 0;
+        uint64_t out_of_order = 0;
+        uint64_t last_sequence = 0;
+
+        /// reads whatever is there, waiting up to timeout_ms for the first byte; false if nothing came
+        bool read_some(int timeout_ms)
+        {
+            pollfd pfd{fd, POLLIN, 0};
+            if (poll(&pfd, 1, timeout_ms) <= 0) {
+                return false;
+            }
+            char buffer[4096];
+            ssize_t n = read(fd, buffer, sizeof(buffer));
+            for (ssize_t i = 0; i < n; i++) {
+                if (buffer[i] != '\n') {
+                    if (used < sizeof(line) - 1) {
+                        line[used++] = buffer[i];
+                    }
+                    continue;
+                }
+                line[used] = '\0';
+                unsigned long long sequence;
+                if ((used != LINE_SIZE - 1) || (sscanf(line, "%llu", &sequence) != 1)) {
+                    bad_lines++;
+                } else {
+                    lines++;
+                    out_of_order += (sequence <= last_sequence) ? 1 : 0;
+                    last_sequence = sequence;
+                }
+                used = 0;
+            }
+            return n > 0;
+        }
+    };
+
+    ///
+    /// One second of commands; a stalled controller reads nothing until the reader has finished
+    ///
+    void run_scenario(bool stalled)
+    {
+        int master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+        if ((master < 0) || (grantpt(master) != 0) || (unlockpt(master) != 0)) {
+            perror("posix_openpt");
+            exit(1);
+        }
+        f710::SerialSink serial{ptsname(master), 0};
+        Controller controller{master};
+        std::atomic<bool> stop{false};
+        std::thread controller_thread([&controller, &stop, stalled]() {
+            while (!stop.load()) {
+                if (stalled) {
+                    usleep(1000);
+                } else {
+                    controller.read_some(10);
+                }
+            }
+        });
+
+        f710::GeneratorConfig config;
+        config.events_per_sec = 500;
+        config.event_count = 500;
+        CountingState state;
+        uint64_t sequence = 0;
+        f710::Reader<CountingState> reader{std::make_unique<f710::GeneratorSource>(config), &state,
+            [&serial, &sequence](CountingState&) {
+                char line[LINE_SIZE + 1];
+                int n = snprintf(line, sizeof(line), "%lu", ++sequence);
+                memset(line + n, ' ', LINE_SIZE - 1 - (size_t)n);
+                line[LINE_SIZE - 1] = '\n';
+                serial.submit(line, LINE_SIZE, f710::Time::now());
+            }, TICK_INTERVAL_MS};
+        reader.add_output_sink(&serial);
+        try {
+            reader.run();
+        } catch (const f710::F710EndOfStream&) {
+        }
+        stop.store(true);
+        controller_thread.join();
+        while (controller.read_some(100)) {
+        }
+        close(master);
+
+        CHECK(serial.submitted() == sequence);
+        CHECK(serial.submitted() > 500);
+        CHECK(controller.bad_lines == 0);
+        CHECK(controller.out_of_order == 0);
+        CHECK(controller.lines > 0);
+        CHECK(controller.lines <= serial.commands_written());
+        // the pending slot and a partly written command can be left over when the reader stops
+        uint64_t accounted = serial.commands_written() + serial.superseded();
+        CHECK(accounted <= serial.submitted() && accounted + 2 >= serial.submitted());
+        if (stalled) {
+            CHECK(serial.superseded() > 0);
+        } else {
+            CHECK(serial.superseded() == 0);
+            CHECK(controller.lines == serial.commands_written());
+            CHECK(controller.last_sequence == controller.lines);
+        }
+    }
+}
+
+int main()
+{
+    run_scenario(false);
+    run_scenario(true);
+    return f710_test::check_result();
+}
@@ -0,0 +1,151 @@
+///
+/// Session files (session_format.h, session_recorder.h, session_replay.h):
+///
+/// -   the header is little endian on disk whatever the host, and reads back as written
+/// -   a file that is not a session file, or is of another version, is refused with F710SessionFileError
+/// -   replaying the same file twice, bare and with a callback after every event, leaves the model in
+///     exactly the same state, which is the property regression tests built on replay rely on
+///
+#include "check.h"
+#include "f710_exceptions.h"
+#include "model.h"
+#include "model_defines.h"
+#include "session_recorder.h"
+#include "session_replay.h"
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+    constexpr const char* DEVICE_NAME = "synthetic";
+
+    f710::ControllerState make_state()
+    {
+        return f710::ControllerState{
+            f710::AxisDevice(D_AXIS_LEFT_STICK_FWD_BKWD_NUMBER),
+            f710::AxisDevice(D_AXIS_RIGHT_STICK_FWD_BKWD_NUMBER),
+            f710::ToggleButton(D_BUTTON_A)};
+    }
+
+    /// the D mode init burst, then both sticks sweeping end to end while button A is pressed and released
+    void record_synthetic_session(const char* path, uint64_t count)
+    {
+        f710::SessionRecorder recorder{path, DEVICE_NAME};
+        uint32_t t = 1000;
+        for (uint8_t n = 0; n < 12; n++) {
+            recorder.record(js_event{t, 0, JS_EVENT_BUTTON | JS_EVENT_INIT, n});
+        }
+        for (uint8_t n = 0; n < 6; n++) {
+            recorder.record(js_event{t, 0, JS_EVENT_AXIS | JS_EVENT_INIT, n});
+        }
+        for (uint64_t i = 0; i < count; i++) {
+            if (i % 2 == 0) {
+                t += 2;
+            }
+            if (i % 1000 == 999) {
+                recorder.record(js_event{t, (int16_t)((i / 1000) % 2 == 0), JS_EVENT_BUTTON, D_BUTTON_A});
+                continue;
+            }
+            auto phase = (int32_t)(i % 512) - 256;
+            auto value = (int16_t)(phase * 128 + ((phase < 0) ? 0 : 127));
+            uint8_t number = (i % 2 == 0) ? D_AXIS_LEFT_STICK_FWD_BKWD_NUMBER : D_AXIS_RIGHT_STICK_FWD_BKWD_NUMBER;
+            recorder.record(js_event{t, value, JS_EVENT_AXIS, number});
+        }
+    }
+
+    bool same_state(f710::ControllerState& a, f710::ControllerState& b)
+    {
+        return (a.m_left.latest_event_value == b.m_left.latest_event_value)
+            && (a.m_right.latest_event_value == b.m_right.latest_event_value)
+            && (a.m_button.event_toggle_value == b.m_button.event_toggle_value)
+            && (a.m_button.event_state == b.m_button.event_state);
+    }
+
+    uint64_t read_le(const uint8_t* p, size_t size)
+    {
+        uint64_t value = 0;
+        for (size_t i = size; i > 0; i--) {
+            value = (value << 8) | p[i - 1];
+        }
+        return value;
+    }
+
+    void check_header(const char* path)
+    {
+        uint8_t raw[f710::SESSION_HEADER_SIZE];
+        int fd = open(path, O_RDONLY);
+        CHECK(fd != -1);
+        CHECK(read(fd, raw, sizeof(raw)) == (ssize_t)sizeof(raw));
+        close(fd);
+        CHECK(memcmp(raw, f710::SESSION_MAGIC, sizeof(f710::SESSION_MAGIC)) == 0);
+        CHECK(read_le(raw + 8, 4) == f710::SESSION_VERSION);
+        CHECK(read_le(raw + 12, 4) == strlen(DEVICE_NAME));
+
+        f710::SessionReplay session{path};
+        CHECK(session.device_name() == DEVICE_NAME);
+        CHECK((uint64_t)session.open_monotonic().nanosecs == read_le(raw + 16, 8));
+        CHECK((uint64_t)session.open_realtime_ns() == read_le(raw + 24, 8));
+        CHECK(session.open_realtime_ns() > 0);
+    }
+
+    bool refused(const char* path)
+    {
+        try {
+            f710::SessionReplay session{path};
+        } catch (const f710::F710SessionFileError&) {
+            return true;
+        }
+        return false;
+    }
+
+    /// rewrites count bytes of the header at offset
+    void patch(const char* path, off_t offset, const void* bytes, size_t count)
+    {
+        int fd = open(path, O_WRONLY);
+        CHECK(fd != -1);
+        CHECK(pwrite(fd, bytes, count, offset) == (ssize_t)count);
+        close(fd);
+    }
+
+    void check_refused(const char* path)
+    {
+        // the version as a host of the other byte order would have written it without conversion
+        const uint8_t swapped_version[4] = {0, 0, 0, (uint8_t)f710::SESSION_VERSION};
+        patch(path, 8, swapped_version, sizeof(swapped_version));
+        CHECK(refused(path));
+        patch(path, 0, "notf710s", 8);
+        CHECK(refused(path));
+    }
+
+    void check_deterministic(const char* path)
+    {
+        f710::SessionReplay session{path};
+        auto bare_state = make_state();
+        uint64_t replayed = session.replay(bare_state, 0.0);
+        CHECK(replayed == 18 + 100000);
+
+        auto cb_state = make_state();
+        uint64_t callbacks = 0;
+        session.replay<f710::ControllerState>(cb_state, 0.0, [&callbacks](f710::ControllerState&) { callbacks++; });
+        CHECK(callbacks == replayed);
+        CHECK(same_state(bare_state, cb_state));
+        // 2 ms for every other event after the init burst
+        CHECK(session.elapsed_ms() == 100000);
+    }
+}
+
+int main()
+{
+    char path[] = "/tmp/f710_session_replay_test_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd != -1);
+    close(fd);
+    record_synthetic_session(path, 100000);
+    check_header(path);
+    check_deterministic(path);
+    check_refused(path);
+    unlink(path);
+    return f710_test::check_result();
+}
@@ -0,0 +1,139 @@
+///
+/// The shared memory state segment (shm_state.h), with the publisher in a forked process as in
+/// shm_bench, on a segment named after this process so parallel runs do not meet:
+///
+/// -   consistency: every field the writer publishes is derived from its publish count, so a torn copy
+///     that got past the seqlock shows up as a mismatch; checked against a writer publishing flat out
+/// -   wait_for_update(): times out with no writer, returns true once a paced writer publishes
+/// -   the segment name goes away with the publisher, and a reader of a missing name throws
+///
+#include "check.h"
+#include "shm_state.h"
+#include "f710_exceptions.h"
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+    f710::ControllerSnapshot make_snapshot(uint64_t n)
+    {
+        f710::ControllerSnapshot s{};
+        for (int i = 0; i < f710::ControllerSnapshot::MAX_AXES; i++) {
+            s.axis_value[i] = (int16_t)(n + i);
+            s.axis_time[i] = (uint32_t)n;
+        }
+        for (auto& t: s.button_time) {
+            t = (uint32_t)n;
+        }
+        s.pressed = (uint16_t)n;
+        s.toggled = (uint16_t)~n;
+        s.dirty = (uint32_t)n;
+        return s;
+    }
+    bool is_consistent(const f710::SharedControllerState& state)
+    {
+        f710::ControllerSnapshot expected = make_snapshot(state.publish_count);
+        return memcmp(&expected, &state.snapshot, sizeof(expected)) == 0;
+    }
+
+    /// a child process publishing either flat out (period_us 0) or paced, until killed
+    pid_t start_writer(f710::ShmStatePublisher& publisher, int period_us)
+    {
+        pid_t pid = fork();
+        if (pid != 0) {
+            return pid;
+        }
+        for (;;) {
+            if (period_us > 0) {
+                usleep((useconds_t)period_us);
+            }
+            publisher.publish(make_snapshot(publisher.publish_count() + 1), f710::Time::now());
+        }
+    }
+    void stop_writer(pid_t pid)
+    {
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+    }
+
+    bool reader_throws(const std::string& name)
+    {
+        try {
+            f710::ShmStateReader reader{name};
+        } catch (const f710::F710SharedMemoryError&) {
+            return true;
+        }
+        return false;
+    }
+
+    void check_consistency(const std::string& name)
+    {
+        f710::ShmStatePublisher publisher{name};
+        publisher.publish(make_snapshot(1), f710::Time::now());
+        f710::ShmStateReader reader{name};
+        CHECK(reader.read().publish_count == 1);
+        CHECK(is_consistent(reader.read()));
+
+        pid_t writer = start_writer(publisher, 0);
+        uint64_t mismatches = 0;
+        uint64_t distinct = 0;
+        uint64_t went_backwards = 0;
+        uint64_t last = 1;
+        // half a second, longer if the writer has hardly been scheduled (on one CPU it runs in slices)
+        f710::Time start = f710::Time::now();
+        int64_t elapsed_ms = 0;
+        while ((elapsed_ms < 500) || ((distinct < 10) && (elapsed_ms < 5000))) {
+            for (int i = 0; i < 1000; i++) {
+                f710::SharedControllerState state = reader.read();
+                mismatches += is_consistent(state) ? 0 : 1;
+                went_backwards += (state.publish_count < last) ? 1 : 0;
+                distinct += (state.publish_count != last) ? 1 : 0;
+                last = state.publish_count;
+            }
+            elapsed_ms = f710::Time::diff(f710::Time::now(), start).nanosecs / 1000000;
+        }
+        stop_writer(writer);
+        CHECK(mismatches == 0);
+        CHECK(went_backwards == 0);
+        CHECK(distinct >= 10);
+    }
+
+    void check_wait(const std::string& name)
+    {
+        f710::ShmStatePublisher publisher{name};
+        publisher.publish(make_snapshot(1), f710::Time::now());
+        f710::ShmStateReader reader{name};
+        CHECK(!reader.wait_for_update(1, f710::Time::from_ms(20)));
+        CHECK(reader.wait_for_update(0, f710::Time::from_ms(20)));
+
+        pid_t writer = start_writer(publisher, 1000);
+        uint64_t last = reader.read().publish_count;
+        int updates = 0;
+        int inconsistent = 0;
+        for (int i = 0; i < 50; i++) {
+            if (reader.wait_for_update(last, f710::Time::from_ms(1000))) {
+                f710::SharedControllerState state = reader.read();
+                inconsistent += is_consistent(state) ? 0 : 1;
+                updates += (state.publish_count > last) ? 1 : 0;
+                last = state.publish_count;
+            }
+        }
+        stop_writer(writer);
+        CHECK(updates == 50);
+        CHECK(inconsistent == 0);
+    }
+}
+
+int main()
+{
+    std::string name = "/f710_shm_state_test_" + std::to_string(getpid());
+    check_consistency(name);
+    CHECK(reader_throws(name));
+    check_wait(name);
+    CHECK(reader_throws(name));
+    return f710_test::check_result();
+}
@@ -0,0 +1,134 @@
+///
+/// The queued mode pieces (spsc_queue.h, queued_state.h):
+///
+/// -   SpscQueue on one thread: FIFO order across the wrap, a full queue refusing and counting the push
+/// -   SpscQueue across two threads, the consumer sleeping on a ConsumerWaker: every item arrives once
+///     and in order
+/// -   QueueConsumer on a thread of its own: drains what QueueingState pushes into the model, calls the
+///     callback, and returns from run() after stop()
+///
+#include "check.h"
+#include "queued_state.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+namespace {
+
+    using SmallQueue = f710::SpscQueue<uint64_t, 8>;
+
+    void check_single_thread()
+    {
+        SmallQueue queue;
+        uint64_t item = 0;
+        CHECK(queue.empty());
+        CHECK(!queue.try_pop(item));
+        uint64_t next_in = 0;
+        uint64_t next_out = 0;
+        int wrong = 0;
+        // three times round the ring, half full each time
+        for (int round = 0; round < 6; round++) {
+            for (int i = 0; i < 4; i++) {
+                CHECK(queue.try_push(next_in++));
+            }
+            for (int i = 0; i < 4; i++) {
+                CHECK(queue.try_pop(item));
+                wrong += (item != next_out++) ? 1 : 0;
+            }
+        }
+        CHECK(wrong == 0);
+        CHECK(queue.empty());
+        for (size_t i = 0; i < SmallQueue::capacity(); i++) {
+            CHECK(queue.try_push(100 + i));
+        }
+        CHECK(!queue.try_push(999));
+        CHECK(queue.overflow_count() == 1);
+        CHECK(queue.push_count() == 24 + SmallQueue::capacity());
+        CHECK(queue.try_pop(item) && item == 100);
+        CHECK(queue.try_push(108));
+        for (uint64_t expected = 101; expected <= 108; expected++) {
+            CHECK(queue.try_pop(item) && item == expected);
+        }
+        CHECK(!queue.try_pop(item));
+    }
+
+    void check_two_threads()
+    {
+        const uint64_t count = 200000;
+        auto queue = std::make_unique<f710::EventQueue>();
+        f710::ConsumerWaker waker;
+        uint64_t received = 0;
+        uint64_t out_of_order = 0;
+        std::thread consumer([&]() {
+            f710::QueuedEvent item{};
+            while (received < count) {
+                if (queue->try_pop(item)) {
+                    out_of_order += (item.enqueue_ns != received) ? 1 : 0;
+                    received++;
+                } else {
+                    waker.wait(1000000, [&]() { return queue->empty(); });
+                }
+            }
+        });
+        for (uint64_t i = 0; i < count; i++) {
+            js_event event{.time = (uint32_t)i, .value = 0, .type = JS_EVENT_AXIS, .number = 0};
+            // the sequence number rides in enqueue_ns
+            while (!queue->try_push(f710::QueuedEvent{event, i})) {
+                std::this_thread::yield();
+            }
+            waker.notify();
+        }
+        consumer.join();
+        CHECK(received == count);
+        CHECK(out_of_order == 0);
+        CHECK(queue->push_count() == count);
+    }
+
+    struct SummingState {
+        uint64_t events = 0;
+        int64_t value_sum = 0;
+        void apply_event(js_event event)
+        {
+            events++;
+            value_sum += event.value;
+        }
+    };
+
+    void check_consumer()
+    {
+        auto queue = std::make_unique<f710::EventQueue>();
+        f710::ConsumerWaker waker;
+        f710::QueueingState queueing_state{queue.get(), &waker};
+        SummingState state;
+        std::atomic<uint64_t> callbacks{0};
+        f710::QueueConsumer<SummingState> consumer{queue.get(), &waker, &state,
+            [&callbacks](SummingState&) { callbacks.fetch_add(1); }, 5};
+        std::thread consumer_thread([&consumer]() { consumer.run(); });
+        int64_t expected_sum = 0;
+        for (int i = 0; i < 500; i++) {
+            queueing_state.apply_event(js_event{.time = 0, .value = (int16_t)i, .type = JS_EVENT_AXIS, .number = 0});
+            expected_sum += i;
+        }
+        // a few output intervals for the consumer to drain and tick
+        f710::Time deadline = f710::Time::now().add_ms(2000);
+        while (((callbacks.load() < 3) || !queue->empty()) && (f710::Time::now().nanosecs < deadline.nanosecs)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        consumer.stop();
+        waker.notify();
+        consumer_thread.join();
+        CHECK(queueing_state.overflow_count() == 0);
+        CHECK(state.events == 500);
+        CHECK(state.value_sum == expected_sum);
+        CHECK(callbacks.load() >= 3);
+    }
+}
+
+int main()
+{
+    check_single_thread();
+    check_two_threads();
+    check_consumer();
+    return f710_test::check_result();
+}
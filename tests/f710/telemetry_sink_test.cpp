@@ -0,0 +1,163 @@
+///
+/// TelemetrySink (telemetry_sink.h) driven by hand, as the reader would, on a pipe cut down to a page with
+/// F_SETPIPE_SZ:
+///
+/// -   never drained: a full queue drops and counts what does not fit; the one writev that meets the
+///     full pipe is cut part way through a line, and everything after it would block
+/// -   drained: the rest of the cut line goes first, then the queue, then a notice of how many lines
+///     were dropped; everything read is whole lines, in order, the gaps in the numbering add up to the
+///     notices and to dropped(), and bytes_written() is what the pipe delivered
+/// -   closed: the next write gets EPIPE rather than SIGPIPE, the queue is counted as dropped and the
+///     sink turns itself off
+///
+#include "check.h"
+#include "telemetry_sink.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+    /// every numbered line is this long, so that a cut line shows
+    constexpr size_t LINE_BYTES = 100;
+    constexpr int LINE_COUNT = f710::TelemetrySink::LINE_COUNT;
+
+    bool numbered_line(f710::TelemetrySink& sink, int n)
+    {
+        return sink.line("line %05d %0*d\n", n, (int)LINE_BYTES - 12, 0);
+    }
+
+    /// what the pipe holds, appended to text
+    void drain(int fd, std::string& text)
+    {
+        char buffer[4096];
+        ssize_t n;
+        while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+            text.append(buffer, (size_t)n);
+        }
+    }
+
+    struct Received {
+        uint64_t lines = 0;
+        uint64_t bad_lines = 0;
+        uint64_t out_of_order = 0;
+        uint64_t gap_lines = 0;
+        uint64_t notices = 0;
+        uint64_t announced_drops = 0;
+    };
+
+    Received parse(const std::string& text)
+    {
+        Received r;
+        int last = -1;
+        size_t start = 0;
+        size_t end;
+        while ((end = text.find('\n', start)) != std::string::npos) {
+            std::string line = text.substr(start, end + 1 - start);
+            start = end + 1;
+            int n = 0;
+            unsigned long dropped = 0;
+            if (sscanf(line.c_str(), "[telemetry: %lu lines dropped]", &dropped) == 1) {
+                r.notices++;
+                r.announced_drops += dropped;
+            } else if ((line.size() == LINE_BYTES) && (sscanf(line.c_str(), "line %d ", &n) == 1)) {
+                r.lines++;
+                r.out_of_order += (n <= last) ? 1 : 0;
+                r.gap_lines += (n > last + 1) ? (uint64_t)(n - last - 1) : 0;
+                last = n;
+            } else {
+                r.bad_lines++;
+            }
+        }
+        // a line cut off at the end
+        r.bad_lines += (start != text.size()) ? 1 : 0;
+        return r;
+    }
+}
+
+int main()
+{
+    int fds[2];
+    CHECK(pipe2(fds, O_CLOEXEC | O_NONBLOCK) == 0);
+    CHECK(fcntl(fds[1], F_SETPIPE_SZ, 4096) > 0);
+    auto capacity = (uint64_t)fcntl(fds[1], F_GETPIPE_SZ);
+    // the queue must hold more than the pipe for the writev to be cut
+    CHECK(capacity < LINE_COUNT * LINE_BYTES);
+    CHECK(capacity % LINE_BYTES != 0);
+
+    f710::TelemetrySink sink{fds[1]};
+    close(fds[1]);
+    CHECK(!sink.failed());
+    CHECK(!sink.wants_write());
+    int n = 0;
+
+    // never drained: the queue fills and the rest is dropped, then one writev fills the pipe part way
+    // through a line and the next would block
+    for (; n < LINE_COUNT; n++) {
+        CHECK(numbered_line(sink, n));
+    }
+    for (; n < LINE_COUNT + 36; n++) {
+        CHECK(!numbered_line(sink, n));
+    }
+    CHECK(sink.dropped() == 36);
+    CHECK(sink.wants_write());
+    sink.on_writable(f710::Time::now());
+    CHECK(sink.bytes_written() == capacity);
+    CHECK(sink.writev_calls() == 2);
+    CHECK(sink.would_block() == 1);
+    CHECK(sink.wants_write());
+    // a line after every tick while nothing is read: the notice and some lines fit, the rest drop
+    uint64_t accepted = 0;
+    for (int i = 0; i < 100; i++, n++) {
+        accepted += numbered_line(sink, n) ? 1 : 0;
+        sink.on_writable(f710::Time::now());
+    }
+    CHECK(accepted == capacity / LINE_BYTES - 1);
+    CHECK(sink.bytes_written() == capacity);
+    CHECK(sink.would_block() == 101);
+    CHECK(sink.lines() == (uint64_t)n);
+    CHECK(sink.dropped() == (uint64_t)n - LINE_COUNT - accepted);
+
+    // drained: everything queued goes out; the next line brings the notice for the last drops
+    std::string text;
+    while (sink.wants_write()) {
+        drain(fds[0], text);
+        sink.on_writable(f710::Time::now());
+    }
+    for (int i = 0; i < 200; i++, n++) {
+        CHECK(numbered_line(sink, n));
+        while (sink.wants_write()) {
+            drain(fds[0], text);
+            sink.on_writable(f710::Time::now());
+        }
+    }
+    drain(fds[0], text);
+    CHECK(sink.lines() == (uint64_t)n);
+    CHECK(sink.bytes_written() == text.size());
+    Received received = parse(text);
+    CHECK(received.bad_lines == 0);
+    CHECK(received.out_of_order == 0);
+    CHECK(received.notices == 2);
+    CHECK(received.announced_drops == sink.dropped());
+    CHECK(received.gap_lines == sink.dropped());
+    CHECK(received.lines + sink.dropped() == sink.lines());
+
+    // closed: EPIPE, not SIGPIPE; what was queued is dropped and the sink stays off
+    close(fds[0]);
+    CHECK(numbered_line(sink, n++));
+    CHECK(numbered_line(sink, n++));
+    uint64_t dropped_before = sink.dropped();
+    uint64_t bytes_before = sink.bytes_written();
+    sink.on_writable(f710::Time::now());
+    CHECK(sink.failed());
+    CHECK(!sink.wants_write());
+    CHECK(sink.dropped() == dropped_before + 2);
+    CHECK(sink.bytes_written() == bytes_before);
+    CHECK(!numbered_line(sink, n++));
+    CHECK(sink.dropped() == dropped_before + 3);
+    CHECK(sink.lines() == (uint64_t)n);
+    return f710_test::check_result();
+}
@@ -0,0 +1,200 @@
+///
+/// The UDP drive command link (udp_state.h) over loopback: frames arrive once, in order and intact;
+/// redundancy makes good up to K lost datagrams and no more; late, duplicate, stale and malformed
+/// datagrams are dropped and counted; and a restarted publisher is followed.
+///
+#include "check.h"
+#include "udp_state.h"
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <vector>
+
+namespace {
+
+    using Datagram = std::vector<uint8_t>;
+
+    f710::DriveFrame make_frame(int n)
+    {
+        f710::DriveFrame frame{};
+        frame.left_raw = (int16_t)(n * 100);
+        frame.right_raw = (int16_t)(-n * 100);
+        frame.left_pwm = (int8_t)(n % 60);
+        frame.right_pwm = (int8_t)-(n % 60);
+        frame.flags = (n % 2 == 0) ? f710::DriveFrame::FLAG_HIGH_GEAR : 0;
+        return frame;
+    }
+
+    /// the next datagram on the receiver's socket, waiting up to a second for it
+    Datagram next_datagram(f710::UdpStateReceiver& receiver)
+    {
+        pollfd pfd{receiver.fd(), POLLIN, 0};
+        poll(&pfd, 1, 1000);
+        uint8_t buffer[f710::udp_wire::MAX_PACKET_SIZE + 1];
+        ssize_t n = recv(receiver.fd(), buffer, sizeof(buffer), MSG_DONTWAIT);
+        return (n > 0) ? Datagram(buffer, buffer + n) : Datagram();
+    }
+
+    /// handles one datagram, appending what is delivered to delivered
+    int handle(f710::UdpStateReceiver& receiver, const Datagram& d, std::vector<f710::DriveFrame>& delivered,
+               int64_t now_ns = 0)
+    {
+        return receiver.handle_datagram(d.data(), d.size(), (now_ns == 0) ? f710::wall_clock_ns() : now_ns,
+            [&delivered](const f710::DriveFrame& frame) { delivered.push_back(frame); });
+    }
+
+    void check_wire_format()
+    {
+        f710::DriveFrame frame{};
+        frame.sequence = 0x01020304;
+        frame.capture_time_ns = 0x1112131415161718;
+        frame.left_raw = -2;
+        frame.right_raw = 0x0102;
+        frame.left_pwm = -60;
+        frame.right_pwm = 85;
+        frame.flags = f710::DriveFrame::FLAG_HIGH_GEAR;
+        uint8_t bytes[f710::udp_wire::FRAME_SIZE];
+        f710::udp_wire::encode_frame(frame, bytes);
+        const uint8_t expected[f710::udp_wire::FRAME_SIZE] = {0x04, 0x03, 0x02, 0x01,
+            0x18, 0x17, 0x16, 0x15, 0x14, 0x13, 0x12, 0x11, 0xfe, 0xff, 0x02, 0x01, 0xc4, 85, 1, 0};
+        CHECK(memcmp(bytes, expected, sizeof(bytes)) == 0);
+        f710::DriveFrame decoded = f710::udp_wire::decode_frame(bytes);
+        CHECK(decoded.sequence == frame.sequence && decoded.capture_time_ns == frame.capture_time_ns);
+        CHECK(decoded.left_raw == -2 && decoded.right_raw == 0x0102);
+        CHECK(decoded.left_pwm == -60 && decoded.right_pwm == 85 && decoded.flags == 1);
+    }
+
+    void check_loopback_in_order()
+    {
+        const int count = 500;
+        f710::UdpStateReceiver receiver{0};
+        f710::UdpStatePublisher publisher{"127.0.0.1", receiver.port(), 2};
+        std::vector<f710::DriveFrame> delivered;
+        for (int n = 1; n <= count; n++) {
+            CHECK(publisher.publish(make_frame(n)));
+            pollfd pfd{receiver.fd(), POLLIN, 0};
+            poll(&pfd, 1, 1000);
+            receiver.receive([&delivered](const f710::DriveFrame& frame) { delivered.push_back(frame); });
+        }
+        CHECK((int)delivered.size() == count);
+        int wrong = 0;
+        for (size_t i = 0; i < delivered.size(); i++) {
+            f710::DriveFrame expected = make_frame((int)i + 1);
+            const f710::DriveFrame& f = delivered[i];
+            wrong += (f.sequence != i + 1 || f.left_raw != expected.left_raw || f.right_raw != expected.right_raw
+                      || f.left_pwm != expected.left_pwm || f.right_pwm != expected.right_pwm
+                      || f.flags != expected.flags || f.capture_time_ns == 0) ? 1 : 0;
+        }
+        CHECK(wrong == 0);
+        CHECK(receiver.lost() == 0 && receiver.late() == 0 && receiver.recovered() == 0);
+    }
+
+    ///
+    /// With redundancy 2 the receiver gets datagrams 1, 4 (2 and 3 lost), 5 and 9 (6, 7 and 8 lost)
+    ///
+    void check_redundancy()
+    {
+        f710::UdpStateReceiver receiver{0};
+        f710::UdpStatePublisher publisher{"127.0.0.1", receiver.port(), 2};
+        std::vector<Datagram> datagrams;
+        for (int n = 1; n <= 9; n++) {
+            publisher.publish(make_frame(n));
+            datagrams.push_back(next_datagram(receiver));
+        }
+        std::vector<f710::DriveFrame> delivered;
+        for (int n: {1, 4, 5, 9}) {
+            handle(receiver, datagrams[n - 1], delivered);
+        }
+        std::vector<uint32_t> sequences;
+        for (const auto& f: delivered) {
+            sequences.push_back(f.sequence);
+        }
+        CHECK((sequences == std::vector<uint32_t>{1, 2, 3, 4, 5, 7, 8, 9}));
+        CHECK(receiver.recovered() == 4);
+        CHECK(receiver.lost() == 1);
+        CHECK(receiver.duplicates() == 2);
+    }
+
+    void check_late_duplicate_stale_and_bad()
+    {
+        f710::UdpStateReceiver receiver{0, f710::Time::from_ms(100)};
+        f710::UdpStatePublisher publisher{"127.0.0.1", receiver.port(), 0};
+        std::vector<Datagram> datagrams;
+        for (int n = 1; n <= 4; n++) {
+            publisher.publish(make_frame(n));
+            datagrams.push_back(next_datagram(receiver));
+        }
+        std::vector<f710::DriveFrame> delivered;
+        handle(receiver, datagrams[1], delivered);
+        // reordered: 1 arrives after 2 and must not move the robot back in time
+        CHECK(handle(receiver, datagrams[0], delivered) == 0);
+        CHECK(receiver.late() == 1);
+        CHECK(handle(receiver, datagrams[1], delivered) == 0);
+        CHECK(receiver.late() == 2);
+        // a second after capture, well past max_age
+        f710::DriveFrame third = f710::udp_wire::decode_frame(datagrams[2].data() + f710::udp_wire::HEADER_SIZE);
+        CHECK(handle(receiver, datagrams[2], delivered, third.capture_time_ns + 1000000000) == 0);
+        CHECK(receiver.stale() == 1);
+        CHECK(handle(receiver, datagrams[3], delivered) == 1);
+        CHECK(delivered.size() == 2 && delivered[0].sequence == 2 && delivered[1].sequence == 4);
+
+        Datagram bad_magic = datagrams[3];
+        bad_magic[0] = 'X';
+        Datagram bad_version = datagrams[3];
+        bad_version[2] = f710::udp_wire::VERSION + 1;
+        Datagram truncated(datagrams[3].begin(), datagrams[3].end() - 1);
+        Datagram bad_count = datagrams[3];
+        bad_count[3] = 2;
+        for (const Datagram* d: {&bad_magic, &bad_version, &truncated, &bad_count}) {
+            CHECK(handle(receiver, *d, delivered) == 0);
+        }
+        CHECK(receiver.packets() == 9);
+        CHECK(receiver.delivered() == 2);
+    }
+
+    void check_publisher_restart()
+    {
+        f710::UdpStateReceiver receiver{0};
+        std::vector<f710::DriveFrame> delivered;
+        {
+            f710::UdpStatePublisher first{"127.0.0.1", receiver.port(), 2};
+            for (int n = 1; n <= 50; n++) {
+                first.publish(make_frame(n));
+                handle(receiver, next_datagram(receiver), delivered);
+            }
+        }
+        f710::UdpStatePublisher second{"127.0.0.1", receiver.port(), 2};
+        second.publish(make_frame(1));
+        CHECK(handle(receiver, next_datagram(receiver), delivered) == 1);
+        CHECK(receiver.restarts() == 1);
+        CHECK(delivered.back().sequence == 1);
+        second.publish(make_frame(2));
+        CHECK(handle(receiver, next_datagram(receiver), delivered) == 1);
+        CHECK(receiver.late() == 0 && receiver.lost() == 0);
+
+        // the same session jumping far back is a restart too
+        second.publish(make_frame(3));
+        Datagram jump = next_datagram(receiver);
+        f710::DriveFrame frame = f710::udp_wire::decode_frame(jump.data() + f710::udp_wire::HEADER_SIZE);
+        frame.sequence = 100000;
+        f710::udp_wire::encode_frame(frame, jump.data() + f710::udp_wire::HEADER_SIZE);
+        jump.resize(f710::udp_wire::HEADER_SIZE + f710::udp_wire::FRAME_SIZE);
+        jump[3] = 1;
+        CHECK(handle(receiver, jump, delivered) == 1);
+        CHECK(receiver.restarts() == 1);
+        second.publish(make_frame(4));
+        CHECK(handle(receiver, next_datagram(receiver), delivered) >= 1);
+        CHECK(receiver.restarts() == 2);
+        CHECK(delivered.back().sequence == 4);
+    }
+}
+
+int main()
+{
+    check_wire_format();
+    check_loopback_in_order();
+    check_redundancy();
+    check_late_duplicate_stale_and_bad();
+    check_publisher_restart();
+    return f710_test::check_result();
+}